@@ -0,0 +1,621 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "db.h"
+#include "od_db.h"
+
+// One risk assessment as it was produced
+struct AuditRecord {
+    uint64_t timestamp = 0;       // Milliseconds since the Unix epoch
+    uint64_t regimenHash = 0;     // See hashRegimen
+    uint64_t catalogVersion = 0;  // See computeCatalogVersion
+    std::vector<std::string> drugs;
+    std::string profile;          // PatientProfile::toString(), empty when assessed without one
+    std::vector<InteractionEffect> effects;  // descriptionId is not kept, see descriptions
+    std::vector<std::string> descriptions;   // Text of each effect as it was reported
+    int combinedRisk = 0;
+    bool complete = true;         // False when a deadline cut the analysis short
+    uint64_t pairsAnalyzed = 0;   // Of pairCount drug pairs, when the effects were found
+    uint64_t pairCount = 0;
+
+    // Effects with their description text, which stays readable by other builds
+    // and catalogs where the analyzer's description ids would not
+    void setEffects(std::vector<InteractionEffect> reported, const InteractionAnalyzer& analyzer) {
+        descriptions.clear();
+        for (const auto& effect : reported) {
+            descriptions.emplace_back(analyzer.getDescription(effect));
+        }
+        effects = std::move(reported);
+    }
+};
+
+inline uint64_t auditTimestampNow() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+// Order-independent hash of a regimen's drug names and the patient profile it
+// was assessed for; without a profile it is the hash of the names alone
+inline uint64_t hashRegimen(std::vector<std::string> drugs, std::string_view profile = {}) {
+    std::sort(drugs.begin(), drugs.end());
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const auto& name : drugs) {
+        for (unsigned char c : name) {
+            hash = (hash ^ c) * 0x100000001b3ULL;
+        }
+        hash = (hash ^ 0xff) * 0x100000001b3ULL;
+    }
+    if (!profile.empty()) {
+        hash = (hash ^ '@') * 0x100000001b3ULL;
+        for (unsigned char c : profile) {
+            hash = (hash ^ c) * 0x100000001b3ULL;
+        }
+    }
+    return hash;
+}
+
+// Fingerprint of everything an assessment depends on: drugs, class matrix, pair
+// overrides and overdose data
+inline uint64_t computeCatalogVersion(const DrugDatabase& database, const InteractionAnalyzer& analyzer,
+    const OverdosePotentialDatabase& overdoseDB) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    auto mix = [&hash](uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            hash = (hash ^ ((value >> (i * 8)) & 0xff)) * 0x100000001b3ULL;
+        }
+    };
+    // Description text, not its id, which depends on the order it was interned in
+    auto mixText = [&hash](std::string_view text) {
+        for (unsigned char c : text) {
+            hash = (hash ^ c) * 0x100000001b3ULL;
+        }
+        hash = (hash ^ 0xff) * 0x100000001b3ULL;
+    };
+
+    for (size_t id = 0; id < database.getDrugCount(); ++id) {
+        const Drug* drug = database.getDrugById(static_cast<int>(id));
+        for (unsigned char c : drug->getName()) mix(c);
+        mix(static_cast<uint64_t>(drug->getDrugClass()));
+        mix(static_cast<uint64_t>(drug->getHalfLife() * 1000.0));
+        mix(static_cast<uint64_t>(overdoseDB.getOverdosePercentage(drug->getName())));
+    }
+    for (int a = 0; a < DRUG_CLASS_COUNT; ++a) {
+        for (int b = 0; b < DRUG_CLASS_COUNT; ++b) {
+            for (const auto& effect : analyzer.getClassEffects(static_cast<DrugClass>(a), static_cast<DrugClass>(b))) {
+                mix(static_cast<uint64_t>(effect.effect) << 8 | static_cast<uint64_t>(effect.severity));
+                mix(static_cast<uint64_t>(effect.probability * 1e6));
+                mixText(analyzer.getDescription(effect));
+            }
+        }
+    }
+    analyzer.getPairOverrides().forEachPair([&](int drug1, int drug2, const InteractionEffect* effects, size_t count) {
+        mix(static_cast<uint64_t>(drug1) << 32 | static_cast<uint32_t>(drug2));
+        for (size_t k = 0; k < count; ++k) {
+            mix(static_cast<uint64_t>(effects[k].effect) << 8 | static_cast<uint64_t>(effects[k].severity));
+            mix(static_cast<uint64_t>(effects[k].probability * 1e6));
+            mixText(analyzer.getDescription(effects[k]));
+        }
+    });
+    return hash;
+}
+
+// Embedded append-only store of risk assessments.
+//
+// Records go to numbered segment files as [length u32][crc32 u32][payload]. Callers
+// only encode into an in-memory batch; a writer thread appends whole batches and
+// fsyncs once per batch (group commit), so fsync latency never reaches the query
+// path. Each segment has a sidecar .idx file of fixed-size entries (regimen hash,
+// timestamp, offset) for lookups, synced when the segment is rolled over. On open,
+// the last segment is scanned and a torn tail record from a crash is truncated
+// away, and its index is rebuilt from the log.
+class AuditLog {
+public:
+    struct Options {
+        uint64_t segmentBytes = 64ull << 20;
+        std::chrono::milliseconds commitInterval{ 5 };
+        size_t maxBatchBytes = 1 << 20;
+    };
+
+private:
+    struct Location {
+        uint32_t segment;
+        uint64_t offset;
+    };
+
+    struct IndexEntry {
+        uint64_t regimenHash;
+        uint64_t timestamp;
+        uint64_t offset;
+    };
+
+    std::filesystem::path directory;
+    Options options;
+
+    std::FILE* segmentFile = nullptr;
+    std::FILE* indexFile = nullptr;
+    uint32_t segmentNumber = 0;
+    uint64_t segmentSize = 0;
+
+    std::mutex indexMutex;
+    std::unordered_multimap<uint64_t, Location> byRegimen;
+    std::multimap<uint64_t, Location> byTime;
+
+    std::mutex queueMutex;
+    std::condition_variable queueReady;
+    std::condition_variable durableReady;
+    std::vector<uint8_t> pendingBytes;
+    std::vector<std::pair<uint64_t, uint64_t>> pendingKeys;  // (regimen hash, timestamp) per record
+    std::vector<size_t> pendingOffsets;                       // Record start within pendingBytes
+    uint64_t enqueuedCount = 0;
+    uint64_t durableCount = 0;
+    bool stopping = false;
+    bool failed = false;  // A write or sync failed; no more records are accepted
+    std::thread writer;
+
+    static uint32_t crc32(const uint8_t* data, size_t size) {
+        static const auto table = [] {
+            std::vector<uint32_t> values(256);
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) {
+                    c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                }
+                values[i] = c;
+            }
+            return values;
+        }();
+
+        uint32_t crc = 0xffffffffu;
+        for (size_t i = 0; i < size; ++i) {
+            crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        }
+        return crc ^ 0xffffffffu;
+    }
+
+    static void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    static bool getVarint(const uint8_t*& cursor, const uint8_t* end, uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64 && cursor < end; shift += 7) {
+            uint8_t byte = *cursor++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    static void encode(const AuditRecord& record, std::vector<uint8_t>& out) {
+        putVarint(out, record.timestamp);
+        putVarint(out, record.regimenHash);
+        putVarint(out, record.catalogVersion);
+        putVarint(out, record.drugs.size());
+        for (const auto& name : record.drugs) {
+            putVarint(out, name.size());
+            out.insert(out.end(), name.begin(), name.end());
+        }
+        putVarint(out, record.effects.size());
+        for (size_t i = 0; i < record.effects.size(); ++i) {
+            const InteractionEffect& effect = record.effects[i];
+            out.push_back(static_cast<uint8_t>(static_cast<int>(effect.effect) << 2 | static_cast<int>(effect.severity)));
+            // Probabilities are kept bit-exact, they are what was reported
+            uint8_t probability[sizeof(double)];
+            std::memcpy(probability, &effect.probability, sizeof(double));
+            out.insert(out.end(), probability, probability + sizeof(double));
+            std::string_view text = i < record.descriptions.size() ? std::string_view(record.descriptions[i]) : std::string_view();
+            putVarint(out, text.size());
+            out.insert(out.end(), text.begin(), text.end());
+        }
+        out.push_back(static_cast<uint8_t>(record.combinedRisk));
+        // Fields added later follow, so records written before them still decode
+        putVarint(out, record.profile.size());
+        out.insert(out.end(), record.profile.begin(), record.profile.end());
+        out.push_back(record.complete ? 1 : 0);
+        putVarint(out, record.pairsAnalyzed);
+        putVarint(out, record.pairCount);
+    }
+
+    static bool decode(const uint8_t* cursor, const uint8_t* end, AuditRecord& record) {
+        uint64_t count = 0, length = 0;
+        if (!getVarint(cursor, end, record.timestamp) || !getVarint(cursor, end, record.regimenHash) ||
+            !getVarint(cursor, end, record.catalogVersion) || !getVarint(cursor, end, count)) {
+            return false;
+        }
+        record.drugs.clear();
+        for (uint64_t i = 0; i < count; ++i) {
+            if (!getVarint(cursor, end, length) || static_cast<uint64_t>(end - cursor) < length) return false;
+            record.drugs.emplace_back(reinterpret_cast<const char*>(cursor), length);
+            cursor += length;
+        }
+        if (!getVarint(cursor, end, count)) return false;
+        record.effects.clear();
+        record.descriptions.clear();
+        for (uint64_t i = 0; i < count; ++i) {
+            if (end - cursor < 1 + static_cast<ptrdiff_t>(sizeof(double))) return false;
+            InteractionEffect effect;
+            effect.effect = static_cast<SideEffect>(cursor[0] >> 2);
+            effect.severity = static_cast<InteractionSeverity>(cursor[0] & 3);
+            std::memcpy(&effect.probability, cursor + 1, sizeof(double));
+            effect.descriptionId = 0;
+            cursor += 1 + sizeof(double);
+            if (!getVarint(cursor, end, length) || static_cast<uint64_t>(end - cursor) < length) return false;
+            record.descriptions.emplace_back(reinterpret_cast<const char*>(cursor), length);
+            cursor += length;
+            record.effects.push_back(effect);
+        }
+        if (cursor >= end) return false;
+        record.combinedRisk = *cursor++;
+        // Older records end early; they were only written for complete analyses
+        record.profile.clear();
+        record.complete = true;
+        record.pairCount = record.drugs.size() < 2 ? 0 : record.drugs.size() * (record.drugs.size() - 1) / 2;
+        record.pairsAnalyzed = record.pairCount;
+        if (cursor == end) return true;
+        if (!getVarint(cursor, end, length) || static_cast<uint64_t>(end - cursor) < length) return false;
+        record.profile.assign(reinterpret_cast<const char*>(cursor), length);
+        cursor += length;
+        if (cursor == end) return true;
+        record.complete = *cursor++ != 0;
+        return getVarint(cursor, end, record.pairsAnalyzed) && getVarint(cursor, end, record.pairCount);
+    }
+
+    std::filesystem::path segmentPath(uint32_t number, const char* extension) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "audit-%06u.%s", number, extension);
+        return directory / name;
+    }
+
+    static bool syncFile(std::FILE* file) {
+        if (std::fflush(file) != 0) return false;
+#ifdef _WIN32
+        return _commit(_fileno(file)) == 0;
+#else
+        return fsync(fileno(file)) == 0;
+#endif
+    }
+
+    void addToIndex(uint64_t regimenHash, uint64_t timestamp, Location location) {
+        std::lock_guard<std::mutex> lock(indexMutex);
+        byRegimen.emplace(regimenHash, location);
+        byTime.emplace(timestamp, location);
+    }
+
+    // Scans a segment's frames; returns the length of its valid prefix
+    uint64_t scanSegment(uint32_t number, std::vector<IndexEntry>& entries) const {
+        std::vector<uint8_t> bytes;
+        if (std::FILE* file = std::fopen(segmentPath(number, "log").string().c_str(), "rb")) {
+            uint8_t buffer[1 << 16];
+            size_t read;
+            while ((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+                bytes.insert(bytes.end(), buffer, buffer + read);
+            }
+            std::fclose(file);
+        }
+
+        uint64_t offset = 0;
+        while (offset + 8 <= bytes.size()) {
+            uint32_t length, crc;
+            std::memcpy(&length, bytes.data() + offset, 4);
+            std::memcpy(&crc, bytes.data() + offset + 4, 4);
+            if (offset + 8 + length > bytes.size() || crc32(bytes.data() + offset + 8, length) != crc) break;
+
+            AuditRecord record;
+            if (!decode(bytes.data() + offset + 8, bytes.data() + offset + 8 + length, record)) break;
+            entries.push_back({ record.regimenHash, record.timestamp, offset });
+            offset += 8 + length;
+        }
+        return offset;
+    }
+
+    bool openSegment(uint32_t number) {
+        bool ok = true;
+        if (segmentFile) std::fclose(segmentFile);
+        if (indexFile) {
+            // Recovery trusts the index of every segment but the last, so it must
+            // be on disk before the next segment exists
+            ok = syncFile(indexFile);
+            ok = std::fclose(indexFile) == 0 && ok;
+        }
+        segmentFile = nullptr;
+        indexFile = nullptr;
+        if (!ok) return false;
+
+        segmentNumber = number;
+        segmentFile = std::fopen(segmentPath(number, "log").string().c_str(), "ab");
+        indexFile = std::fopen(segmentPath(number, "idx").string().c_str(), "ab");
+        if (!segmentFile || !indexFile || std::fseek(segmentFile, 0, SEEK_END) != 0) return false;
+        segmentSize = static_cast<uint64_t>(std::ftell(segmentFile));
+        return true;
+    }
+
+    bool recover() {
+        uint32_t last = 0;
+        for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+            unsigned number = 0;
+            if (std::sscanf(entry.path().filename().string().c_str(), "audit-%u.log", &number) == 1) {
+                last = std::max<uint32_t>(last, number);
+            }
+        }
+        if (last == 0) {
+            return openSegment(1);
+        }
+
+        // Earlier segments were closed cleanly; their sidecar index is authoritative
+        for (uint32_t number = 1; number < last; ++number) {
+            if (std::FILE* file = std::fopen(segmentPath(number, "idx").string().c_str(), "rb")) {
+                IndexEntry entry;
+                while (std::fread(&entry, sizeof(entry), 1, file) == 1) {
+                    addToIndex(entry.regimenHash, entry.timestamp, { number, entry.offset });
+                }
+                std::fclose(file);
+            }
+        }
+
+        // The last segment may end in a torn record: keep the valid prefix and
+        // rebuild its index from the log itself
+        std::vector<IndexEntry> entries;
+        uint64_t validBytes = scanSegment(last, entries);
+        std::filesystem::path logPath = segmentPath(last, "log");
+        if (std::filesystem::file_size(logPath) != validBytes) {
+            std::filesystem::resize_file(logPath, validBytes);
+        }
+        std::FILE* file = std::fopen(segmentPath(last, "idx").string().c_str(), "wb");
+        if (!file) return false;
+        bool written = std::fwrite(entries.data(), sizeof(IndexEntry), entries.size(), file) == entries.size() &&
+            syncFile(file);
+        if (std::fclose(file) != 0 || !written) return false;
+
+        for (const auto& entry : entries) {
+            addToIndex(entry.regimenHash, entry.timestamp, { last, entry.offset });
+        }
+        return openSegment(last);
+    }
+
+    void writerLoop() {
+        std::vector<uint8_t> bytes;
+        std::vector<std::pair<uint64_t, uint64_t>> keys;
+        std::vector<size_t> offsets;
+
+        while (true) {
+            uint64_t batchEnd;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueReady.wait_for(lock, options.commitInterval,
+                    [this] { return stopping || pendingBytes.size() >= options.maxBatchBytes; });
+                if (pendingBytes.empty()) {
+                    if (stopping) return;
+                    continue;
+                }
+                bytes.swap(pendingBytes);
+                keys.swap(pendingKeys);
+                offsets.swap(pendingOffsets);
+                batchEnd = enqueuedCount;
+            }
+
+            bool ok = true;
+            if (segmentSize > 0 && segmentSize + bytes.size() > options.segmentBytes) {
+                ok = openSegment(segmentNumber + 1);
+            }
+
+            std::vector<IndexEntry> entries;
+            for (size_t i = 0; i < keys.size(); ++i) {
+                entries.push_back({ keys[i].first, keys[i].second, segmentSize + offsets[i] });
+            }
+            ok = ok && std::fwrite(bytes.data(), 1, bytes.size(), segmentFile) == bytes.size() &&
+                syncFile(segmentFile) &&
+                std::fwrite(entries.data(), sizeof(IndexEntry), entries.size(), indexFile) == entries.size() &&
+                std::fflush(indexFile) == 0;  // Synced on rollover; the last segment's is rebuilt on recovery
+
+            // The log may now end in a partial batch, which recovery truncates away;
+            // nothing more is written and every waiter learns the append failed
+            if (!ok) {
+                {
+                    std::lock_guard<std::mutex> lock(queueMutex);
+                    failed = true;
+                    pendingBytes.clear();
+                    pendingKeys.clear();
+                    pendingOffsets.clear();
+                }
+                durableReady.notify_all();
+                return;
+            }
+
+            for (const auto& entry : entries) {
+                addToIndex(entry.regimenHash, entry.timestamp, { segmentNumber, entry.offset });
+            }
+            segmentSize += bytes.size();
+            bytes.clear();
+            keys.clear();
+            offsets.clear();
+
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                durableCount = batchEnd;
+            }
+            durableReady.notify_all();
+        }
+    }
+
+    bool readRecord(Location location, AuditRecord& record) const {
+        std::FILE* file = std::fopen(segmentPath(location.segment, "log").string().c_str(), "rb");
+        if (!file) return false;
+
+        uint32_t header[2];
+        std::vector<uint8_t> payload;
+        bool ok = std::fseek(file, static_cast<long>(location.offset), SEEK_SET) == 0 &&
+            std::fread(header, sizeof(header), 1, file) == 1;
+        if (ok) {
+            payload.resize(header[0]);
+            ok = std::fread(payload.data(), 1, payload.size(), file) == payload.size() &&
+                crc32(payload.data(), payload.size()) == header[1] &&
+                decode(payload.data(), payload.data() + payload.size(), record);
+        }
+        std::fclose(file);
+        return ok;
+    }
+
+public:
+    AuditLog() = default;
+    AuditLog(const AuditLog&) = delete;
+    AuditLog& operator=(const AuditLog&) = delete;
+
+    ~AuditLog() {
+        close();
+    }
+
+    bool open(const std::string& path) {
+        return open(path, Options());
+    }
+
+    bool open(const std::string& path, const Options& logOptions) {
+        directory = path;
+        options = logOptions;
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if (!std::filesystem::is_directory(directory)) return false;
+
+        if (!recover()) {
+            close();
+            return false;
+        }
+
+        writer = std::thread([this] { writerLoop(); });
+        return true;
+    }
+
+    // Encodes the record into the current batch and returns its sequence number,
+    // or 0 once a write has failed; never waits for disk
+    uint64_t append(const AuditRecord& record) {
+        std::vector<uint8_t> payload;
+        encode(record, payload);
+        uint32_t length = static_cast<uint32_t>(payload.size());
+        uint32_t crc = crc32(payload.data(), payload.size());
+
+        uint64_t sequence;
+        bool wakeWriter;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if (failed) return 0;
+            pendingOffsets.push_back(pendingBytes.size());
+            pendingKeys.push_back({ record.regimenHash, record.timestamp });
+            const uint8_t* lengthBytes = reinterpret_cast<const uint8_t*>(&length);
+            const uint8_t* crcBytes = reinterpret_cast<const uint8_t*>(&crc);
+            pendingBytes.insert(pendingBytes.end(), lengthBytes, lengthBytes + 4);
+            pendingBytes.insert(pendingBytes.end(), crcBytes, crcBytes + 4);
+            pendingBytes.insert(pendingBytes.end(), payload.begin(), payload.end());
+            sequence = ++enqueuedCount;
+            wakeWriter = pendingBytes.size() >= options.maxBatchBytes;
+        }
+        if (wakeWriter) queueReady.notify_one();
+        return sequence;
+    }
+
+    // For callers that must not continue before their record is on disk; false
+    // when it never will be
+    bool waitDurable(uint64_t sequence) {
+        if (sequence == 0) return false;
+        std::unique_lock<std::mutex> lock(queueMutex);
+        durableReady.wait(lock, [&] { return durableCount >= sequence || failed; });
+        return durableCount >= sequence;
+    }
+
+    // Waits for every record appended so far; false when any of them failed
+    bool flush() {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        uint64_t sequence = enqueuedCount;
+        durableReady.wait(lock, [&] { return durableCount >= sequence || failed; });
+        return !failed;
+    }
+
+    void close() {
+        if (writer.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                stopping = true;
+            }
+            queueReady.notify_one();
+            writer.join();
+        }
+        if (segmentFile) {
+            std::fclose(segmentFile);
+            segmentFile = nullptr;
+        }
+        if (indexFile) {
+            syncFile(indexFile);
+            std::fclose(indexFile);
+            indexFile = nullptr;
+        }
+    }
+
+    std::vector<AuditRecord> findByRegimen(const std::vector<std::string>& drugs, const std::string& profile = {}) {
+        std::vector<Location> locations;
+        {
+            std::lock_guard<std::mutex> lock(indexMutex);
+            auto range = byRegimen.equal_range(hashRegimen(drugs, profile));
+            for (auto it = range.first; it != range.second; ++it) {
+                locations.push_back(it->second);
+            }
+        }
+
+        // Drop hash collisions with other regimens
+        std::vector<std::string> wanted = drugs;
+        std::sort(wanted.begin(), wanted.end());
+        std::vector<AuditRecord> records = readAll(locations);
+        std::erase_if(records, [&wanted, &profile](AuditRecord& record) {
+            std::vector<std::string> names = record.drugs;
+            std::sort(names.begin(), names.end());
+            return names != wanted || record.profile != profile;
+        });
+        return records;
+    }
+
+    std::vector<AuditRecord> findByTime(uint64_t fromTimestamp, uint64_t toTimestamp) {
+        std::vector<Location> locations;
+        {
+            std::lock_guard<std::mutex> lock(indexMutex);
+            for (auto it = byTime.lower_bound(fromTimestamp); it != byTime.end() && it->first <= toTimestamp; ++it) {
+                locations.push_back(it->second);
+            }
+        }
+        return readAll(locations);
+    }
+
+private:
+    std::vector<AuditRecord> readAll(std::vector<Location> locations) const {
+        std::sort(locations.begin(), locations.end(), [](const Location& a, const Location& b) {
+            return a.segment != b.segment ? a.segment < b.segment : a.offset < b.offset;
+        });
+        std::vector<AuditRecord> records;
+        for (const auto& location : locations) {
+            AuditRecord record;
+            if (readRecord(location, record)) {
+                records.push_back(std::move(record));
+            }
+        }
+        return records;
+    }
+};
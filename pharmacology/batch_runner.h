@@ -0,0 +1,265 @@
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "audit_log.h"
+#include "columnar_results.h"
+#include "db.h"
+#include "od_db.h"
+#include "pharmacogenomics.h"
+#include "population_stats.h"
+#include "risk_kernel.h"
+
+// Runs the interaction and overdose analyses over a file of regimens, one per line
+// with drug names separated by spaces, and streams the results to a columnar file.
+// The regimen id is the 1-based line number, so results can be joined back to input.
+// A line may start with a "<patient id>:" token; otherwise every line counts as its
+// own patient in the population statistics. With a PharmacogenomicCache, the
+// next token may be "@<profile>" (see parsePatientProfile) to analyse the regimen
+// for that patient's phenotype.
+class BatchRunner {
+private:
+    DrugDatabase& database;
+    const InteractionAnalyzer& analyzer;
+    const OverdosePotentialDatabase& overdoseDB;
+    CombinationRiskKernel riskKernel;
+    AuditLog* auditLog = nullptr;
+    uint64_t catalogVersion = 0;
+    PharmacogenomicCache* pharmacogenomics = nullptr;
+    uint64_t progressInterval = 0;
+    std::function<void(uint64_t lines)> progress;
+
+public:
+    struct Summary {
+        size_t regimens = 0;
+        size_t skipped = 0;       // Lines without any known drug
+        size_t unknownDrugs = 0;
+        bool complete = true;     // False when the context stopped the run early
+    };
+
+    static constexpr size_t BLOCK_LINES_PER_THREAD = 2048;
+
+private:
+    // What one worker thread produces, plus its scratch state. Consecutive lines
+    // of one profile reuse its tables without a cache lookup.
+    struct Worker {
+        ResultBatch rows;
+        std::vector<AuditRecord> auditRecords;
+        std::unique_ptr<PopulationAggregator> aggregator;
+        Summary summary;
+
+        std::string drugName;
+        std::vector<Drug> drugs;
+        std::vector<std::string> names;
+        std::vector<int> ids;
+        std::string lastProfile;
+        std::string lastProfileName;  // PatientProfile::toString() of lastProfile
+        std::shared_ptr<const PhenotypeTables> lastPhenotype;
+    };
+
+    void analyzeLine(const std::string& line, uint64_t regimenId, Worker& worker) {
+        std::string& drugName = worker.drugName;
+        worker.drugs.clear();
+        worker.names.clear();
+        worker.ids.clear();
+
+        std::istringstream iss(line);
+        uint64_t patientHash = linePatientHash(line, regimenId);
+        if (!(iss >> drugName && drugName.back() == ':')) {
+            iss.clear();
+            iss.seekg(0);
+        }
+
+        std::shared_ptr<const PhenotypeTables> phenotype;
+        std::string_view profileName;
+        std::streampos afterPatient = iss.tellg();
+        if (pharmacogenomics && iss >> drugName && drugName[0] == '@') {
+            PatientProfile profile;
+            if (drugName == worker.lastProfile) {
+                phenotype = worker.lastPhenotype;
+                profileName = worker.lastProfileName;
+            }
+            else if (parsePatientProfile(drugName.substr(1), profile)) {
+                phenotype = pharmacogenomics->getTables(profile);
+                worker.lastProfile = drugName;
+                worker.lastProfileName = profile.toString();
+                worker.lastPhenotype = phenotype;
+                profileName = worker.lastProfileName;
+            }
+            else {
+                ++worker.summary.unknownDrugs;
+            }
+        }
+        else {
+            iss.clear();
+            iss.seekg(afterPatient);
+        }
+
+        while (iss >> drugName) {
+            Drug* drug = database.getDrug(drugName);
+            if (drug) {
+                worker.drugs.push_back(*drug);
+                worker.names.push_back(drugName);
+                worker.ids.push_back(drug->getId());
+            }
+            else {
+                ++worker.summary.unknownDrugs;
+            }
+        }
+
+        if (worker.drugs.empty()) {
+            ++worker.summary.skipped;
+            return;
+        }
+
+        // Same figures the interactive reports show
+        std::vector<InteractionEffect> effects;
+        if (worker.drugs.size() >= 2) {
+            effects = analyzer.analyzeMultipleInteractions(worker.drugs,
+                phenotype ? phenotype->getExposure() : std::span<const float>());
+        }
+        int combinedRisk = 0;
+        if (phenotype) {
+            combinedRisk = (worker.ids.size() == 1)
+                ? phenotype->getOverdosePercentage(worker.ids[0]) : phenotype->combinationRisk(worker.ids);
+        }
+        else {
+            combinedRisk = (worker.names.size() == 1)
+                ? overdoseDB.getOverdosePercentage(worker.names[0]) : riskKernel.score(worker.ids);
+        }
+
+        worker.rows.appendRow(regimenId, worker.ids, effects, combinedRisk);
+        if (worker.aggregator) {
+            worker.aggregator->record(patientHash, worker.ids, effects, combinedRisk);
+        }
+        if (auditLog) {
+            AuditRecord& record = worker.auditRecords.emplace_back();
+            record.timestamp = auditTimestampNow();
+            record.regimenHash = hashRegimen(worker.names, profileName);
+            record.catalogVersion = catalogVersion;
+            record.drugs = worker.names;
+            record.profile = profileName;
+            record.setEffects(std::move(effects), analyzer);
+            record.combinedRisk = combinedRisk;
+            record.pairCount = worker.drugs.size() * (worker.drugs.size() - 1) / 2;
+            record.pairsAnalyzed = record.pairCount;
+        }
+        ++worker.summary.regimens;
+    }
+
+public:
+    BatchRunner(DrugDatabase& db, const InteractionAnalyzer& interactionAnalyzer,
+        const OverdosePotentialDatabase& overdoseDatabase, const CombinationPatterns& patterns)
+        : database(db), analyzer(interactionAnalyzer), overdoseDB(overdoseDatabase),
+        riskKernel(db, overdoseDatabase, patterns) {
+    }
+
+    // Every analyzed regimen is also appended to the audit log
+    void setAuditLog(AuditLog* log, uint64_t version) {
+        auditLog = log;
+        catalogVersion = version;
+    }
+
+    // Patient a regimen line counts for in the population statistics: its
+    // "<patient id>:" token, or else the line itself
+    static uint64_t linePatientHash(const std::string& line, uint64_t regimenId) {
+        std::istringstream iss(line);
+        std::string token;
+        return (iss >> token && token.back() == ':') ? hashString(token) : mixHash(regimenId);
+    }
+
+    // Calls callback with the number of lines analysed so far after the block in
+    // which every interval-th line falls
+    void setProgressCallback(uint64_t interval, std::function<void(uint64_t lines)> callback) {
+        progressInterval = interval;
+        progress = std::move(callback);
+    }
+
+    // Lets regimen lines carry a patient profile
+    void setPharmacogenomics(PharmacogenomicCache* cache) {
+        pharmacogenomics = cache;
+    }
+
+    // Splits the input into blocks of lines that are analysed by `threads` worker
+    // threads, each with its own result rows, audit records and population
+    // statistics. Rows and audit records are emitted in input order, and the
+    // workers' statistics are merged into the aggregator at the end. Stops between
+    // blocks once the context fires; the rows written so far stay valid.
+    Summary run(std::istream& input, ColumnarResultWriter& writer, PopulationAggregator* aggregator = nullptr,
+        uint64_t firstRegimenId = 1, const QueryContext* context = nullptr, size_t threads = 1) {
+        threads = std::max<size_t>(threads, 1);
+        std::vector<Worker> workers(threads);
+        if (aggregator) {
+            for (auto& worker : workers) {
+                worker.aggregator = std::make_unique<PopulationAggregator>(aggregator->emptyLike());
+            }
+        }
+
+        Summary summary;
+        std::vector<std::string> block;
+        uint64_t blockStart = firstRegimenId;
+        uint64_t lines = 0;
+        bool more = true;
+        while (more) {
+            if (context && context->shouldStop()) {
+                summary.complete = false;
+                break;
+            }
+            block.clear();
+            std::string line;
+            while (block.size() < BLOCK_LINES_PER_THREAD * threads && (more = static_cast<bool>(std::getline(input, line)))) {
+                block.push_back(std::move(line));
+            }
+            if (block.empty()) break;
+
+            auto analyzeShare = [&](size_t t) {
+                Worker& worker = workers[t];
+                for (size_t r = block.size() * t / threads; r < block.size() * (t + 1) / threads; ++r) {
+                    analyzeLine(block[r], blockStart + r, worker);
+                }
+            };
+            if (threads == 1) {
+                analyzeShare(0);
+            }
+            else {
+                std::vector<std::thread> pool;
+                for (size_t t = 0; t < threads; ++t) {
+                    pool.emplace_back(analyzeShare, t);
+                }
+                for (auto& thread : pool) {
+                    thread.join();
+                }
+            }
+
+            for (auto& worker : workers) {
+                writer.appendBatch(worker.rows);
+                worker.rows.clear();
+                for (const auto& record : worker.auditRecords) {
+                    auditLog->append(record);
+                }
+                worker.auditRecords.clear();
+            }
+
+            uint64_t before = lines;
+            lines += block.size();
+            blockStart += block.size();
+            if (progress && progressInterval > 0 && lines / progressInterval != before / progressInterval) {
+                progress(lines);
+            }
+        }
+
+        for (auto& worker : workers) {
+            summary.regimens += worker.summary.regimens;
+            summary.skipped += worker.summary.skipped;
+            summary.unknownDrugs += worker.summary.unknownDrugs;
+            if (aggregator) aggregator->merge(*worker.aggregator);
+        }
+        return summary;
+    }
+};
@@ -0,0 +1,335 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catalog_file.h"
+
+// The tables one assessment reads
+struct CatalogView {
+    const DrugDatabase& database;
+    const InteractionAnalyzer& analyzer;
+    const OverdosePotentialDatabase& overdoseDB;
+    const CombinationPatterns& patterns;
+};
+
+// A catalog built from the built-in data plus catalog files, for comparing
+// against the one a program runs with
+struct CatalogVersion {
+    DrugDatabase database;
+    InteractionAnalyzer analyzer;
+    OverdosePotentialDatabase overdoseDB;
+    CombinationPatterns patterns{ database };
+
+    bool load(const std::vector<std::string>& catalogPaths, std::string& error) {
+        for (const auto& path : catalogPaths) {
+            if (!loadCatalogFile(path, database, overdoseDB, analyzer, error)) return false;
+        }
+        return true;
+    }
+
+    CatalogView view() const { return { database, analyzer, overdoseDB, patterns }; }
+};
+
+struct CatalogDiffSummary {
+    size_t regimens = 0;     // Regimens with at least one known drug
+    size_t skipped = 0;      // Without any affected drug or drug pair
+    size_t changed = 0;      // Reported: at least one of the changes below
+    size_t effectChanges = 0;      // An effect appears in one version only
+    size_t severityChanges = 0;
+    size_t probabilityChanges = 0; // Beyond the threshold
+    size_t riskChanges = 0;        // Beyond the threshold
+
+    void add(const CatalogDiffSummary& other) {
+        regimens += other.regimens;
+        skipped += other.skipped;
+        changed += other.changed;
+        effectChanges += other.effectChanges;
+        severityChanges += other.severityChanges;
+        probabilityChanges += other.probabilityChanges;
+        riskChanges += other.riskChanges;
+    }
+};
+
+// Re-screens a regimen corpus against two catalog versions and reports the
+// regimens whose assessment differs.
+//
+// Before reading the corpus the two versions are compared table by table, with
+// drugs matched by name. A drug is affected when it exists in one version only or
+// its class, pattern features or overdose percentage differ; a class pair when its
+// matrix entry differs; a drug pair when it has an override in either version and
+// its analysis differs. Everything else about an assessment is the same code over
+// the same inputs in both versions, so a regimen with no affected drug, class pair
+// or drug pair is skipped without analysing it, and a one-rule change only costs
+// the regimens that rule can reach.
+class CatalogDiff {
+private:
+    CatalogView before;
+    CatalogView after;
+    std::vector<int> afterIds;                 // By before id, -1 when the drug was removed
+    std::vector<bool> affectedDrugs;           // By before id
+    bool affectedClassPairs[DRUG_CLASS_COUNT][DRUG_CLASS_COUNT] = {};
+    std::vector<uint64_t> affectedDrugPairs;   // Sorted (lower before id << 32 | higher before id)
+
+    static uint64_t pairKey(int drug1, int drug2) {
+        return static_cast<uint64_t>(std::min(drug1, drug2)) << 32 | static_cast<uint32_t>(std::max(drug1, drug2));
+    }
+
+    static bool sameEffects(const CatalogView& view1, std::span<const InteractionEffect> effects1,
+        const CatalogView& view2, std::span<const InteractionEffect> effects2) {
+        if (effects1.size() != effects2.size()) return false;
+        for (size_t k = 0; k < effects1.size(); ++k) {
+            if (effects1[k].effect != effects2[k].effect || effects1[k].severity != effects2[k].severity ||
+                effects1[k].probability != effects2[k].probability ||
+                view1.analyzer.getDescription(effects1[k]) != view2.analyzer.getDescription(effects2[k])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void findAffected() {
+        const DrugDatabase& oldDrugs = before.database;
+        const DrugDatabase& newDrugs = after.database;
+
+        afterIds.assign(oldDrugs.getDrugCount(), -1);
+        affectedDrugs.assign(oldDrugs.getDrugCount(), false);
+        for (size_t id = 0; id < oldDrugs.getDrugCount(); ++id) {
+            const Drug& drug = *oldDrugs.getDrugById(static_cast<int>(id));
+            int newId = newDrugs.getDrugId(drug.getName());
+            afterIds[id] = newId;
+            affectedDrugs[id] = newId < 0 ||
+                newDrugs.getDrugById(newId)->getDrugClass() != drug.getDrugClass() ||
+                after.patterns.getDrugFeatures(newId) != before.patterns.getDrugFeatures(static_cast<int>(id)) ||
+                after.overdoseDB.getOverdosePercentage(drug.getName()) != before.overdoseDB.getOverdosePercentage(drug.getName());
+        }
+
+        for (int a = 0; a < DRUG_CLASS_COUNT; ++a) {
+            for (int b = 0; b < DRUG_CLASS_COUNT; ++b) {
+                DrugClass class1 = static_cast<DrugClass>(a);
+                DrugClass class2 = static_cast<DrugClass>(b);
+                affectedClassPairs[a][b] = !sameEffects(before, before.analyzer.getClassEffects(class1, class2),
+                    after, after.analyzer.getClassEffects(class1, class2));
+            }
+        }
+
+        // Pairs with an override in either version, in before ids; pairs with a drug
+        // that is new in the after version never get this far
+        std::vector<uint64_t> candidates;
+        before.analyzer.getPairOverrides().forEachPair([&](int drug1, int drug2, const InteractionEffect*, size_t) {
+            candidates.push_back(pairKey(drug1, drug2));
+        });
+        std::vector<int> beforeIds(newDrugs.getDrugCount(), -1);
+        for (size_t id = 0; id < afterIds.size(); ++id) {
+            if (afterIds[id] >= 0) beforeIds[afterIds[id]] = static_cast<int>(id);
+        }
+        after.analyzer.getPairOverrides().forEachPair([&](int drug1, int drug2, const InteractionEffect*, size_t) {
+            if (beforeIds[drug1] >= 0 && beforeIds[drug2] >= 0) {
+                candidates.push_back(pairKey(beforeIds[drug1], beforeIds[drug2]));
+            }
+        });
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+        for (uint64_t key : candidates) {
+            int drug1 = static_cast<int>(key >> 32);
+            int drug2 = static_cast<int>(key & 0xffffffff);
+            if (affectedDrugs[drug1] || affectedDrugs[drug2]) continue;
+
+            const Drug& old1 = *oldDrugs.getDrugById(drug1);
+            const Drug& old2 = *oldDrugs.getDrugById(drug2);
+            if (!sameEffects(before, before.analyzer.analyzeInteraction(old1, old2),
+                after, after.analyzer.analyzeInteraction(*newDrugs.getDrugById(afterIds[drug1]),
+                    *newDrugs.getDrugById(afterIds[drug2])))) {
+                affectedDrugPairs.push_back(key);
+            }
+        }
+    }
+
+    // A regimen in before ids, -1 for drugs only the after version knows
+    bool isAffected(const std::vector<int>& drugIds) const {
+        for (size_t i = 0; i < drugIds.size(); ++i) {
+            if (drugIds[i] < 0 || affectedDrugs[drugIds[i]]) return true;
+        }
+        for (size_t i = 0; i < drugIds.size(); ++i) {
+            int class1 = static_cast<int>(before.database.getDrugById(drugIds[i])->getDrugClass());
+            for (size_t j = i + 1; j < drugIds.size(); ++j) {
+                int class2 = static_cast<int>(before.database.getDrugById(drugIds[j])->getDrugClass());
+                if (affectedClassPairs[class1][class2] ||
+                    std::binary_search(affectedDrugPairs.begin(), affectedDrugPairs.end(), pairKey(drugIds[i], drugIds[j]))) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    struct Assessment {
+        std::vector<InteractionEffect> effects;
+        int combinedRisk = 0;
+    };
+
+    static Assessment assess(const CatalogView& view, const std::vector<std::string>& drugNames) {
+        Assessment assessment;
+        std::vector<Drug> drugs;
+        std::vector<std::string> known;
+        for (const auto& name : drugNames) {
+            const Drug* drug = view.database.getDrugById(view.database.getDrugId(name));
+            if (!drug) continue;
+            drugs.push_back(*drug);
+            known.push_back(name);
+        }
+        if (known.empty()) return assessment;
+
+        assessment.effects = view.analyzer.analyzeMultipleInteractions(drugs);
+        assessment.combinedRisk = (known.size() == 1)
+            ? view.overdoseDB.getOverdosePercentage(known[0])
+            : view.overdoseDB.calculateCombinationRisk(known, view.patterns);
+        return assessment;
+    }
+
+    static std::string describeEffect(const InteractionEffect& effect) {
+        return severityToString(effect.severity) + " " +
+            std::to_string(static_cast<int>(std::lround(effect.probability * 100))) + "%";
+    }
+
+    // Appends one line to report and returns true when the versions differ beyond threshold
+    bool compare(const std::vector<std::string>& drugNames, double threshold,
+        std::string& report, CatalogDiffSummary& summary) const {
+        Assessment old = assess(before, drugNames);
+        Assessment now = assess(after, drugNames);
+
+        std::string changes;
+        bool effectChanged = false, severityChanged = false, probabilityChanged = false;
+        if (std::abs(now.combinedRisk - old.combinedRisk) > threshold) {
+            changes += " | risk " + std::to_string(old.combinedRisk) + " -> " + std::to_string(now.combinedRisk);
+            ++summary.riskChanges;
+        }
+
+        // Both lists are ordered by effect
+        size_t i = 0, j = 0;
+        while (i < old.effects.size() || j < now.effects.size()) {
+            bool fromOld = j == now.effects.size() || (i < old.effects.size() && old.effects[i].effect < now.effects[j].effect);
+            bool fromNew = i == old.effects.size() || (j < now.effects.size() && now.effects[j].effect < old.effects[i].effect);
+            if (fromOld) {
+                changes += " | -" + effectToString(old.effects[i].effect) + ": " + describeEffect(old.effects[i]);
+                effectChanged = true;
+                ++i;
+            }
+            else if (fromNew) {
+                changes += " | +" + effectToString(now.effects[j].effect) + ": " + describeEffect(now.effects[j]);
+                effectChanged = true;
+                ++j;
+            }
+            else {
+                bool severity = old.effects[i].severity != now.effects[j].severity;
+                bool probability = std::abs(now.effects[j].probability - old.effects[i].probability) * 100 > threshold;
+                if (severity || probability) {
+                    changes += " | " + effectToString(old.effects[i].effect) + ": " + describeEffect(old.effects[i]) +
+                        " -> " + describeEffect(now.effects[j]);
+                }
+                severityChanged |= severity;
+                probabilityChanged |= probability;
+                ++i;
+                ++j;
+            }
+        }
+        summary.effectChanges += effectChanged;
+        summary.severityChanges += severityChanged;
+        summary.probabilityChanges += probabilityChanged;
+        if (changes.empty()) return false;
+
+        for (size_t k = 0; k < drugNames.size(); ++k) {
+            report += (k ? " " : "") + drugNames[k];
+        }
+        report += changes;
+        report += "\n";
+        return true;
+    }
+
+public:
+    CatalogDiff(const CatalogView& beforeVersion, const CatalogView& afterVersion)
+        : before(beforeVersion), after(afterVersion) {
+        findAffected();
+    }
+
+    size_t getAffectedDrugCount() const { return std::count(affectedDrugs.begin(), affectedDrugs.end(), true); }
+    size_t getAffectedDrugPairCount() const { return affectedDrugPairs.size(); }
+
+    size_t getAffectedClassPairCount() const {
+        size_t count = 0;
+        for (int a = 0; a < DRUG_CLASS_COUNT; ++a) {
+            for (int b = a; b < DRUG_CLASS_COUNT; ++b) {
+                count += affectedClassPairs[a][b];
+            }
+        }
+        return count;
+    }
+
+    // Streams whitespace-separated regimens (unknown names ignored) through both
+    // versions in blocks spread over `threads` threads, writing one line per changed
+    // regimen in corpus order. Probability and risk changes count when they exceed
+    // threshold percentage points.
+    CatalogDiffSummary run(std::istream& input, std::ostream& output, double threshold, size_t threads) const {
+        const size_t BLOCK_REGIMENS = 4096;
+        threads = std::max<size_t>(1, threads);
+        std::vector<std::string> reports(threads);
+        std::vector<CatalogDiffSummary> summaries(threads);
+        std::vector<std::vector<std::string>> block;
+        CatalogDiffSummary total;
+
+        auto compareBlock = [&] {
+            std::vector<std::thread> workers;
+            for (size_t t = 0; t < threads; ++t) {
+                workers.emplace_back([&, t] {
+                    reports[t].clear();
+                    for (size_t r = block.size() * t / threads; r < block.size() * (t + 1) / threads; ++r) {
+                        summaries[t].changed += compare(block[r], threshold, reports[t], summaries[t]);
+                    }
+                });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+            for (const auto& report : reports) {
+                output.write(report.data(), static_cast<std::streamsize>(report.size()));
+            }
+            block.clear();
+        };
+
+        std::string line;
+        std::string drugName;
+        std::vector<int> drugIds;
+        while (std::getline(input, line)) {
+            std::vector<std::string> names;
+            drugIds.clear();
+            std::istringstream iss(line);
+            while (iss >> drugName) {
+                int id = before.database.getDrugId(drugName);
+                if (id < 0 && after.database.getDrugId(drugName) < 0) continue;
+                names.push_back(drugName);
+                drugIds.push_back(id);
+            }
+            if (names.empty()) continue;
+
+            ++total.regimens;
+            if (!isAffected(drugIds)) {
+                ++total.skipped;
+                continue;
+            }
+            block.push_back(std::move(names));
+            if (block.size() == BLOCK_REGIMENS) compareBlock();
+        }
+        if (!block.empty()) compareBlock();
+
+        for (const auto& summary : summaries) {
+            total.add(summary);
+        }
+        return total;
+    }
+};
@@ -0,0 +1,171 @@
+#pragma once
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "od_db.h"
+
+// Reads "<EFFECT> <SEVERITY> <probability> <description>" from the rest of a catalog line
+inline bool parseCatalogEffect(std::istringstream& fields, InteractionAnalyzer& analyzer, InteractionEffect& effect) {
+    std::string effectName, severityName, description;
+    if (!(fields >> effectName >> severityName >> effect.probability) ||
+        !parseSideEffect(effectName, effect.effect) || !parseSeverity(severityName, effect.severity) ||
+        effect.probability < 0.0 || effect.probability > 1.0) {
+        return false;
+    }
+    std::getline(fields >> std::ws, description);
+    while (!description.empty() && std::isspace(static_cast<unsigned char>(description.back()))) {
+        description.pop_back();
+    }
+    if (description.empty()) return false;
+
+    effect.descriptionId = analyzer.internDescription(description);
+    return true;
+}
+
+// Extends or patches the built-in catalog from a text file, one entry per line:
+//
+//   drug <name> <class> <half-life hours> <overdose %> [EFFECT ...]
+//   overdose <drug> <overdose %>
+//   dose <drug> <50% risk dose> <slope> <tolerance shift>
+//   metabolism <drug> <PATHWAY> ...
+//   class <class> <class> <EFFECT> <SEVERITY> <probability> <description>
+//   pair <drug1> <drug2> <EFFECT> <SEVERITY> <probability> <description>
+//
+//   drug fluoxetine Depressant 72 12 NAUSEA DROWSINESS
+//   pair fluoxetine tramadol DEATH_RISK MAJOR 0.35 Serotonin syndrome and seizure risk
+//
+// A drug line adds a drug or replaces one of the same name. The class lines of one
+// class pair together replace its matrix entry, and the pair lines of one drug pair
+// together replace its class matrix entry, in the order given; pairs may name
+// built-in drugs or drugs from earlier lines. Overrides already loaded are kept for
+// the pairs this file does not name, so a patch can change or replace a pair's
+// effects.
+// A dose line gives a drug its own DoseResponse curve, with the dose in typical
+// doses; drugs without one get their class curve, fitted to their overdose %.
+// A metabolism line sets the MetabolicPathway routes patient profiles act on;
+// a drug line clears them, so it goes after the drug's line.
+// Everything after '#' is ignored.
+//
+// Returns false with a message for the first line it cannot use; entries before
+// that line have already been applied.
+inline bool loadCatalogFile(const std::string& path, DrugDatabase& database, OverdosePotentialDatabase& overdoseDB,
+    InteractionAnalyzer& analyzer, std::string& error) {
+    std::ifstream input(path);
+    if (!input) {
+        error = "cannot open catalog '" + path + "'";
+        return false;
+    }
+
+    std::map<std::pair<DrugClass, DrugClass>, std::vector<InteractionEffect>> classEntries;
+    PairOverrideTable::Builder overrides;
+    std::set<std::pair<int, int>> namedPairs;
+
+    std::string line;
+    bool valid = true;
+    int lineNumber = 1;
+    for (; std::getline(input, line); ++lineNumber) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::string kind;
+        if (!(fields >> kind)) continue;
+
+        if (kind == "drug") {
+            std::string name, className;
+            double halfLife = 0.0;
+            int overdosePercent = 0;
+            DrugClass drugClass = DrugClass::OPIOID;
+            valid = static_cast<bool>(fields >> name >> className >> halfLife >> overdosePercent) &&
+                parseDrugClass(className, drugClass) && halfLife > 0.0;
+
+            std::vector<SideEffect> effects;
+            std::string effectName;
+            while (valid && fields >> effectName) {
+                SideEffect effect;
+                valid = parseSideEffect(effectName, effect);
+                if (valid) effects.push_back(effect);
+            }
+            if (!valid) break;
+
+            database.addDrug(name, drugClass, effects, halfLife);
+            database.getDrug(name)->setRespiratoryDepression(
+                std::find(effects.begin(), effects.end(), SideEffect::RESPIRATORY_DEPRESSION) != effects.end());
+            overdoseDB.addCustomDrug(name, overdosePercent);
+        }
+        else if (kind == "overdose") {
+            std::string name;
+            int overdosePercent = 0;
+            valid = static_cast<bool>(fields >> name >> overdosePercent) && database.getDrugId(name) >= 0;
+            if (!valid) break;
+
+            overdoseDB.addCustomDrug(name, overdosePercent);
+        }
+        else if (kind == "dose") {
+            std::string name;
+            DoseResponse response{};
+            valid = static_cast<bool>(fields >> name >> response.midpoint >> response.slope >> response.toleranceShift) &&
+                database.getDrugId(name) >= 0 && overdoseDB.setDoseResponse(name, response);
+            if (!valid) break;
+        }
+        else if (kind == "metabolism") {
+            std::string name, pathwayName;
+            uint8_t pathways = 0;
+            valid = static_cast<bool>(fields >> name) && database.getDrug(name) != nullptr;
+            while (valid && fields >> pathwayName) {
+                MetabolicPathway pathway = CYP2D6_ACTIVATED;
+                valid = parseMetabolicPathway(pathwayName, pathway);
+                pathways |= pathway;
+            }
+            if (!valid) break;
+
+            database.getDrug(name)->setMetabolicPathways(pathways);
+        }
+        else if (kind == "class") {
+            std::string className1, className2;
+            DrugClass class1 = DrugClass::OPIOID, class2 = DrugClass::OPIOID;
+            InteractionEffect effect{};
+            valid = static_cast<bool>(fields >> className1 >> className2) && parseDrugClass(className1, class1) &&
+                parseDrugClass(className2, class2) && parseCatalogEffect(fields, analyzer, effect);
+            if (!valid) break;
+
+            classEntries[std::minmax(class1, class2)].push_back(effect);
+        }
+        else if (kind == "pair") {
+            std::string name1, name2;
+            InteractionEffect effect{};
+            valid = static_cast<bool>(fields >> name1 >> name2) && parseCatalogEffect(fields, analyzer, effect);
+            if (!valid) break;
+
+            int drug1 = database.getDrugId(name1);
+            int drug2 = database.getDrugId(name2);
+            if (!overrides.add(drug1, drug2, effect)) {
+                error = "line " + std::to_string(lineNumber) + ": unknown drug in '" + line + "'";
+                valid = false;
+                break;
+            }
+            namedPairs.insert(std::minmax(drug1, drug2));
+        }
+        else {
+            valid = false;
+            break;
+        }
+    }
+
+    for (const auto& entry : classEntries) {
+        analyzer.setClassEffects(entry.first.first, entry.first.second, entry.second);
+    }
+    analyzer.getPairOverrides().forEachPair([&](int drug1, int drug2, const InteractionEffect* effects, size_t count) {
+        if (namedPairs.count(std::minmax(drug1, drug2))) return;
+        for (size_t k = 0; k < count; ++k) {
+            overrides.add(drug1, drug2, effects[k]);
+        }
+    });
+    analyzer.setPairOverrides(overrides.build());
+    if (!valid && error.empty()) {
+        error = "line " + std::to_string(lineNumber) + ": cannot use '" + line + "'";
+    }
+    return valid;
+}
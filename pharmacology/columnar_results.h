@@ -0,0 +1,392 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "db.h"
+
+// Columnar result file (.phrc) for batch analyses.
+//
+// Buffers follow the Arrow columnar conventions: little-endian primitive arrays,
+// int32 list offsets, every buffer padded to 8 bytes. A file is a header with the
+// drug dictionary followed by independent row groups, so it can be written and
+// read as a stream; a footer with the row group offsets closes the file.
+//
+//   header     "PHRC" | version u16 | effect count u16 | dictionary size u32
+//              | dictionary bytes u32 | name offsets i32[size + 1] | name bytes
+//   row group  "RGRP" | rows u32 | drug values u32 | body bytes u32
+//              | regimenId u64[rows] | drugOffsets i32[rows + 1]
+//              | drugIds i32[drug values] (indices into the dictionary)
+//              | probability f32[rows] per SideEffect
+//              | severity i8[rows] per SideEffect (-1 when the effect is absent)
+//              | overdoseRisk u8[rows]
+//   footer     "PHRF" | row group count u32 | row group offsets u64[count]
+
+constexpr uint16_t COLUMNAR_FORMAT_VERSION = 1;
+constexpr int8_t COLUMNAR_EFFECT_ABSENT = -1;
+
+// Result buffers of one row group. The batch engine writes into these directly and
+// the writer hands them to the file as they are, without another encoding pass.
+struct ResultBatch {
+    std::vector<uint64_t> regimenIds;
+    std::vector<int32_t> drugOffsets{ 0 };
+    std::vector<int32_t> drugIds;
+    std::vector<float> probabilities[SIDE_EFFECT_COUNT];
+    std::vector<int8_t> severities[SIDE_EFFECT_COUNT];
+    std::vector<uint8_t> overdoseRisk;
+
+    size_t rows() const { return regimenIds.size(); }
+
+    void appendRow(uint64_t regimenId, const std::vector<int>& regimenDrugIds,
+        const std::vector<InteractionEffect>& effects, int combinedRisk) {
+        regimenIds.push_back(regimenId);
+        drugIds.insert(drugIds.end(), regimenDrugIds.begin(), regimenDrugIds.end());
+        drugOffsets.push_back(static_cast<int32_t>(drugIds.size()));
+
+        for (int e = 0; e < SIDE_EFFECT_COUNT; ++e) {
+            probabilities[e].push_back(0.0f);
+            severities[e].push_back(COLUMNAR_EFFECT_ABSENT);
+        }
+        for (const auto& effect : effects) {
+            int e = static_cast<int>(effect.effect);
+            probabilities[e].back() = static_cast<float>(effect.probability);
+            severities[e].back() = static_cast<int8_t>(effect.severity);
+        }
+
+        overdoseRisk.push_back(static_cast<uint8_t>(combinedRisk));
+    }
+
+    // Appends rows [first, first + count) of another batch
+    void appendRows(const ResultBatch& other, size_t first, size_t count) {
+        size_t last = first + count;
+        regimenIds.insert(regimenIds.end(), other.regimenIds.begin() + first, other.regimenIds.begin() + last);
+        int32_t shift = static_cast<int32_t>(drugIds.size()) - other.drugOffsets[first];
+        drugIds.insert(drugIds.end(), other.drugIds.begin() + other.drugOffsets[first],
+            other.drugIds.begin() + other.drugOffsets[last]);
+        for (size_t row = first; row < last; ++row) {
+            drugOffsets.push_back(other.drugOffsets[row + 1] + shift);
+        }
+        for (int e = 0; e < SIDE_EFFECT_COUNT; ++e) {
+            probabilities[e].insert(probabilities[e].end(), other.probabilities[e].begin() + first,
+                other.probabilities[e].begin() + last);
+            severities[e].insert(severities[e].end(), other.severities[e].begin() + first,
+                other.severities[e].begin() + last);
+        }
+        overdoseRisk.insert(overdoseRisk.end(), other.overdoseRisk.begin() + first, other.overdoseRisk.begin() + last);
+    }
+
+    void clear() {
+        regimenIds.clear();
+        drugOffsets.assign(1, 0);
+        drugIds.clear();
+        for (int e = 0; e < SIDE_EFFECT_COUNT; ++e) {
+            probabilities[e].clear();
+            severities[e].clear();
+        }
+        overdoseRisk.clear();
+    }
+};
+
+class ColumnarResultWriter {
+private:
+    std::ofstream out;
+    uint64_t position = 0;
+    size_t rowGroupSize;
+    ResultBatch current;
+    std::vector<uint64_t> rowGroupOffsets;
+
+    static size_t padding(size_t bytes) {
+        return (8 - bytes % 8) % 8;
+    }
+
+    void writeRaw(const void* data, size_t bytes) {
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        position += bytes;
+    }
+
+    template <typename T>
+    void writeValue(T value) {
+        writeRaw(&value, sizeof(T));
+    }
+
+    // Writes one column buffer followed by its alignment padding
+    template <typename T>
+    void writeBuffer(const std::vector<T>& buffer) {
+        static const char zeros[8] = {};
+        size_t bytes = buffer.size() * sizeof(T);
+        writeRaw(buffer.data(), bytes);
+        writeRaw(zeros, padding(bytes));
+    }
+
+    template <typename T>
+    static size_t bufferBytes(const std::vector<T>& buffer) {
+        size_t bytes = buffer.size() * sizeof(T);
+        return bytes + padding(bytes);
+    }
+
+    void writeRowGroup(const ResultBatch& batch) {
+        size_t bodyBytes = bufferBytes(batch.regimenIds) + bufferBytes(batch.drugOffsets) +
+            bufferBytes(batch.drugIds) + bufferBytes(batch.overdoseRisk);
+        for (int e = 0; e < SIDE_EFFECT_COUNT; ++e) {
+            bodyBytes += bufferBytes(batch.probabilities[e]) + bufferBytes(batch.severities[e]);
+        }
+
+        rowGroupOffsets.push_back(position);
+        writeRaw("RGRP", 4);
+        writeValue(static_cast<uint32_t>(batch.rows()));
+        writeValue(static_cast<uint32_t>(batch.drugIds.size()));
+        writeValue(static_cast<uint32_t>(bodyBytes));
+
+        writeBuffer(batch.regimenIds);
+        writeBuffer(batch.drugOffsets);
+        writeBuffer(batch.drugIds);
+        for (int e = 0; e < SIDE_EFFECT_COUNT; ++e) {
+            writeBuffer(batch.probabilities[e]);
+        }
+        for (int e = 0; e < SIDE_EFFECT_COUNT; ++e) {
+            writeBuffer(batch.severities[e]);
+        }
+        writeBuffer(batch.overdoseRisk);
+    }
+
+public:
+    explicit ColumnarResultWriter(size_t rowsPerGroup = 65536)
+        : rowGroupSize(rowsPerGroup) {
+    }
+
+    bool open(const std::string& path, const DrugDatabase& dictionary) {
+        out.open(path, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+
+        std::vector<int32_t> nameOffsets{ 0 };
+        std::string names;
+        for (size_t id = 0; id < dictionary.getDrugCount(); ++id) {
+            names += dictionary.getDrugById(static_cast<int>(id))->getName();
+            nameOffsets.push_back(static_cast<int32_t>(names.size()));
+        }
+
+        writeRaw("PHRC", 4);
+        writeValue(COLUMNAR_FORMAT_VERSION);
+        writeValue(static_cast<uint16_t>(SIDE_EFFECT_COUNT));
+        writeValue(static_cast<uint32_t>(dictionary.getDrugCount()));
+        writeValue(static_cast<uint32_t>(names.size()));
+        writeBuffer(nameOffsets);
+        writeBuffer(std::vector<char>(names.begin(), names.end()));
+        return static_cast<bool>(out);
+    }
+
+    // Buffer the engine appends the next results to
+    ResultBatch& batch() { return current; }
+
+    // Emits the current row group once it has reached the configured size
+    void commitRows() {
+        if (current.rows() >= rowGroupSize) {
+            writeRowGroup(current);
+            current.clear();
+        }
+    }
+
+    // Appends rows filled elsewhere, e.g. by a worker thread; the row groups come out
+    // as if the rows had been appended one at a time
+    void appendBatch(const ResultBatch& rows) {
+        for (size_t first = 0; first < rows.rows();) {
+            size_t count = std::min(rows.rows() - first, rowGroupSize - current.rows());
+            current.appendRows(rows, first, count);
+            first += count;
+            commitRows();
+        }
+    }
+
+    bool close() {
+        if (current.rows() > 0) {
+            writeRowGroup(current);
+            current.clear();
+        }
+
+        writeRaw("PHRF", 4);
+        writeValue(static_cast<uint32_t>(rowGroupOffsets.size()));
+        writeBuffer(rowGroupOffsets);
+        out.close();
+        return !out.fail();
+    }
+};
+
+// Typed views straight into the file bytes of one row group
+struct RowGroupView {
+    uint32_t rows = 0;
+    const uint64_t* regimenIds = nullptr;
+    const int32_t* drugOffsets = nullptr;
+    const int32_t* drugIds = nullptr;
+    const float* probabilities[SIDE_EFFECT_COUNT] = {};
+    const int8_t* severities[SIDE_EFFECT_COUNT] = {};
+    const uint8_t* overdoseRisk = nullptr;
+};
+
+// Reads a .phrc file in place. The buffers are either loaded into an 8-byte
+// aligned block or supplied by the caller (e.g. a memory-mapped file); no column
+// is copied or decoded.
+class ColumnarResultReader {
+private:
+    std::vector<uint64_t> storage;
+    const char* data = nullptr;
+    size_t size = 0;
+    const int32_t* nameOffsets = nullptr;
+    const char* names = nullptr;
+    uint32_t dictionarySize = 0;
+    std::vector<RowGroupView> rowGroups;
+    bool complete = false;
+
+    static uint64_t padded(uint64_t bytes) {
+        return bytes + (8 - bytes % 8) % 8;
+    }
+
+    // Body size of a row group with these counts, as the writer lays it out
+    static uint64_t rowGroupBodyBytes(uint64_t rows, uint64_t drugValues) {
+        return padded(rows * sizeof(uint64_t)) + padded((rows + 1) * sizeof(int32_t)) +
+            padded(drugValues * sizeof(int32_t)) +
+            SIDE_EFFECT_COUNT * (padded(rows * sizeof(float)) + padded(rows)) + padded(rows);
+    }
+
+    // Offsets and ids are used as indices by every consumer, so they must stay in
+    // range; severities must be absent or a valid InteractionSeverity
+    bool validRowGroup(const RowGroupView& view, uint32_t drugValues) const {
+        if (readValue<int32_t>(view.drugOffsets, 0) != 0 ||
+            readValue<int32_t>(view.drugOffsets, view.rows) != static_cast<int32_t>(drugValues)) {
+            return false;
+        }
+        for (uint32_t row = 0; row < view.rows; ++row) {
+            if (readValue<int32_t>(view.drugOffsets, row) > readValue<int32_t>(view.drugOffsets, row + 1)) return false;
+        }
+        for (uint32_t i = 0; i < drugValues; ++i) {
+            int32_t id = readValue<int32_t>(view.drugIds, i);
+            if (id < 0 || static_cast<uint32_t>(id) >= dictionarySize) return false;
+        }
+        for (int e = 0; e < SIDE_EFFECT_COUNT; ++e) {
+            for (uint32_t row = 0; row < view.rows; ++row) {
+                int8_t severity = view.severities[e][row];
+                if (severity < COLUMNAR_EFFECT_ABSENT || severity > static_cast<int8_t>(InteractionSeverity::LETHAL)) return false;
+            }
+        }
+        return true;
+    }
+
+    template <typename T>
+    T readValue(size_t offset) const {
+        T value;
+        std::memcpy(&value, data + offset, sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    static T readValue(const T* array, size_t index) {
+        T value;
+        std::memcpy(&value, array + index, sizeof(T));
+        return value;
+    }
+
+public:
+    bool load(const std::string& path) {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in) return false;
+
+        size_t bytes = static_cast<size_t>(in.tellg());
+        storage.assign((bytes + 7) / 8, 0);
+        in.seekg(0);
+        in.read(reinterpret_cast<char*>(storage.data()), static_cast<std::streamsize>(bytes));
+        return in && attach(storage.data(), bytes);
+    }
+
+    // Indexes the row groups of a file image; stops at the footer or at a
+    // truncated row group, so a file that is still being written can be read.
+    // Every extent and index in the header and the row groups read so far is
+    // checked against the image, and any mismatch rejects the file.
+    bool attach(const void* image, size_t bytes) {
+        data = static_cast<const char*>(image);
+        size = bytes;
+        rowGroups.clear();
+        complete = false;
+
+        if (size < 16 || std::memcmp(data, "PHRC", 4) != 0 ||
+            readValue<uint16_t>(4) != COLUMNAR_FORMAT_VERSION ||
+            readValue<uint16_t>(6) != SIDE_EFFECT_COUNT) {
+            return false;
+        }
+
+        dictionarySize = readValue<uint32_t>(8);
+        uint32_t nameBytes = readValue<uint32_t>(12);
+        uint64_t offset = 16;
+        if (padded((uint64_t(dictionarySize) + 1) * sizeof(int32_t)) + padded(nameBytes) > size - offset) {
+            return false;
+        }
+        nameOffsets = reinterpret_cast<const int32_t*>(data + offset);
+        offset += padded((uint64_t(dictionarySize) + 1) * sizeof(int32_t));
+        names = data + offset;
+        offset += padded(nameBytes);
+
+        if (readValue<int32_t>(nameOffsets, 0) != 0 ||
+            readValue<int32_t>(nameOffsets, dictionarySize) != static_cast<int32_t>(nameBytes)) {
+            return false;
+        }
+        for (uint32_t id = 0; id < dictionarySize; ++id) {
+            if (readValue<int32_t>(nameOffsets, id) > readValue<int32_t>(nameOffsets, id + 1)) return false;
+        }
+
+        while (offset + 16 <= size && std::memcmp(data + offset, "RGRP", 4) == 0) {
+            uint32_t bodyBytes = readValue<uint32_t>(offset + 12);
+            if (bodyBytes > size - offset - 16) break;
+
+            RowGroupView view;
+            view.rows = readValue<uint32_t>(offset + 4);
+            uint32_t drugValues = readValue<uint32_t>(offset + 8);
+            if (rowGroupBodyBytes(view.rows, drugValues) != bodyBytes) return false;
+            const char* cursor = data + offset + 16;
+
+            view.regimenIds = reinterpret_cast<const uint64_t*>(cursor);
+            cursor += padded(view.rows * sizeof(uint64_t));
+            view.drugOffsets = reinterpret_cast<const int32_t*>(cursor);
+            cursor += padded((view.rows + 1) * sizeof(int32_t));
+            view.drugIds = reinterpret_cast<const int32_t*>(cursor);
+            cursor += padded(drugValues * sizeof(int32_t));
+            for (int e = 0; e < SIDE_EFFECT_COUNT; ++e) {
+                view.probabilities[e] = reinterpret_cast<const float*>(cursor);
+                cursor += padded(view.rows * sizeof(float));
+            }
+            for (int e = 0; e < SIDE_EFFECT_COUNT; ++e) {
+                view.severities[e] = reinterpret_cast<const int8_t*>(cursor);
+                cursor += padded(view.rows);
+            }
+            view.overdoseRisk = reinterpret_cast<const uint8_t*>(cursor);
+            if (!validRowGroup(view, drugValues)) return false;
+
+            rowGroups.push_back(view);
+            offset += 16 + bodyBytes;
+        }
+
+        // Anything after the row groups must be a footer that lists all of them
+        if (offset + 8 <= size && std::memcmp(data + offset, "PHRF", 4) == 0) {
+            uint32_t footerGroups = readValue<uint32_t>(offset + 4);
+            if (footerGroups != rowGroups.size() || padded(uint64_t(footerGroups) * sizeof(uint64_t)) > size - offset - 8) {
+                return false;
+            }
+            complete = true;
+        }
+        return true;
+    }
+
+    // True when the file ends in its footer, i.e. the writer closed it
+    bool isComplete() const { return complete; }
+
+    size_t getDrugCount() const { return dictionarySize; }
+
+    std::string_view getDrugName(int32_t id) const {
+        return std::string_view(names + nameOffsets[id],
+            static_cast<size_t>(nameOffsets[id + 1] - nameOffsets[id]));
+    }
+
+    size_t getRowGroupCount() const { return rowGroups.size(); }
+    const RowGroupView& getRowGroup(size_t index) const { return rowGroups[index]; }
+};
@@ -0,0 +1,250 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "db.h"
+
+// Regimen-level danger patterns over drug classes, primary effects and named drug
+// groups.
+//
+// Every drug has a 64-bit feature mask; a regimen's mask is the OR over its drugs
+// plus one bit per drug-count threshold ("at least n drugs with any of these
+// features") that it reaches. A pattern is a conjunction of clauses, each a
+// popcount bound on the regimen mask under a selector, so checking a pattern is
+// a few AND/POPCNT/compare instructions:
+//
+//   all(opioid | benzodiazepine)              both classes present
+//   any(stimulant), any(depressants)          a stimulant and any depressant
+//   atLeast(2, opioid | benzo | alcohol)      two of the three classes
+//   any(drugCount(respiratoryDepression, 3))  three respiratory depressant drugs
+//
+// The masks follow DrugDatabase::addDrug.
+class CombinationPatterns {
+public:
+    static constexpr int CLASS_SHIFT = 0;    // Bit per DrugClass
+    static constexpr int EFFECT_SHIFT = 16;  // Bit per primary SideEffect
+    static constexpr int GROUP_SHIFT = 32;   // Bit per drug group
+    static constexpr int COUNT_SHIFT = 48;   // Bit per drug-count threshold
+    static constexpr int MAX_GROUPS = 16;
+    static constexpr int MAX_COUNTS = 16;
+    static constexpr int MAX_PATTERNS = 32;
+
+    // Ids of the patterns every instance starts with
+    enum StandardPattern {
+        LETHAL_COMBINATION,  // Two or more of opioid, benzodiazepine, alcohol
+        SPEEDBALL            // A potent stimulant with any depressant
+    };
+
+    // Holds when atLeast <= popcount(regimen mask & features) <= atMost
+    struct Clause {
+        uint64_t features;
+        uint8_t atLeast;
+        uint8_t atMost;
+    };
+
+    static uint64_t classFeature(DrugClass drugClass) {
+        return uint64_t(1) << (CLASS_SHIFT + static_cast<int>(drugClass));
+    }
+
+    static uint64_t effectFeature(SideEffect effect) {
+        return uint64_t(1) << (EFFECT_SHIFT + static_cast<int>(effect));
+    }
+
+    static Clause all(uint64_t features) {
+        return { features, static_cast<uint8_t>(std::popcount(features)), 64 };
+    }
+    static Clause any(uint64_t features) { return { features, 1, 64 }; }
+    static Clause none(uint64_t features) { return { features, 0, 0 }; }
+    static Clause atLeast(int count, uint64_t features) { return { features, static_cast<uint8_t>(count), 64 }; }
+
+    // The bits of value selected by selector, packed towards bit 0 (as BMI2 pext)
+    static uint64_t extractFeatures(uint64_t value, uint64_t selector) {
+        uint64_t packed = 0;
+        int position = 0;
+        for (; selector != 0; selector &= selector - 1) {
+            if (value & selector & (~selector + 1)) packed |= uint64_t(1) << position;
+            ++position;
+        }
+        return packed;
+    }
+
+    // Inverse of extractFeatures (as BMI2 pdep)
+    static uint64_t depositFeatures(uint64_t packed, uint64_t selector) {
+        uint64_t value = 0;
+        for (; selector != 0; selector &= selector - 1) {
+            if (packed & 1) value |= selector & (~selector + 1);
+            packed >>= 1;
+        }
+        return value;
+    }
+
+    // Union of the features a pattern's clauses select
+    uint64_t getPatternSelector(int pattern) const {
+        uint64_t selector = 0;
+        for (const auto& clause : getClauses(pattern)) {
+            selector |= clause.features;
+        }
+        return selector;
+    }
+
+private:
+    struct Group {
+        std::string name;
+        std::vector<std::string> drugs;
+    };
+
+    struct CountThreshold {
+        uint64_t features;
+        int atLeast;
+    };
+
+    struct Pattern {
+        std::string name;
+        uint32_t firstClause;
+        uint32_t clauseCount;
+    };
+
+    DrugDatabase& database;
+    std::vector<uint64_t> drugFeatures;  // By catalog id
+    std::vector<Group> groups;
+    std::vector<CountThreshold> counts;
+    std::vector<Clause> clauses;
+    std::vector<Pattern> patterns;
+    int listenerHandle;
+
+    uint64_t computeFeatures(const Drug& drug) const {
+        uint64_t features = classFeature(drug.getDrugClass());
+        for (SideEffect effect : drug.getPrimaryEffects()) {
+            features |= effectFeature(effect);
+        }
+        for (size_t g = 0; g < groups.size(); ++g) {
+            for (const auto& name : groups[g].drugs) {
+                if (std::string_view(name) == drug.getName()) features |= uint64_t(1) << (GROUP_SHIFT + g);
+            }
+        }
+        return features;
+    }
+
+    void onDrugAdded(const Drug& drug) {
+        if (drug.getId() >= static_cast<int>(drugFeatures.size())) {
+            drugFeatures.resize(drug.getId() + 1);
+        }
+        drugFeatures[drug.getId()] = computeFeatures(drug);
+    }
+
+public:
+    explicit CombinationPatterns(DrugDatabase& db) : database(db) {
+        for (size_t id = 0; id < database.getDrugCount(); ++id) {
+            onDrugAdded(*database.getDrugById(static_cast<int>(id)));
+        }
+        listenerHandle = database.addDrugAddedListener([this](const Drug& drug) { onDrugAdded(drug); });
+
+        const uint64_t respiratoryDepressants = classFeature(DrugClass::OPIOID) |
+            classFeature(DrugClass::BENZODIAZEPINE) | classFeature(DrugClass::ALCOHOL);
+        addPattern("lethal combination", { atLeast(2, respiratoryDepressants) });
+        // Caffeine and nicotine are stimulants too, but too mild to mask a depressant overdose
+        const uint64_t potentStimulants = addGroup("potent stimulant", { "cocaine", "methamphetamine",
+            "amphetamine", "dextroamphetamine", "adderall", "ritalin", "methylphenidate", "mdma" });
+        addPattern("speedball", { any(potentStimulants),
+            any(respiratoryDepressants | classFeature(DrugClass::DEPRESSANT)) });
+    }
+
+    CombinationPatterns(const CombinationPatterns&) = delete;
+    CombinationPatterns& operator=(const CombinationPatterns&) = delete;
+
+    ~CombinationPatterns() {
+        database.removeDrugAddedListener(listenerHandle);
+    }
+
+    // Feature of the named drugs, or 0 once MAX_GROUPS groups exist
+    uint64_t addGroup(const std::string& name, const std::vector<std::string>& drugNames) {
+        if (groups.size() >= MAX_GROUPS) return 0;
+        groups.push_back({ name, drugNames });
+        for (size_t id = 0; id < database.getDrugCount(); ++id) {
+            drugFeatures[id] = computeFeatures(*database.getDrugById(static_cast<int>(id)));
+        }
+        return uint64_t(1) << (GROUP_SHIFT + groups.size() - 1);
+    }
+
+    // Regimen feature set when at least `atLeast` drugs have any of the features,
+    // or 0 once MAX_COUNTS thresholds exist
+    uint64_t drugCount(uint64_t features, int atLeast) {
+        for (size_t c = 0; c < counts.size(); ++c) {
+            if (counts[c].features == features && counts[c].atLeast == atLeast) {
+                return uint64_t(1) << (COUNT_SHIFT + c);
+            }
+        }
+        if (counts.size() >= MAX_COUNTS) return 0;
+        counts.push_back({ features, atLeast });
+        return uint64_t(1) << (COUNT_SHIFT + counts.size() - 1);
+    }
+
+    // Pattern id, or -1 once MAX_PATTERNS patterns exist
+    int addPattern(const std::string& name, const std::vector<Clause>& patternClauses) {
+        if (patterns.size() >= MAX_PATTERNS) return -1;
+        patterns.push_back({ name, static_cast<uint32_t>(clauses.size()), static_cast<uint32_t>(patternClauses.size()) });
+        clauses.insert(clauses.end(), patternClauses.begin(), patternClauses.end());
+        return static_cast<int>(patterns.size() - 1);
+    }
+
+    uint64_t getDrugFeatures(int drugId) const { return drugFeatures[drugId]; }
+
+    bool hasDrugCounts() const { return !counts.empty(); }
+
+    uint64_t regimenMask(const int* drugIds, size_t drugCount) const {
+        uint64_t mask = 0;
+        for (size_t i = 0; i < drugCount; ++i) {
+            mask |= drugFeatures[drugIds[i]];
+        }
+        for (size_t c = 0; c < counts.size(); ++c) {
+            int matching = 0;
+            for (size_t i = 0; i < drugCount; ++i) {
+                matching += (drugFeatures[drugIds[i]] & counts[c].features) != 0;
+            }
+            if (matching >= counts[c].atLeast) mask |= uint64_t(1) << (COUNT_SHIFT + c);
+        }
+        return mask;
+    }
+
+    uint64_t regimenMask(const std::vector<int>& drugIds) const {
+        return regimenMask(drugIds.data(), drugIds.size());
+    }
+
+    // Unknown names are ignored
+    uint64_t regimenMask(const std::vector<std::string>& drugNames) const {
+        std::vector<int> ids;
+        for (const auto& name : drugNames) {
+            int id = database.getDrugId(name);
+            if (id >= 0) ids.push_back(id);
+        }
+        return regimenMask(ids);
+    }
+
+    bool matches(uint64_t mask, int pattern) const {
+        const Pattern& p = patterns[pattern];
+        for (uint32_t c = p.firstClause; c < p.firstClause + p.clauseCount; ++c) {
+            int present = std::popcount(mask & clauses[c].features);
+            if (present < clauses[c].atLeast || present > clauses[c].atMost) return false;
+        }
+        return true;
+    }
+
+    // Bit per matching pattern
+    uint32_t matchAll(uint64_t mask) const {
+        uint32_t matched = 0;
+        for (size_t p = 0; p < patterns.size(); ++p) {
+            if (matches(mask, static_cast<int>(p))) matched |= uint32_t(1) << p;
+        }
+        return matched;
+    }
+
+    size_t getPatternCount() const { return patterns.size(); }
+    const std::string& getPatternName(int pattern) const { return patterns[pattern].name; }
+
+    std::vector<Clause> getClauses(int pattern) const {
+        auto first = clauses.begin() + patterns[pattern].firstClause;
+        return std::vector<Clause>(first, first + patterns[pattern].clauseCount);
+    }
+};
@@ -0,0 +1,507 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "db.h"
+#include "od_db.h"
+
+// One consolidated effect of the compact engine
+struct CompactEffect {
+    uint16_t probability;    // Q15, 32768 = 1.0
+    uint16_t descriptionId;  // Same ids as the full analyzer's DescriptionPool
+    uint8_t effect;          // SideEffect
+    uint8_t severity;        // InteractionSeverity
+};
+
+// Read-only, integer-only copy of the catalog and rules for low-memory devices.
+//
+// The image is built once from the full engine (build) and can be saved and
+// loaded as a file, so a device never runs the double-precision setup. Drug names
+// and descriptions live in one text blob addressed by 16-bit offsets; drugs, class
+// matrix entries, rules and rule steps are small records with their fields packed
+// into 16-bit words. Probabilities are Q15 and rule factors Q12, so results are
+// bit-identical on every platform and within PROBABILITY_TOLERANCE of the double
+// path. The drug-specific rules of InteractionAnalyzer are encoded as data in
+// addRules; keep them in sync with modifyEffectsForSpecificDrugs.
+class CompactCatalog {
+public:
+    static constexpr uint16_t Q15_ONE = 32768;
+    static constexpr uint16_t Q12_ONE = 4096;
+    static constexpr double PROBABILITY_TOLERANCE = 1e-3;
+    static constexpr size_t MAX_PAIR_EFFECTS = 16;  // Class effects plus everything rules can append
+
+private:
+    // Drug flags the rules test
+    static constexpr uint8_t FLAG_PCP = 1;
+    static constexpr uint8_t FLAG_OXYCODONE = 2;
+    static constexpr uint8_t FLAG_FENTANYL = 4;
+    static constexpr uint8_t FLAG_CYP_INHIBITOR = 8;
+    static constexpr uint8_t FLAG_ALCOHOL = 16;          // The drug named "alcohol", not the class
+
+    struct PackedDrug {
+        uint16_t nameOffset;
+        uint8_t nameLength;
+        uint8_t drugClass;
+        uint8_t flags;
+        uint8_t overdosePercent;
+        uint8_t riskFeatures;  // The drug's features the SPEEDBALL pattern selects, packed
+    };
+
+    // A CombinationPatterns clause over packed riskFeatures
+    struct PackedClause {
+        uint8_t features;
+        uint8_t atLeast;
+        uint8_t atMost;
+    };
+
+    // effect (4 bits) | severity (2 bits) << 4 in one byte, probability Q15
+    struct PackedEffect {
+        uint16_t probability;
+        uint16_t descriptionId;
+        uint8_t effectSeverity;
+    };
+
+    struct MatrixCell {
+        uint8_t first;  // Into effects
+        uint8_t count;
+    };
+
+    // Applies when one drug has selfFlag and the other has any of otherFlags or is
+    // in any of otherClasses; both zero means any other drug
+    struct PackedRule {
+        uint8_t selfFlag;
+        uint8_t otherFlags;
+        uint16_t otherClasses;  // Bit per DrugClass
+        uint8_t firstStep;
+        uint8_t stepCount;
+    };
+
+    enum StepKind : uint8_t {
+        MODIFY,              // Matching effects: scale, then severity and description actions
+        APPEND,              // Unconditionally add an effect
+        APPEND_IF_MISSING    // Add an effect unless the pair already has it
+    };
+    enum SeverityAction : uint8_t { KEEP_SEVERITY, SET_SEVERITY, BUMP_SEVERITY };
+    enum DescriptionAction : uint8_t { KEEP_DESCRIPTION, SET_DESCRIPTION, CYP_DESCRIPTION };
+
+    // kind (2) | severityAction (2) << 2 | descriptionAction (2) << 4 | severity (2) << 6
+    struct PackedStep {
+        uint8_t control;
+        uint8_t effect;          // APPEND*: the effect added
+        uint16_t effectMask;     // MODIFY: bit per SideEffect
+        uint16_t value;          // MODIFY: Q12 factor; APPEND*: Q15 probability
+        uint16_t descriptionId;
+    };
+
+    std::string text;                     // Drug names, then descriptions
+    std::vector<PackedDrug> drugs;
+    std::vector<uint8_t> nameOrder;       // Drug ids sorted by name
+    std::vector<uint16_t> descriptionOffsets;  // descriptionCount + 1 offsets into text
+    std::vector<uint16_t> cypVariants;    // Description id -> CYP-enhanced id
+    std::vector<PackedEffect> effects;
+    MatrixCell matrix[DRUG_CLASS_COUNT * DRUG_CLASS_COUNT] = {};
+    std::vector<PackedRule> rules;
+    std::vector<PackedStep> steps;
+    std::vector<PackedClause> speedballClauses;
+    uint8_t riskTable[2 * 102] = {};      // [speedball][min(percent sum, 101)]
+
+    static uint16_t toQ15(double probability) {
+        return static_cast<uint16_t>(std::min<long>(Q15_ONE, std::lround(probability * Q15_ONE)));
+    }
+
+    static uint8_t packControl(StepKind kind, SeverityAction severityAction,
+        DescriptionAction descriptionAction, InteractionSeverity severity) {
+        return static_cast<uint8_t>(kind | severityAction << 2 | descriptionAction << 4 |
+            static_cast<int>(severity) << 6);
+    }
+
+    static uint16_t effectBit(SideEffect effect) {
+        return static_cast<uint16_t>(1u << static_cast<int>(effect));
+    }
+
+    static uint16_t classBit(DrugClass drugClass) {
+        return static_cast<uint16_t>(1u << static_cast<int>(drugClass));
+    }
+
+    void addRule(uint8_t selfFlag, uint8_t otherFlags, uint16_t otherClasses, std::initializer_list<PackedStep> ruleSteps) {
+        rules.push_back({ selfFlag, otherFlags, otherClasses, static_cast<uint8_t>(steps.size()),
+            static_cast<uint8_t>(ruleSteps.size()) });
+        steps.insert(steps.end(), ruleSteps.begin(), ruleSteps.end());
+    }
+
+    // modifyEffectsForSpecificDrugs as data, in the same order
+    void addRules(const InteractionAnalyzer::RuleDescriptions& ids) {
+        const uint16_t respDep = effectBit(SideEffect::RESPIRATORY_DEPRESSION);
+        const uint16_t deathRisk = effectBit(SideEffect::DEATH_RISK);
+        auto modify = [](uint16_t mask, double factor, SeverityAction severityAction, InteractionSeverity severity,
+            DescriptionAction descriptionAction, uint32_t descriptionId) {
+            return PackedStep{ packControl(MODIFY, severityAction, descriptionAction, severity), 0, mask,
+                static_cast<uint16_t>(std::lround(factor * Q12_ONE)), static_cast<uint16_t>(descriptionId) };
+        };
+        auto append = [](StepKind kind, SideEffect effect, InteractionSeverity severity, double probability,
+            uint32_t descriptionId) {
+            return PackedStep{ packControl(kind, KEEP_SEVERITY, KEEP_DESCRIPTION, severity),
+                static_cast<uint8_t>(effect), 0, toQ15(probability), static_cast<uint16_t>(descriptionId) };
+        };
+
+        // PCP + oxycodone
+        addRule(FLAG_PCP, FLAG_OXYCODONE, 0, {
+            modify(respDep, 1.8, SET_SEVERITY, InteractionSeverity::LETHAL, SET_DESCRIPTION, ids.pcpOxycodoneRespDep),
+            modify(deathRisk, 2.0, SET_SEVERITY, InteractionSeverity::LETHAL, KEEP_DESCRIPTION, 0),
+            append(APPEND_IF_MISSING, SideEffect::RESPIRATORY_DEPRESSION, InteractionSeverity::LETHAL, 0.75, ids.pcpOxycodoneRespDepAdded),
+            append(APPEND, SideEffect::MANIA, InteractionSeverity::MAJOR, 0.65, ids.pcpOxycodoneMania),
+            append(APPEND_IF_MISSING, SideEffect::DEATH_RISK, InteractionSeverity::LETHAL, 0.55, ids.pcpOxycodoneDeathRisk),
+            append(APPEND, SideEffect::HALLUCINATIONS, InteractionSeverity::MAJOR, 0.85, ids.pcpOxycodoneDissociative)
+            });
+
+        // PCP + any depressant
+        addRule(FLAG_PCP, 0, classBit(DrugClass::DEPRESSANT) | classBit(DrugClass::OPIOID) |
+            classBit(DrugClass::BENZODIAZEPINE) | classBit(DrugClass::ALCOHOL), {
+            modify(respDep, 1.4, SET_SEVERITY, InteractionSeverity::MAJOR, SET_DESCRIPTION, ids.pcpDepressantRespDep),
+            append(APPEND_IF_MISSING, SideEffect::MANIA, InteractionSeverity::MAJOR, 0.45, ids.pcpDepressantMania)
+            });
+
+        // Fentanyl with anything
+        addRule(FLAG_FENTANYL, 0, 0, {
+            modify(respDep | deathRisk, 1.5, BUMP_SEVERITY, InteractionSeverity::MINOR, KEEP_DESCRIPTION, 0)
+            });
+
+        // Oxycodone + CYP inhibitor
+        addRule(FLAG_OXYCODONE, FLAG_CYP_INHIBITOR, 0, {
+            modify(respDep | deathRisk, 1.3, KEEP_SEVERITY, InteractionSeverity::MINOR, CYP_DESCRIPTION, 0)
+            });
+
+        // Oxycodone + alcohol or benzodiazepine
+        addRule(FLAG_OXYCODONE, FLAG_ALCOHOL, classBit(DrugClass::BENZODIAZEPINE), {
+            modify(deathRisk, 1.2, KEEP_SEVERITY, InteractionSeverity::MINOR, KEEP_DESCRIPTION, 0)
+            });
+    }
+
+    bool matchesOther(const PackedRule& rule, const PackedDrug& other) const {
+        if (rule.otherFlags == 0 && rule.otherClasses == 0) return true;
+        return (other.flags & rule.otherFlags) || (rule.otherClasses >> other.drugClass & 1);
+    }
+
+    // Effects of one pair; returns how many were written
+    size_t analyzePair(const PackedDrug& a, const PackedDrug& b, CompactEffect* out) const {
+        const MatrixCell& cell = matrix[a.drugClass * DRUG_CLASS_COUNT + b.drugClass];
+        size_t count = 0;
+        for (size_t k = 0; k < cell.count; ++k) {
+            const PackedEffect& effect = effects[cell.first + k];
+            out[count++] = { effect.probability, effect.descriptionId,
+                static_cast<uint8_t>(effect.effectSeverity & 15), static_cast<uint8_t>(effect.effectSeverity >> 4) };
+        }
+
+        for (const auto& rule : rules) {
+            bool applies = ((a.flags & rule.selfFlag) && matchesOther(rule, b)) ||
+                ((b.flags & rule.selfFlag) && matchesOther(rule, a));
+            if (!applies) continue;
+
+            for (size_t s = rule.firstStep; s < rule.firstStep + rule.stepCount; ++s) {
+                const PackedStep& step = steps[s];
+                StepKind kind = static_cast<StepKind>(step.control & 3);
+                uint8_t severity = static_cast<uint8_t>(step.control >> 6);
+
+                if (kind == MODIFY) {
+                    SeverityAction severityAction = static_cast<SeverityAction>(step.control >> 2 & 3);
+                    DescriptionAction descriptionAction = static_cast<DescriptionAction>(step.control >> 4 & 3);
+                    for (size_t k = 0; k < count; ++k) {
+                        CompactEffect& effect = out[k];
+                        if (!(step.effectMask >> effect.effect & 1)) continue;
+
+                        uint32_t scaled = (static_cast<uint32_t>(effect.probability) * step.value + Q12_ONE / 2) >> 12;
+                        effect.probability = static_cast<uint16_t>(std::min<uint32_t>(scaled, Q15_ONE));
+                        if (severityAction == SET_SEVERITY) effect.severity = severity;
+                        if (severityAction == BUMP_SEVERITY && effect.severity < static_cast<uint8_t>(InteractionSeverity::LETHAL)) ++effect.severity;
+                        if (descriptionAction == SET_DESCRIPTION) effect.descriptionId = step.descriptionId;
+                        if (descriptionAction == CYP_DESCRIPTION && effect.descriptionId < cypVariants.size()) {
+                            effect.descriptionId = cypVariants[effect.descriptionId];
+                        }
+                    }
+                    continue;
+                }
+
+                bool present = false;
+                for (size_t k = 0; k < count && kind == APPEND_IF_MISSING; ++k) {
+                    present = present || out[k].effect == step.effect;
+                }
+                // isConsistent guarantees the room
+                if (!present) {
+                    out[count++] = { step.value, step.descriptionId, step.effect, severity };
+                }
+            }
+        }
+        return count;
+    }
+
+    template <typename T>
+    static void writeVector(std::ofstream& out, const std::vector<T>& values) {
+        uint32_t count = static_cast<uint32_t>(values.size());
+        out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        out.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(count * sizeof(T)));
+    }
+
+    template <typename T>
+    static bool readVector(std::ifstream& in, std::vector<T>& values) {
+        uint32_t count = 0;
+        if (!in.read(reinterpret_cast<char*>(&count), sizeof(count)) || count > (1u << 20)) return false;
+        values.resize(count);
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(count * sizeof(T))));
+    }
+
+    // Every index and offset in the image stays inside its target, and no pair can
+    // collect more than MAX_PAIR_EFFECTS effects from its class cell and every rule's
+    // appends, so a corrupt or hand-made file cannot make analyze or the name
+    // lookups read or write out of bounds
+    bool isConsistent() const {
+        size_t descriptionCount = descriptionOffsets.empty() ? 0 : descriptionOffsets.size() - 1;
+        if (drugs.size() > 256 || nameOrder.size() != drugs.size() || descriptionOffsets.empty() ||
+            cypVariants.size() != descriptionCount) {
+            return false;
+        }
+        for (const auto& drug : drugs) {
+            if (drug.nameOffset + drug.nameLength > text.size() || drug.drugClass >= DRUG_CLASS_COUNT) return false;
+        }
+        for (size_t i = 0; i < nameOrder.size(); ++i) {
+            if (nameOrder[i] >= drugs.size() || (i > 0 && getDrugName(nameOrder[i - 1]) > getDrugName(nameOrder[i]))) return false;
+        }
+        for (size_t d = 0; d < descriptionCount; ++d) {
+            if (descriptionOffsets[d] > descriptionOffsets[d + 1]) return false;
+        }
+        if (descriptionOffsets.back() > text.size()) return false;
+        for (uint16_t variant : cypVariants) {
+            if (variant >= descriptionCount) return false;
+        }
+
+        for (const auto& effect : effects) {
+            if ((effect.effectSeverity & 15) >= SIDE_EFFECT_COUNT ||
+                (effect.effectSeverity >> 4) > static_cast<int>(InteractionSeverity::LETHAL) ||
+                effect.descriptionId >= descriptionCount) {
+                return false;
+            }
+        }
+        size_t appended = 0;
+        for (const auto& rule : rules) {
+            if (rule.firstStep + rule.stepCount > steps.size()) return false;
+            for (size_t s = rule.firstStep; s < rule.firstStep + rule.stepCount; ++s) {
+                if ((steps[s].control & 3) != MODIFY) ++appended;
+            }
+        }
+        for (const auto& cell : matrix) {
+            if (cell.first + cell.count > effects.size() || cell.count + appended > MAX_PAIR_EFFECTS) return false;
+        }
+        for (const auto& step : steps) {
+            StepKind kind = static_cast<StepKind>(step.control & 3);
+            if (kind > APPEND_IF_MISSING || (step.control >> 2 & 3) > BUMP_SEVERITY ||
+                (step.control >> 4 & 3) > CYP_DESCRIPTION || step.descriptionId >= descriptionCount) {
+                return false;
+            }
+            if (kind != MODIFY && (step.effect >= SIDE_EFFECT_COUNT || step.value > Q15_ONE)) return false;
+        }
+        return true;
+    }
+
+public:
+    // Returns false when the catalog does not fit the 8- and 16-bit fields, a class
+    // cell plus the rules' appends exceeds MAX_PAIR_EFFECTS, the SPEEDBALL pattern
+    // selects more than 8 features or uses drug-count thresholds, or the analyzer
+    // has drug-pair overrides (the image only stores class entries)
+    bool build(const DrugDatabase& database, const InteractionAnalyzer& analyzer,
+        const OverdosePotentialDatabase& overdoseDB, const CombinationPatterns& patterns) {
+        CompactCatalog& catalog = *this;
+        catalog = CompactCatalog();
+        if (database.getDrugCount() > 256 || !analyzer.getPairOverrides().empty()) return false;
+
+        uint64_t riskSelector = patterns.getPatternSelector(CombinationPatterns::SPEEDBALL);
+        if (std::popcount(riskSelector) > 8 || (riskSelector >> CombinationPatterns::COUNT_SHIFT) != 0) return false;
+        for (const auto& clause : patterns.getClauses(CombinationPatterns::SPEEDBALL)) {
+            catalog.speedballClauses.push_back({
+                static_cast<uint8_t>(CombinationPatterns::extractFeatures(clause.features, riskSelector)),
+                clause.atLeast, clause.atMost });
+        }
+
+        for (size_t id = 0; id < database.getDrugCount(); ++id) {
+            const Drug& drug = *database.getDrugById(static_cast<int>(id));
+            const std::pmr::string& name = drug.getName();
+            uint8_t flags = 0;
+            if (name == "pcp") flags |= FLAG_PCP;
+            if (name == "oxycodone") flags |= FLAG_OXYCODONE;
+            if (name == "fentanyl") flags |= FLAG_FENTANYL;
+            if (name == "alcohol") flags |= FLAG_ALCOHOL;
+            if (analyzer.isCYPInhibitor(name)) flags |= FLAG_CYP_INHIBITOR;
+
+            if (name.size() > UINT8_MAX) return false;
+            catalog.drugs.push_back({ static_cast<uint16_t>(catalog.text.size()), static_cast<uint8_t>(name.size()),
+                static_cast<uint8_t>(drug.getDrugClass()), flags,
+                static_cast<uint8_t>(overdoseDB.getOverdosePercentage(name)),
+                static_cast<uint8_t>(CombinationPatterns::extractFeatures(patterns.getDrugFeatures(static_cast<int>(id)), riskSelector)) });
+            catalog.text += name;
+            catalog.nameOrder.push_back(static_cast<uint8_t>(id));
+        }
+        std::sort(catalog.nameOrder.begin(), catalog.nameOrder.end(), [&catalog](uint8_t a, uint8_t b) {
+            return catalog.getDrugName(a) < catalog.getDrugName(b);
+        });
+
+        const DescriptionPool& pool = analyzer.getDescriptionPool();
+        for (uint32_t id = 0; id < pool.size(); ++id) {
+            if (catalog.text.size() + pool.get(id).size() > UINT16_MAX || pool.get(id).size() > UINT16_MAX) return false;
+            catalog.descriptionOffsets.push_back(static_cast<uint16_t>(catalog.text.size()));
+            catalog.text += pool.get(id);
+            catalog.cypVariants.push_back(static_cast<uint16_t>(analyzer.getCypEnhancedDescription(id)));
+        }
+        catalog.descriptionOffsets.push_back(static_cast<uint16_t>(catalog.text.size()));
+
+        for (int a = 0; a < DRUG_CLASS_COUNT; ++a) {
+            for (int b = 0; b < DRUG_CLASS_COUNT; ++b) {
+                MatrixCell& cell = catalog.matrix[a * DRUG_CLASS_COUNT + b];
+                cell.first = static_cast<uint8_t>(catalog.effects.size());
+                for (const auto& effect : analyzer.getClassEffects(static_cast<DrugClass>(a), static_cast<DrugClass>(b))) {
+                    catalog.effects.push_back({ toQ15(effect.probability), static_cast<uint16_t>(effect.descriptionId),
+                        static_cast<uint8_t>(static_cast<int>(effect.effect) | static_cast<int>(effect.severity) << 4) });
+                }
+                cell.count = static_cast<uint8_t>(catalog.effects.size() - cell.first);
+                if (catalog.effects.size() > UINT8_MAX) return false;
+            }
+        }
+
+        catalog.addRules(analyzer.getRuleDescriptions());
+
+        for (int sum = 0; sum < 102; ++sum) {
+            catalog.riskTable[sum] = static_cast<uint8_t>(OverdosePotentialDatabase::combinationRiskFromSum(sum, false));
+            catalog.riskTable[102 + sum] = static_cast<uint8_t>(OverdosePotentialDatabase::combinationRiskFromSum(sum, true));
+        }
+        if (!catalog.isConsistent()) {
+            catalog = CompactCatalog();
+            return false;
+        }
+        return true;
+    }
+
+    bool save(const std::string& path) const {
+        std::ofstream out(path, std::ios::binary);
+        out.write("PHC2", 4);
+        writeVector(out, std::vector<char>(text.begin(), text.end()));
+        writeVector(out, drugs);
+        writeVector(out, nameOrder);
+        writeVector(out, descriptionOffsets);
+        writeVector(out, cypVariants);
+        writeVector(out, effects);
+        writeVector(out, rules);
+        writeVector(out, steps);
+        writeVector(out, speedballClauses);
+        out.write(reinterpret_cast<const char*>(matrix), sizeof(matrix));
+        out.write(reinterpret_cast<const char*>(riskTable), sizeof(riskTable));
+        return static_cast<bool>(out);
+    }
+
+    bool load(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        char magic[4];
+        std::vector<char> blob;
+        if (!in.read(magic, 4) || std::string_view(magic, 4) != "PHC2" || !readVector(in, blob) ||
+            !readVector(in, drugs) || !readVector(in, nameOrder) || !readVector(in, descriptionOffsets) ||
+            !readVector(in, cypVariants) || !readVector(in, effects) || !readVector(in, rules) ||
+            !readVector(in, steps) || !readVector(in, speedballClauses) || !in.read(reinterpret_cast<char*>(matrix), sizeof(matrix)) ||
+            !in.read(reinterpret_cast<char*>(riskTable), sizeof(riskTable))) {
+            return false;
+        }
+        text.assign(blob.begin(), blob.end());
+        if (!isConsistent()) {
+            *this = CompactCatalog();
+            return false;
+        }
+        return true;
+    }
+
+    size_t getDrugCount() const { return drugs.size(); }
+
+    // Catalog drug id, or -1 for an unknown name
+    int findDrug(std::string_view name) const {
+        auto it = std::lower_bound(nameOrder.begin(), nameOrder.end(), name,
+            [this](uint8_t id, std::string_view value) { return getDrugName(id) < value; });
+        return (it != nameOrder.end() && getDrugName(*it) == name) ? *it : -1;
+    }
+
+    std::string_view getDrugName(int id) const {
+        return std::string_view(text).substr(drugs[id].nameOffset, drugs[id].nameLength);
+    }
+
+    std::string_view getDescription(uint16_t descriptionId) const {
+        return std::string_view(text).substr(descriptionOffsets[descriptionId],
+            descriptionOffsets[descriptionId + 1] - descriptionOffsets[descriptionId]);
+    }
+
+    // analyzeMultipleInteractions for catalog drug ids, without allocating. Writes at
+    // most SIDE_EFFECT_COUNT effects ordered by SideEffect and returns their count.
+    size_t analyze(const int* drugIds, size_t drugCount, CompactEffect* out) const {
+        // Q16 accumulators: the first occurrence adds 2p, later ones p, which is
+        // consolidateEffects' "p + 0.5 q" without rounding
+        uint32_t accumulated[SIDE_EFFECT_COUNT] = {};
+        CompactEffect consolidated[SIDE_EFFECT_COUNT];
+        bool seen[SIDE_EFFECT_COUNT] = {};
+        CompactEffect pairEffects[MAX_PAIR_EFFECTS];
+
+        for (size_t i = 0; i < drugCount; ++i) {
+            for (size_t j = i + 1; j < drugCount; ++j) {
+                size_t count = analyzePair(drugs[drugIds[i]], drugs[drugIds[j]], pairEffects);
+                for (size_t k = 0; k < count; ++k) {
+                    const CompactEffect& effect = pairEffects[k];
+                    if (!seen[effect.effect]) {
+                        seen[effect.effect] = true;
+                        consolidated[effect.effect] = effect;
+                        accumulated[effect.effect] = 2u * effect.probability;
+                        continue;
+                    }
+                    accumulated[effect.effect] = std::min<uint32_t>(2u * Q15_ONE, accumulated[effect.effect] + effect.probability);
+                    if (effect.severity > consolidated[effect.effect].severity) {
+                        consolidated[effect.effect].severity = effect.severity;
+                        consolidated[effect.effect].descriptionId = effect.descriptionId;
+                    }
+                }
+            }
+        }
+
+        size_t written = 0;
+        for (int e = 0; e < SIDE_EFFECT_COUNT; ++e) {
+            if (!seen[e]) continue;
+            out[written] = consolidated[e];
+            out[written].probability = static_cast<uint16_t>((accumulated[e] + 1) >> 1);
+            ++written;
+        }
+        return written;
+    }
+
+    // calculateCombinationRisk for catalog drug ids
+    int combinationRisk(const int* drugIds, size_t drugCount) const {
+        if (drugCount == 0) return 0;
+        uint32_t percentSum = 0;
+        uint8_t features = 0;
+        for (size_t i = 0; i < drugCount; ++i) {
+            const PackedDrug& drug = drugs[drugIds[i]];
+            percentSum = std::min<uint32_t>(percentSum + drug.overdosePercent, 101);
+            features |= drug.riskFeatures;
+        }
+        bool speedball = true;
+        for (const auto& clause : speedballClauses) {
+            int present = std::popcount(static_cast<unsigned>(features & clause.features));
+            speedball = speedball && present >= clause.atLeast && present <= clause.atMost;
+        }
+        return riskTable[(speedball ? 102 : 0) + percentSum];
+    }
+
+    int getOverdosePercentage(int drugId) const { return drugs[drugId].overdosePercent; }
+
+    // Bytes of catalog data, the engine's whole working set
+    size_t getMemoryBytes() const {
+        return sizeof(*this) + text.capacity() + drugs.capacity() * sizeof(PackedDrug) +
+            nameOrder.capacity() + (descriptionOffsets.capacity() + cypVariants.capacity()) * sizeof(uint16_t) +
+            effects.capacity() * sizeof(PackedEffect) + rules.capacity() * sizeof(PackedRule) +
+            steps.capacity() * sizeof(PackedStep) + speedballClauses.capacity() * sizeof(PackedClause);
+    }
+};
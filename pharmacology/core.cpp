@@ -5,6 +5,8 @@
 #include <algorithm>
 #include <memory>
 #include <set>
+#include <cstdint>
+#include <cctype>
 
 enum class DrugClass {
     OPIOID,
@@ -30,6 +32,21 @@ enum class SideEffect {
     HALLUCINATIONS
 };
 
+constexpr int DRUG_CLASS_COUNT = static_cast<int>(DrugClass::SYNTHETIC) + 1;
+constexpr int SIDE_EFFECT_COUNT = static_cast<int>(SideEffect::HALLUCINATIONS) + 1;
+
+// Elimination routes a patient's phenotype can slow down or speed up; a drug's
+// routes are a mask of these bits
+enum MetabolicPathway : uint8_t {
+    CYP2D6_ACTIVATED = 1 << 0,  // Prodrug turned into its active form by CYP2D6
+    CYP2D6_CLEARED = 1 << 1,
+    CYP3A4_CLEARED = 1 << 2,
+    HEPATIC_CLEARED = 1 << 3,
+    RENAL_CLEARED = 1 << 4
+};
+
+constexpr int METABOLIC_PATHWAY_COUNT = 5;
+
 enum class InteractionSeverity {
     MINOR,
     MODERATE,
@@ -66,5 +83,106 @@ struct InteractionEffect {
     SideEffect effect;
     InteractionSeverity severity;
     double probability;
-    std::string description;
-};
\ No newline at end of file
+    uint32_t descriptionId;  // Id in the analyzer's DescriptionPool
+};
+
+inline std::string severityToString(InteractionSeverity severity) {
+    switch (severity) {
+    case InteractionSeverity::MINOR: return "MINOR";
+    case InteractionSeverity::MODERATE: return "MODERATE";
+    case InteractionSeverity::MAJOR: return "MAJOR";
+    case InteractionSeverity::LETHAL: return "LETHAL";
+    default: return "UNKNOWN";
+    }
+}
+
+inline std::string effectToString(SideEffect effect) {
+    switch (effect) {
+    case SideEffect::DROWSINESS: return "Drowsiness";
+    case SideEffect::RESPIRATORY_DEPRESSION: return "Respiratory Depression";
+    case SideEffect::CARDIAC_ARRHYTHMIA: return "Cardiac Arrhythmia";
+    case SideEffect::TORSADES_DE_POINTES: return "Torsades de Pointes";
+    case SideEffect::NODDING: return "Nodding";
+    case SideEffect::HYPERTHERMIA: return "Hyperthermia";
+    case SideEffect::DEATH_RISK: return "Risk of Death";
+    case SideEffect::NAUSEA: return "Nausea";
+    case SideEffect::HALLUCINATIONS: return "Hallucinations";
+    case SideEffect::MANIA: return "Mania or hypomania";
+    default: return "Unknown Effect";
+    }
+}
+
+inline std::string drugClassToString(DrugClass drugClass) {
+    switch (drugClass) {
+    case DrugClass::OPIOID: return "Opioid";
+    case DrugClass::BENZODIAZEPINE: return "Benzodiazepine";
+    case DrugClass::STIMULANT: return "Stimulant";
+    case DrugClass::ALCOHOL: return "Alcohol";
+    case DrugClass::DEPRESSANT: return "Depressant";
+    case DrugClass::HALLUCINOGEN: return "Hallucinogen";
+    case DrugClass::CANNABIS: return "Cannabis";
+    case DrugClass::INHALANT: return "Inhalant";
+    case DrugClass::SYNTHETIC: return "Synthetic";
+    default: return "Unknown Class";
+    }
+}
+
+// Accepts the enum identifier, e.g. "TORSADES_DE_POINTES" or "death_risk"
+inline bool parseSideEffect(const std::string& text, SideEffect& effect) {
+    static const char* const identifiers[SIDE_EFFECT_COUNT] = {
+        "RESPIRATORY_DEPRESSION", "NODDING", "DROWSINESS", "DEATH_RISK", "CARDIAC_ARRHYTHMIA",
+        "MANIA", "HYPERTHERMIA", "TORSADES_DE_POINTES", "NAUSEA", "HALLUCINATIONS"
+    };
+    std::string upper = text;
+    std::transform(upper.begin(), upper.end(), upper.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+    for (int i = 0; i < SIDE_EFFECT_COUNT; ++i) {
+        if (upper == identifiers[i]) {
+            effect = static_cast<SideEffect>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+inline bool parseSeverity(const std::string& text, InteractionSeverity& severity) {
+    std::string upper = text;
+    std::transform(upper.begin(), upper.end(), upper.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+    for (int i = static_cast<int>(InteractionSeverity::MINOR); i <= static_cast<int>(InteractionSeverity::LETHAL); ++i) {
+        if (upper == severityToString(static_cast<InteractionSeverity>(i))) {
+            severity = static_cast<InteractionSeverity>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Accepts the display name in any case, e.g. "Opioid" or "BENZODIAZEPINE"
+inline bool parseDrugClass(const std::string& text, DrugClass& drugClass) {
+    std::string upper = text;
+    std::transform(upper.begin(), upper.end(), upper.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+    for (int i = 0; i < DRUG_CLASS_COUNT; ++i) {
+        std::string name = drugClassToString(static_cast<DrugClass>(i));
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+        if (upper == name) {
+            drugClass = static_cast<DrugClass>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Accepts the enum identifier, e.g. "CYP3A4_CLEARED" or "renal_cleared"
+inline bool parseMetabolicPathway(const std::string& text, MetabolicPathway& pathway) {
+    static const char* const identifiers[METABOLIC_PATHWAY_COUNT] = {
+        "CYP2D6_ACTIVATED", "CYP2D6_CLEARED", "CYP3A4_CLEARED", "HEPATIC_CLEARED", "RENAL_CLEARED"
+    };
+    std::string upper = text;
+    std::transform(upper.begin(), upper.end(), upper.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+    for (int i = 0; i < METABOLIC_PATHWAY_COUNT; ++i) {
+        if (upper == identifiers[i]) {
+            pathway = static_cast<MetabolicPathway>(1 << i);
+            return true;
+        }
+    }
+    return false;
+}
@@ -1,12 +1,30 @@
 #pragma once
+#include <functional>
+
 #include "drug.h"
+#include "memory_accounting.h"
 
 class DrugDatabase {
 private:
-    std::map<std::string, std::unique_ptr<Drug>> drugs;
+    std::pmr::map<std::pmr::string, Drug, StringKeyLess> drugs;  // Drugs live in the map nodes, which never move
+    std::pmr::vector<Drug*> drugsById;       // Dense ids in insertion order
+    std::map<int, std::function<void(const Drug&)>> drugAddedListeners;
+    int nextListenerId = 0;
     
 public:
-    DrugDatabase() {
+    // Called after every addDrug, including when it replaces a drug under the same id.
+    // Returns a handle for removeDrugAddedListener.
+    int addDrugAddedListener(std::function<void(const Drug&)> listener) {
+        drugAddedListeners.emplace(nextListenerId, std::move(listener));
+        return nextListenerId++;
+    }
+
+    void removeDrugAddedListener(int handle) {
+        drugAddedListeners.erase(handle);
+    }
+
+    explicit DrugDatabase(std::pmr::memory_resource* resource = &memoryAccount(MemorySubsystem::DRUG_DATABASE))
+        : drugs(resource), drugsById(resource) {
         initializeDrugs();
     }
     
@@ -189,46 +207,105 @@ public:
             6.0);
 
         // Set specific properties for respiratory depression
-        drugs["heroin"]->setRespiratoryDepression(true);
-        drugs["fentanyl"]->setRespiratoryDepression(true);
-        drugs["morphine"]->setRespiratoryDepression(true);
-        drugs["oxycodone"]->setRespiratoryDepression(true);
-        drugs["hydrocodone"]->setRespiratoryDepression(true);
-        drugs["methadone"]->setRespiratoryDepression(true);
-        drugs["buprenorphine"]->setRespiratoryDepression(true);
-        drugs["xanax"]->setRespiratoryDepression(true);
-        drugs["ativan"]->setRespiratoryDepression(true);
-        drugs["rohypnol"]->setRespiratoryDepression(true);
-        drugs["midazolam"]->setRespiratoryDepression(true);
-        drugs["alcohol"]->setRespiratoryDepression(true);
-        drugs["barbiturates"]->setRespiratoryDepression(true);
-        drugs["phenobarbital"]->setRespiratoryDepression(true);
-        drugs["secobarbital"]->setRespiratoryDepression(true);
-        drugs["ghb"]->setRespiratoryDepression(true);
-        drugs["quaaludes"]->setRespiratoryDepression(true);
-        drugs["ketamine"]->setRespiratoryDepression(true);
-        drugs["nitrous_oxide"]->setRespiratoryDepression(true);
-        drugs["toluene"]->setRespiratoryDepression(true);
-        drugs["ambien"]->setRespiratoryDepression(true);
-        drugs["soma"]->setRespiratoryDepression(true);
-        drugs["pregabalin"]->setRespiratoryDepression(true);
+        drugs.at("heroin").setRespiratoryDepression(true);
+        drugs.at("fentanyl").setRespiratoryDepression(true);
+        drugs.at("morphine").setRespiratoryDepression(true);
+        drugs.at("oxycodone").setRespiratoryDepression(true);
+        drugs.at("hydrocodone").setRespiratoryDepression(true);
+        drugs.at("methadone").setRespiratoryDepression(true);
+        drugs.at("buprenorphine").setRespiratoryDepression(true);
+        drugs.at("xanax").setRespiratoryDepression(true);
+        drugs.at("ativan").setRespiratoryDepression(true);
+        drugs.at("rohypnol").setRespiratoryDepression(true);
+        drugs.at("midazolam").setRespiratoryDepression(true);
+        drugs.at("alcohol").setRespiratoryDepression(true);
+        drugs.at("barbiturates").setRespiratoryDepression(true);
+        drugs.at("phenobarbital").setRespiratoryDepression(true);
+        drugs.at("secobarbital").setRespiratoryDepression(true);
+        drugs.at("ghb").setRespiratoryDepression(true);
+        drugs.at("quaaludes").setRespiratoryDepression(true);
+        drugs.at("ketamine").setRespiratoryDepression(true);
+        drugs.at("nitrous_oxide").setRespiratoryDepression(true);
+        drugs.at("toluene").setRespiratoryDepression(true);
+        drugs.at("ambien").setRespiratoryDepression(true);
+        drugs.at("soma").setRespiratoryDepression(true);
+        drugs.at("pregabalin").setRespiratoryDepression(true);
+
+        // Elimination routes that patient phenotypes act on
+        drugs.at("heroin").setMetabolicPathways(HEPATIC_CLEARED);
+        drugs.at("morphine").setMetabolicPathways(HEPATIC_CLEARED | RENAL_CLEARED);
+        drugs.at("fentanyl").setMetabolicPathways(CYP3A4_CLEARED | HEPATIC_CLEARED);
+        drugs.at("oxycodone").setMetabolicPathways(CYP3A4_CLEARED | HEPATIC_CLEARED);
+        drugs.at("hydrocodone").setMetabolicPathways(CYP2D6_ACTIVATED | CYP3A4_CLEARED | HEPATIC_CLEARED);
+        drugs.at("codeine").setMetabolicPathways(CYP2D6_ACTIVATED | HEPATIC_CLEARED);
+        drugs.at("tramadol").setMetabolicPathways(CYP2D6_ACTIVATED | CYP3A4_CLEARED | HEPATIC_CLEARED | RENAL_CLEARED);
+        drugs.at("methadone").setMetabolicPathways(CYP3A4_CLEARED | HEPATIC_CLEARED);
+        drugs.at("buprenorphine").setMetabolicPathways(CYP3A4_CLEARED | HEPATIC_CLEARED);
+        drugs.at("xanax").setMetabolicPathways(CYP3A4_CLEARED | HEPATIC_CLEARED);
+        drugs.at("valium").setMetabolicPathways(CYP3A4_CLEARED | HEPATIC_CLEARED);
+        drugs.at("ativan").setMetabolicPathways(HEPATIC_CLEARED);
+        drugs.at("klonopin").setMetabolicPathways(CYP3A4_CLEARED | HEPATIC_CLEARED);
+        drugs.at("rohypnol").setMetabolicPathways(CYP3A4_CLEARED | HEPATIC_CLEARED);
+        drugs.at("midazolam").setMetabolicPathways(CYP3A4_CLEARED | HEPATIC_CLEARED);
+        drugs.at("temazepam").setMetabolicPathways(HEPATIC_CLEARED);
+        drugs.at("cocaine").setMetabolicPathways(HEPATIC_CLEARED);
+        drugs.at("methamphetamine").setMetabolicPathways(CYP2D6_CLEARED | RENAL_CLEARED);
+        drugs.at("amphetamine").setMetabolicPathways(CYP2D6_CLEARED | RENAL_CLEARED);
+        drugs.at("dextroamphetamine").setMetabolicPathways(CYP2D6_CLEARED | RENAL_CLEARED);
+        drugs.at("adderall").setMetabolicPathways(CYP2D6_CLEARED | RENAL_CLEARED);
+        drugs.at("mdma").setMetabolicPathways(CYP2D6_CLEARED | HEPATIC_CLEARED);
+        drugs.at("alcohol").setMetabolicPathways(HEPATIC_CLEARED);
+        drugs.at("phenobarbital").setMetabolicPathways(HEPATIC_CLEARED | RENAL_CLEARED);
+        drugs.at("ketamine").setMetabolicPathways(CYP3A4_CLEARED | HEPATIC_CLEARED);
+        drugs.at("dxm").setMetabolicPathways(CYP2D6_CLEARED | HEPATIC_CLEARED);
+        drugs.at("ambien").setMetabolicPathways(CYP3A4_CLEARED | HEPATIC_CLEARED);
+        drugs.at("soma").setMetabolicPathways(HEPATIC_CLEARED);
+        drugs.at("gabapentin").setMetabolicPathways(RENAL_CLEARED);
+        drugs.at("pregabalin").setMetabolicPathways(RENAL_CLEARED);
     }
 
     
     void addDrug(const std::string& name, DrugClass drugClass, 
                  const std::vector<SideEffect>& effects, double halfLife) {
-        drugs[name] = std::make_unique<Drug>(name, drugClass, effects, halfLife);
+        Drug drug(name, drugClass, effects, halfLife, drugs.get_allocator());
+
+        // Replacing a drug keeps its id so stored results stay valid; it is
+        // assigned in place, so the node and drugsById[id] are reused
+        auto it = drugs.find(name);
+        int id = (it != drugs.end()) ? it->second.getId() : static_cast<int>(drugsById.size());
+        drug.setId(id);
+        if (it != drugs.end()) {
+            it->second = std::move(drug);
+        }
+        else {
+            drugsById.push_back(&drugs.emplace(name, std::move(drug)).first->second);
+        }
+
+        for (const auto& listener : drugAddedListeners) {
+            listener.second(*drugsById[id]);
+        }
     }
     
-    Drug* getDrug(const std::string& name) {
+    Drug* getDrug(std::string_view name) {
         auto it = drugs.find(name);
-        return (it != drugs.end()) ? it->second.get() : nullptr;
+        return (it != drugs.end()) ? &it->second : nullptr;
+    }
+
+    const Drug* getDrugById(int id) const {
+        return (id >= 0 && id < static_cast<int>(drugsById.size())) ? drugsById[id] : nullptr;
     }
+
+    int getDrugId(std::string_view name) const {
+        auto it = drugs.find(name);
+        return (it != drugs.end()) ? it->second.getId() : -1;
+    }
+
+    size_t getDrugCount() const { return drugsById.size(); }
     
     std::vector<std::string> getAllDrugNames() const {
         std::vector<std::string> names;
         for (const auto& pair : drugs) {
-            names.push_back(pair.first);
+            names.emplace_back(pair.first);
         }
         return names;
     }
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "memory_accounting.h"
+
+// Interned store for interaction descriptions. Every distinct text is kept once
+// and effects refer to it by a 32-bit id, so copying an effect never copies text.
+// The pool is filled while the analyzer initializes and may keep growing as
+// catalog files are loaded (InteractionAnalyzer::internDescription), until
+// queries start. It is not thread-safe while it grows; reads are safe once it
+// no longer does.
+class DescriptionPool {
+private:
+    // deque keeps element addresses stable, so the string_view keys stay valid
+    std::pmr::deque<std::pmr::string> texts;
+    std::pmr::unordered_map<std::string_view, uint32_t> ids;
+
+public:
+    explicit DescriptionPool(std::pmr::memory_resource* resource = &memoryAccount(MemorySubsystem::DESCRIPTIONS))
+        : texts(resource), ids(resource) {
+    }
+
+    uint32_t intern(std::string_view text) {
+        auto it = ids.find(text);
+        if (it != ids.end()) {
+            return it->second;
+        }
+
+        uint32_t id = static_cast<uint32_t>(texts.size());
+        texts.emplace_back(text);
+        ids.emplace(texts.back(), id);
+        return id;
+    }
+
+    // Interns "<base><suffix>", used for composed variants of an existing text
+    uint32_t compose(uint32_t baseId, std::string_view suffix) {
+        std::string composed(texts[baseId]);
+        composed += suffix;
+        return intern(composed);
+    }
+
+    const std::pmr::string& get(uint32_t id) const {
+        return texts[id];
+    }
+
+    size_t size() const { return texts.size(); }
+};
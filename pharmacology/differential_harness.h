@@ -0,0 +1,486 @@
+#pragma once
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "population_stats.h"
+#include "reference_engine.h"
+
+// Checks optimized engine paths against the frozen reference implementation.
+//
+// Regimens are every pair and every triple of the catalog (every pair override on
+// catalogs too large for that) plus random larger sets (drawn with replacement, so
+// duplicates are covered too). Each registered path is
+// compared field by field with the reference and timed over the same regimens, so
+// every fast path comes with a measured speedup and a pass/fail verdict.
+class DifferentialHarness {
+public:
+    struct Options {
+        double probabilityTolerance = 1e-9;
+        int riskTolerance = 0;
+        size_t randomRegimens = 20000;
+        size_t minRandomSize = 4;
+        size_t maxRandomSize = 24;
+        size_t largeRegimens = 500;     // Long-term-care sized regimens
+        size_t minLargeSize = 40;
+        size_t maxLargeSize = 150;
+        size_t exhaustiveDrugLimit = 128;  // Larger catalogs only get their override pairs checked exhaustively
+        uint32_t seed = 12345;
+        size_t maxReportedMismatches = 5;
+    };
+
+    using InteractionPath = std::function<std::vector<InteractionEffect>(const std::vector<Drug>&)>;
+    using RiskPath = std::function<int(const std::vector<std::string>&)>;
+    using ScreenPath = std::function<int(const std::vector<Drug>&)>;  // Worst severity, -1 for none
+    // Analysis with its pairs split across the given number of threads
+    using ReductionPath = std::function<std::vector<InteractionEffect>(const std::vector<Drug>&, size_t)>;
+    // Scores all regimens at once, given as catalog drug ids in CSR form
+    using BatchRiskPath = std::function<void(const std::vector<int32_t>& offsets,
+        const std::vector<int32_t>& drugIds, std::vector<uint8_t>& risks)>;
+
+private:
+    struct InteractionCandidate {
+        std::string name;
+        InteractionPath path;
+        double tolerance;
+    };
+
+    struct RiskCandidate {
+        std::string name;
+        RiskPath path;
+        int tolerance;
+    };
+
+    struct BatchRiskCandidate {
+        std::string name;
+        BatchRiskPath path;
+        int tolerance;
+    };
+
+    struct ScreenCandidate {
+        std::string name;
+        ScreenPath path;
+    };
+
+    struct ReductionCandidate {
+        std::string name;
+        ReductionPath path;
+    };
+
+    const DrugDatabase& database;
+    const InteractionAnalyzer& analyzer;
+    ReferenceInteractionAnalyzer referenceAnalyzer;
+    ReferenceOverdoseModel referenceRisk;
+    Options options;
+    std::vector<InteractionCandidate> interactionCandidates;
+    std::vector<RiskCandidate> riskCandidates;
+    std::vector<BatchRiskCandidate> batchRiskCandidates;
+    std::vector<ScreenCandidate> screenCandidates;
+    std::vector<ReductionCandidate> reductionCandidates;
+    std::shared_ptr<const InteractionScreen> populationScreen;
+
+    std::vector<std::vector<int>> generateRegimens() const {
+        std::vector<std::vector<int>> regimens;
+        int n = static_cast<int>(database.getDrugCount());
+        std::mt19937 rng(options.seed);
+        std::uniform_int_distribution<int> drugDist(0, n - 1);
+
+        if (static_cast<size_t>(n) <= options.exhaustiveDrugLimit) {
+            for (int a = 0; a < n; ++a) {
+                for (int b = a + 1; b < n; ++b) {
+                    regimens.push_back({ a, b });
+                }
+            }
+            for (int a = 0; a < n; ++a) {
+                for (int b = a + 1; b < n; ++b) {
+                    for (int c = b + 1; c < n; ++c) {
+                        regimens.push_back({ a, b, c });
+                    }
+                }
+            }
+        }
+        else {
+            // Every override pair, alone and with a random third drug
+            analyzer.getPairOverrides().forEachPair([&](int a, int b, const InteractionEffect*, size_t) {
+                regimens.push_back({ a, b });
+                regimens.push_back({ a, b, drugDist(rng) });
+            });
+        }
+
+        auto addRandom = [&](size_t count, size_t minSize, size_t maxSize) {
+            std::uniform_int_distribution<size_t> sizeDist(minSize, maxSize);
+            for (size_t r = 0; r < count; ++r) {
+                std::vector<int> regimen(sizeDist(rng));
+                for (int& id : regimen) {
+                    id = drugDist(rng);
+                }
+                regimens.push_back(regimen);
+            }
+        };
+        addRandom(options.randomRegimens, options.minRandomSize, options.maxRandomSize);
+        addRandom(options.largeRegimens, options.minLargeSize, options.maxLargeSize);
+        return regimens;
+    }
+
+    std::string describeRegimen(const std::vector<std::string>& names) const {
+        std::string text;
+        for (size_t i = 0; i < names.size(); ++i) {
+            text += names[i];
+            if (i < names.size() - 1) text += " + ";
+        }
+        return text;
+    }
+
+    // Returns an empty string when both results agree, otherwise what differs
+    std::string compareEffects(const std::vector<ReferenceEffect>& expected,
+        std::vector<InteractionEffect> actual, double tolerance) const {
+        std::sort(actual.begin(), actual.end(),
+            [](const InteractionEffect& a, const InteractionEffect& b) { return a.effect < b.effect; });
+
+        if (expected.size() != actual.size()) {
+            return "effect count " + std::to_string(actual.size()) +
+                ", expected " + std::to_string(expected.size());
+        }
+        for (size_t i = 0; i < expected.size(); ++i) {
+            std::string field = "effect #" + std::to_string(static_cast<int>(expected[i].effect));
+            if (expected[i].effect != actual[i].effect) {
+                return field + " missing";
+            }
+            if (expected[i].severity != actual[i].severity) {
+                return field + " severity " + std::to_string(static_cast<int>(actual[i].severity)) +
+                    ", expected " + std::to_string(static_cast<int>(expected[i].severity));
+            }
+            if (std::abs(expected[i].probability - actual[i].probability) > tolerance) {
+                return field + " probability " + std::to_string(actual[i].probability) +
+                    ", expected " + std::to_string(expected[i].probability);
+            }
+            if (expected[i].description != std::string_view(analyzer.getDescription(actual[i]))) {
+                return field + " description \"" + std::string(analyzer.getDescription(actual[i])) +
+                    "\", expected \"" + expected[i].description + "\"";
+            }
+        }
+        return "";
+    }
+
+    static bool identical(const std::vector<InteractionEffect>& a, const std::vector<InteractionEffect>& b) {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (a[i].effect != b[i].effect || a[i].severity != b[i].severity ||
+                a[i].probability != b[i].probability || a[i].descriptionId != b[i].descriptionId) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Feeds every regimen to one aggregator, and again split into contiguous parts
+    // whose aggregators are merged in order. The exact statistics must be equal;
+    // every LETHAL pair count must stay within its space-saving error of the true count.
+    bool checkPopulationMerge(std::ostream& report, const std::vector<std::vector<int>>& regimens,
+        const std::vector<std::vector<Drug>>& drugSets, const std::vector<int>& risks) const {
+        std::vector<std::vector<InteractionEffect>> effects(regimens.size());
+        std::map<uint64_t, uint64_t> lethalCounts;
+        for (size_t r = 0; r < regimens.size(); ++r) {
+            effects[r] = analyzer.analyzeMultipleInteractions(drugSets[r]);
+            const std::vector<int>& ids = regimens[r];
+            for (size_t i = 0; i < ids.size(); ++i) {
+                for (size_t j = i + 1; j < ids.size(); ++j) {
+                    if (populationScreen->pairAtLeast(ids[i], ids[j], InteractionSeverity::LETHAL)) {
+                        ++lethalCounts[uint64_t(std::min(ids[i], ids[j])) << 32 | uint64_t(std::max(ids[i], ids[j]))];
+                    }
+                }
+            }
+        }
+        auto withinError = [&lethalCounts](const PopulationAggregator& aggregator) {
+            for (const auto& entry : aggregator.topLethalPairs(SIZE_MAX)) {
+                auto it = lethalCounts.find(entry.key);
+                uint64_t actual = it == lethalCounts.end() ? 0 : it->second;
+                if (actual > entry.count || actual + entry.error < entry.count) return false;
+            }
+            return true;
+        };
+
+        PopulationAggregator single(database, populationScreen);
+        for (size_t r = 0; r < regimens.size(); ++r) {
+            single.record(mixHash(r), regimens[r], effects[r], risks[r]);
+        }
+
+        report << "\nPopulation statistics:\n";
+        size_t mismatches = 0;
+        if (!withinError(single)) {
+            ++mismatches;
+            report << "    MISMATCH single pass: LETHAL pair count outside its error\n";
+        }
+        for (size_t parts : { 2, 3, 8 }) {
+            PopulationAggregator merged = single.emptyLike();
+            for (size_t part = 0; part < parts; ++part) {
+                PopulationAggregator partial = single.emptyLike();
+                for (size_t r = regimens.size() * part / parts; r < regimens.size() * (part + 1) / parts; ++r) {
+                    partial.record(mixHash(r), regimens[r], effects[r], risks[r]);
+                }
+                merged.merge(partial);
+            }
+
+            std::string diff;
+            if (!merged.sameCounts(single)) {
+                diff = "statistics differ from a single pass";
+            }
+            else if (!withinError(merged)) {
+                diff = "LETHAL pair count outside its error";
+            }
+            if (diff.empty()) continue;
+            if (++mismatches <= options.maxReportedMismatches) {
+                report << "    MISMATCH " << parts << " parts: " << diff << "\n";
+            }
+        }
+        report << "  PopulationAggregator::merge (2, 3 and 8 parts): " << regimens.size() << " regimens\n";
+        report << "    " << (mismatches == 0 ? "PASS" : "FAIL") << " (" << mismatches << " mismatches)\n";
+        return mismatches == 0;
+    }
+
+    template <typename Fn>
+    static double timeSeconds(Fn&& fn) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    static void printThroughput(std::ostream& report, const std::string& name, size_t count,
+        double seconds, double referenceSeconds) {
+        report << "  " << name << ": " << static_cast<long long>(count / seconds) << " regimens/s";
+        if (referenceSeconds > 0.0) {
+            report << " (" << (referenceSeconds / seconds) << "x reference)";
+        }
+        report << "\n";
+    }
+
+public:
+    DifferentialHarness(const DrugDatabase& db, const InteractionAnalyzer& interactionAnalyzer,
+        const OverdosePotentialDatabase& overdoseDB, const Options& harnessOptions)
+        : database(db), analyzer(interactionAnalyzer), referenceAnalyzer(interactionAnalyzer),
+        referenceRisk(db, overdoseDB), options(harnessOptions) {
+    }
+
+    // A negative tolerance uses Options::probabilityTolerance
+    void addInteractionPath(const std::string& name, InteractionPath path, double tolerance = -1.0) {
+        interactionCandidates.push_back({ name, std::move(path),
+            tolerance < 0.0 ? options.probabilityTolerance : tolerance });
+    }
+
+    // A negative tolerance uses Options::riskTolerance
+    void addRiskPath(const std::string& name, RiskPath path, int tolerance = -1) {
+        riskCandidates.push_back({ name, std::move(path),
+            tolerance < 0 ? options.riskTolerance : tolerance });
+    }
+
+    // A negative tolerance uses Options::riskTolerance
+    void addBatchRiskPath(const std::string& name, BatchRiskPath path, int tolerance = -1) {
+        batchRiskCandidates.push_back({ name, std::move(path),
+            tolerance < 0 ? options.riskTolerance : tolerance });
+    }
+
+    // Screens must report exactly the worst severity of the reference analysis
+    void addScreenPath(const std::string& name, ScreenPath path) {
+        screenCandidates.push_back({ name, std::move(path) });
+    }
+
+    // Order-independent paths have no reference; they must give bit-identical results
+    // for shuffled drug order and, on large regimens, for any thread count
+    void addOrderInvariantPath(const std::string& name, ReductionPath path) {
+        reductionCandidates.push_back({ name, std::move(path) });
+    }
+
+    // Checks that population statistics fed in parts and merged equal a single pass
+    void addPopulationCheck(std::shared_ptr<const InteractionScreen> screen) {
+        populationScreen = std::move(screen);
+    }
+
+    // Runs every registered path; returns true when none of them disagrees with the reference
+    bool run(std::ostream& report) {
+        std::vector<std::vector<int>> regimens = generateRegimens();
+        std::vector<std::vector<Drug>> drugSets;
+        std::vector<std::vector<std::string>> nameSets;
+        for (const auto& regimen : regimens) {
+            std::vector<Drug> drugs;
+            std::vector<std::string> names;
+            for (int id : regimen) {
+                drugs.push_back(*database.getDrugById(id));
+                names.emplace_back(database.getDrugById(id)->getName());
+            }
+            drugSets.push_back(std::move(drugs));
+            nameSets.push_back(std::move(names));
+        }
+
+        report << "=== DIFFERENTIAL CHECK ===\n";
+        report << "Regimens: " << regimens.size() << " (all pairs, all triples, "
+               << options.randomRegimens << " random of size " << options.minRandomSize
+               << "-" << options.maxRandomSize << ", " << options.largeRegimens
+               << " of size " << options.minLargeSize << "-" << options.maxLargeSize << ")\n";
+
+        std::vector<std::vector<ReferenceEffect>> expectedEffects(regimens.size());
+        std::vector<int> expectedRisks(regimens.size());
+        double referenceInteractionSeconds = timeSeconds([&] {
+            for (size_t r = 0; r < regimens.size(); ++r) {
+                expectedEffects[r] = referenceAnalyzer.analyzeMultipleInteractions(drugSets[r]);
+            }
+        });
+        double referenceRiskSeconds = timeSeconds([&] {
+            for (size_t r = 0; r < regimens.size(); ++r) {
+                expectedRisks[r] = referenceRisk.calculateCombinationRisk(nameSets[r]);
+            }
+        });
+
+        bool passed = true;
+
+        report << "\nInteraction analysis:\n";
+        printThroughput(report, "reference", regimens.size(), referenceInteractionSeconds, 0.0);
+        for (const auto& candidate : interactionCandidates) {
+            std::vector<std::vector<InteractionEffect>> actual(regimens.size());
+            double seconds = timeSeconds([&] {
+                for (size_t r = 0; r < regimens.size(); ++r) {
+                    actual[r] = candidate.path(drugSets[r]);
+                }
+            });
+            printThroughput(report, candidate.name, regimens.size(), seconds, referenceInteractionSeconds);
+
+            size_t mismatches = 0;
+            for (size_t r = 0; r < regimens.size(); ++r) {
+                std::string diff = compareEffects(expectedEffects[r], actual[r], candidate.tolerance);
+                if (diff.empty()) continue;
+                if (++mismatches <= options.maxReportedMismatches) {
+                    report << "    MISMATCH " << describeRegimen(nameSets[r]) << ": " << diff << "\n";
+                }
+            }
+            report << "    " << (mismatches == 0 ? "PASS" : "FAIL") << " (" << mismatches
+                   << " mismatches, tolerance " << candidate.tolerance << ")\n";
+            passed = passed && mismatches == 0;
+        }
+
+        report << "\nCombination risk:\n";
+        printThroughput(report, "reference", regimens.size(), referenceRiskSeconds, 0.0);
+        for (const auto& candidate : riskCandidates) {
+            std::vector<int> actual(regimens.size());
+            double seconds = timeSeconds([&] {
+                for (size_t r = 0; r < regimens.size(); ++r) {
+                    actual[r] = candidate.path(nameSets[r]);
+                }
+            });
+            printThroughput(report, candidate.name, regimens.size(), seconds, referenceRiskSeconds);
+
+            size_t mismatches = 0;
+            for (size_t r = 0; r < regimens.size(); ++r) {
+                if (std::abs(actual[r] - expectedRisks[r]) <= candidate.tolerance) continue;
+                if (++mismatches <= options.maxReportedMismatches) {
+                    report << "    MISMATCH " << describeRegimen(nameSets[r]) << ": risk "
+                           << actual[r] << ", expected " << expectedRisks[r] << "\n";
+                }
+            }
+            report << "    " << (mismatches == 0 ? "PASS" : "FAIL") << " (" << mismatches
+                   << " mismatches, tolerance " << candidate.tolerance << ")\n";
+            passed = passed && mismatches == 0;
+        }
+
+        if (!batchRiskCandidates.empty()) {
+            std::vector<int32_t> offsets{ 0 };
+            std::vector<int32_t> drugIds;
+            for (const auto& regimen : regimens) {
+                drugIds.insert(drugIds.end(), regimen.begin(), regimen.end());
+                offsets.push_back(static_cast<int32_t>(drugIds.size()));
+            }
+
+            for (const auto& candidate : batchRiskCandidates) {
+                std::vector<uint8_t> actual(regimens.size());
+                double seconds = timeSeconds([&] { candidate.path(offsets, drugIds, actual); });
+                printThroughput(report, candidate.name, regimens.size(), seconds, referenceRiskSeconds);
+
+                size_t mismatches = 0;
+                for (size_t r = 0; r < regimens.size(); ++r) {
+                    if (std::abs(actual[r] - expectedRisks[r]) <= candidate.tolerance) continue;
+                    if (++mismatches <= options.maxReportedMismatches) {
+                        report << "    MISMATCH " << describeRegimen(nameSets[r]) << ": risk "
+                               << static_cast<int>(actual[r]) << ", expected " << expectedRisks[r] << "\n";
+                    }
+                }
+                report << "    " << (mismatches == 0 ? "PASS" : "FAIL") << " (" << mismatches
+                       << " mismatches, tolerance " << candidate.tolerance << ")\n";
+                passed = passed && mismatches == 0;
+            }
+        }
+
+        report << "\nWorst-severity screen:\n";
+        printThroughput(report, "reference", regimens.size(), referenceInteractionSeconds, 0.0);
+        for (const auto& candidate : screenCandidates) {
+            std::vector<int> actual(regimens.size());
+            double seconds = timeSeconds([&] {
+                for (size_t r = 0; r < regimens.size(); ++r) {
+                    actual[r] = candidate.path(drugSets[r]);
+                }
+            });
+            printThroughput(report, candidate.name, regimens.size(), seconds, referenceInteractionSeconds);
+
+            size_t mismatches = 0;
+            for (size_t r = 0; r < regimens.size(); ++r) {
+                int expected = -1;
+                for (const auto& effect : expectedEffects[r]) {
+                    expected = std::max(expected, static_cast<int>(effect.severity));
+                }
+                if (actual[r] == expected) continue;
+                if (++mismatches <= options.maxReportedMismatches) {
+                    report << "    MISMATCH " << describeRegimen(nameSets[r]) << ": worst severity "
+                           << actual[r] << ", expected " << expected << "\n";
+                }
+            }
+            report << "    " << (mismatches == 0 ? "PASS" : "FAIL") << " (" << mismatches << " mismatches)\n";
+            passed = passed && mismatches == 0;
+        }
+
+        if (!reductionCandidates.empty()) {
+            report << "\nOrder invariance:\n";
+        }
+        std::mt19937 shuffleRng(options.seed);
+        for (const auto& candidate : reductionCandidates) {
+            size_t checked = 0;
+            size_t mismatches = 0;
+            for (size_t r = 0; r < regimens.size(); ++r) {
+                if (drugSets[r].size() < options.minRandomSize) continue;
+                ++checked;
+
+                std::vector<InteractionEffect> expected = candidate.path(drugSets[r], 1);
+                std::vector<Drug> shuffled = drugSets[r];
+                std::shuffle(shuffled.begin(), shuffled.end(), shuffleRng);
+                std::string diff;
+                if (!identical(expected, candidate.path(shuffled, 1))) {
+                    diff = "shuffled order";
+                }
+                if (drugSets[r].size() >= options.minLargeSize) {
+                    for (size_t threads : { 2, 3, 8 }) {
+                        if (diff.empty() && !identical(expected, candidate.path(shuffled, threads))) {
+                            diff = std::to_string(threads) + " threads";
+                        }
+                    }
+                }
+
+                if (diff.empty()) continue;
+                if (++mismatches <= options.maxReportedMismatches) {
+                    report << "    MISMATCH " << describeRegimen(nameSets[r]) << ": differs with " << diff << "\n";
+                }
+            }
+            report << "  " << candidate.name << ": " << checked << " regimens\n";
+            report << "    " << (mismatches == 0 ? "PASS" : "FAIL") << " (" << mismatches << " mismatches)\n";
+            passed = passed && mismatches == 0;
+        }
+
+        if (populationScreen) {
+            passed = checkPopulationMerge(report, regimens, drugSets, expectedRisks) && passed;
+        }
+
+        report << "\nResult: " << (passed ? "PASS" : "FAIL") << "\n";
+        return passed;
+    }
+};
@@ -0,0 +1,301 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "db.h"
+#include "interaction_screen.h"
+
+struct DispensingEvent {
+    uint64_t patientId;
+    int drugId;
+    uint64_t timestamp;  // Seconds
+};
+
+struct StreamAlert {
+    uint64_t patientId;
+    int newDrugId;
+    int activeDrugId;
+    InteractionSeverity severity;
+    uint64_t timestamp;
+};
+
+// Keeps every patient's active regimen from a stream of dispensing events and
+// raises an alert when a newly dispensed drug forms a pair at or above the alert
+// severity with something still active.
+//
+// A drug stays active for a number of half-lives (Drug::getHalfLife) after it was
+// dispensed, so methadone or phenobarbital linger far longer than fentanyl. Patient
+// state is 56 bytes in an open-addressing table; expiry is driven by an hourly
+// timer wheel, so an event only touches its own patient and the wheel slots that
+// came due since the previous event.
+class DispensingStreamEngine {
+public:
+    // Active drugs kept inside a patient's table entry; larger regimens spill the
+    // rest into an overflow block, so no active drug is ever dropped
+    static constexpr int INLINE_DRUGS = 6;
+
+private:
+    struct ActiveDrug {
+        uint32_t expiryMinutes;
+        uint32_t drugId;
+    };
+
+    struct PatientState {
+        uint64_t patientId;
+        uint32_t expiryMinutes[INLINE_DRUGS];
+        uint16_t drugIds[INLINE_DRUGS];
+        uint16_t activeCount;   // 0 marks a free table slot
+        uint32_t overflowBlock; // Index + 1 into overflowBlocks, 0 for none
+    };
+
+    struct TimerEntry {
+        uint64_t patientId;
+        uint32_t expiryMinutes;
+    };
+
+    static constexpr size_t WHEEL_SLOTS = 1024;  // One slot per hour, about six weeks
+    static constexpr uint64_t NO_TICK = UINT64_MAX;
+
+    std::shared_ptr<const InteractionScreen> screen;
+    InteractionSeverity alertSeverity;
+    std::vector<uint32_t> activeMinutes;  // Active window per catalog drug
+
+    std::vector<PatientState> table;
+    size_t patientCount = 0;
+    std::vector<std::vector<ActiveDrug>> overflowBlocks;  // Drugs past INLINE_DRUGS
+    std::vector<uint32_t> freeBlocks;
+    size_t overflowPatients = 0;
+    std::vector<std::vector<TimerEntry>> wheel;
+    uint64_t currentHour = NO_TICK;
+
+    static size_t slotFor(uint64_t patientId, size_t mask) {
+        uint64_t hash = patientId * 0x9e3779b97f4a7c15ULL;
+        return static_cast<size_t>(hash ^ (hash >> 32)) & mask;
+    }
+
+    PatientState* findPatient(uint64_t patientId) {
+        size_t mask = table.size() - 1;
+        for (size_t slot = slotFor(patientId, mask);; slot = (slot + 1) & mask) {
+            PatientState& state = table[slot];
+            if (state.activeCount == 0) return nullptr;
+            if (state.patientId == patientId) return &state;
+        }
+    }
+
+    PatientState& insertPatient(uint64_t patientId) {
+        if ((patientCount + 1) * 10 > table.size() * 7) {
+            grow();
+        }
+        size_t mask = table.size() - 1;
+        size_t slot = slotFor(patientId, mask);
+        while (table[slot].activeCount != 0) {
+            slot = (slot + 1) & mask;
+        }
+        table[slot] = PatientState{};
+        table[slot].patientId = patientId;
+        ++patientCount;
+        return table[slot];
+    }
+
+    // Backward-shift deletion keeps probe sequences intact without tombstones
+    void erasePatient(PatientState& state) {
+        size_t mask = table.size() - 1;
+        size_t hole = static_cast<size_t>(&state - table.data());
+        table[hole].activeCount = 0;
+        --patientCount;
+
+        for (size_t slot = (hole + 1) & mask; table[slot].activeCount != 0; slot = (slot + 1) & mask) {
+            size_t home = slotFor(table[slot].patientId, mask);
+            bool movable = (hole <= slot) ? (home <= hole || home > slot) : (home <= hole && home > slot);
+            if (movable) {
+                table[hole] = table[slot];
+                table[slot].activeCount = 0;
+                hole = slot;
+            }
+        }
+    }
+
+    void grow() {
+        std::vector<PatientState> old(table.size() * 2);
+        old.swap(table);
+        size_t mask = table.size() - 1;
+        for (const auto& state : old) {
+            if (state.activeCount == 0) continue;
+            size_t slot = slotFor(state.patientId, mask);
+            while (table[slot].activeCount != 0) {
+                slot = (slot + 1) & mask;
+            }
+            table[slot] = state;
+        }
+    }
+
+    // Drug index i of a patient lives inline below INLINE_DRUGS and in the
+    // patient's overflow block above it
+    int drugAt(const PatientState& state, int index) const {
+        if (index < INLINE_DRUGS) return state.drugIds[index];
+        return static_cast<int>(overflowBlocks[state.overflowBlock - 1][index - INLINE_DRUGS].drugId);
+    }
+
+    uint32_t& expiryAt(PatientState& state, int index) {
+        if (index < INLINE_DRUGS) return state.expiryMinutes[index];
+        return overflowBlocks[state.overflowBlock - 1][index - INLINE_DRUGS].expiryMinutes;
+    }
+
+    void addDrug(PatientState& state, int drugId, uint32_t expiryMinutes) {
+        if (state.activeCount < INLINE_DRUGS) {
+            state.drugIds[state.activeCount] = static_cast<uint16_t>(drugId);
+            state.expiryMinutes[state.activeCount] = expiryMinutes;
+        }
+        else {
+            if (state.overflowBlock == 0) {
+                if (freeBlocks.empty()) {
+                    overflowBlocks.emplace_back();
+                    freeBlocks.push_back(static_cast<uint32_t>(overflowBlocks.size()));
+                }
+                state.overflowBlock = freeBlocks.back();
+                freeBlocks.pop_back();
+                ++overflowPatients;
+            }
+            overflowBlocks[state.overflowBlock - 1].push_back({ expiryMinutes, static_cast<uint32_t>(drugId) });
+        }
+        ++state.activeCount;
+    }
+
+    void removeDrugAt(PatientState& state, int index) {
+        int last = state.activeCount - 1;
+        if (index < INLINE_DRUGS) {
+            state.drugIds[index] = static_cast<uint16_t>(drugAt(state, last));
+        }
+        else {
+            overflowBlocks[state.overflowBlock - 1][index - INLINE_DRUGS].drugId = static_cast<uint32_t>(drugAt(state, last));
+        }
+        expiryAt(state, index) = expiryAt(state, last);
+
+        --state.activeCount;
+        if (state.overflowBlock != 0) {
+            auto& block = overflowBlocks[state.overflowBlock - 1];
+            block.pop_back();
+            if (block.empty()) {
+                freeBlocks.push_back(state.overflowBlock);
+                state.overflowBlock = 0;
+                --overflowPatients;
+            }
+        }
+    }
+
+    // Drops the drugs that have worn off; returns false when nothing is left
+    bool expireDrugs(PatientState& state, uint32_t nowMinutes) {
+        for (int i = state.activeCount - 1; i >= 0; --i) {
+            if (expiryAt(state, i) <= nowMinutes) {
+                if (state.activeCount == 1) {
+                    erasePatient(state);
+                    return false;
+                }
+                removeDrugAt(state, i);
+            }
+        }
+        return true;
+    }
+
+    // Never into the current hour's slot, which advanceTo has already passed and
+    // would otherwise only revisit after a full turn of the wheel
+    void schedule(uint64_t patientId, uint32_t expiryMinutes) {
+        uint64_t hour = std::max<uint64_t>(expiryMinutes / 60, currentHour + 1);
+        wheel[hour % WHEEL_SLOTS].push_back({ patientId, expiryMinutes });
+    }
+
+    void advanceTo(uint32_t nowMinutes) {
+        uint64_t nowHour = nowMinutes / 60;
+        if (currentHour == NO_TICK) {
+            currentHour = nowHour;
+        }
+        if (nowHour <= currentHour) {
+            return;
+        }
+
+        uint64_t firstHour = currentHour + 1;
+        uint64_t steps = std::min<uint64_t>(nowHour - currentHour, WHEEL_SLOTS);
+        currentHour = nowHour;  // Entries rescheduled below land after now
+        for (uint64_t step = 0; step < steps; ++step) {
+            std::vector<TimerEntry> due;
+            due.swap(wheel[(firstHour + step) % WHEEL_SLOTS]);
+            for (const auto& entry : due) {
+                if (entry.expiryMinutes > nowMinutes) {
+                    schedule(entry.patientId, entry.expiryMinutes);  // Due in a later round
+                    continue;
+                }
+                // Entries for drugs that were dispensed again since are stale and find nothing to drop
+                PatientState* state = findPatient(entry.patientId);
+                if (state) {
+                    expireDrugs(*state, nowMinutes);
+                }
+            }
+        }
+    }
+
+public:
+    DispensingStreamEngine(const DrugDatabase& database, std::shared_ptr<const InteractionScreen> pairScreen,
+        InteractionSeverity minAlertSeverity = InteractionSeverity::MAJOR, double activeHalfLives = 5.0)
+        : screen(std::move(pairScreen)), alertSeverity(minAlertSeverity),
+        table(1024), wheel(WHEEL_SLOTS) {
+        for (size_t id = 0; id < database.getDrugCount(); ++id) {
+            double hours = database.getDrugById(static_cast<int>(id))->getHalfLife() * activeHalfLives;
+            activeMinutes.push_back(std::max<uint32_t>(1, static_cast<uint32_t>(hours * 60.0)));
+        }
+    }
+
+    // Processes one event in timestamp order and reports alerts for the new drug's pairs
+    void process(const DispensingEvent& event, const std::function<void(const StreamAlert&)>& onAlert) {
+        uint32_t nowMinutes = static_cast<uint32_t>(event.timestamp / 60);
+        advanceTo(nowMinutes);
+
+        PatientState* state = findPatient(event.patientId);
+        if (state && !expireDrugs(*state, nowMinutes)) {
+            state = nullptr;
+        }
+        if (!state) {
+            state = &insertPatient(event.patientId);
+        }
+
+        int existing = -1;
+        for (int i = 0; i < state->activeCount; ++i) {
+            int activeDrug = drugAt(*state, i);
+            if (activeDrug == event.drugId) {
+                existing = i;  // A refill only extends the window
+                continue;
+            }
+            int severity = screen->pairSeverity(event.drugId, activeDrug);
+            if (severity >= static_cast<int>(alertSeverity)) {
+                onAlert({ event.patientId, event.drugId, activeDrug,
+                    static_cast<InteractionSeverity>(severity), event.timestamp });
+            }
+        }
+
+        uint32_t expiry = nowMinutes + activeMinutes[event.drugId];
+        if (existing < 0) {
+            addDrug(*state, event.drugId, expiry);
+        }
+        else {
+            expiryAt(*state, existing) = expiry;
+        }
+        schedule(event.patientId, expiry);
+    }
+
+    size_t getActivePatientCount() const { return patientCount; }
+
+    // Patients whose regimen currently spills past INLINE_DRUGS
+    size_t getOverflowPatientCount() const { return overflowPatients; }
+
+    size_t getMemoryBytes() const {
+        size_t bytes = table.capacity() * sizeof(PatientState);
+        for (const auto& slot : wheel) {
+            bytes += slot.capacity() * sizeof(TimerEntry);
+        }
+        for (const auto& block : overflowBlocks) {
+            bytes += sizeof(block) + block.capacity() * sizeof(ActiveDrug);
+        }
+        return bytes;
+    }
+};
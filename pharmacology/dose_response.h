@@ -0,0 +1,155 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "db.h"
+#include "od_db.h"
+
+// One drug taken at a dose, in multiples of its typical dose, by someone with a
+// tolerance between 0 (naive) and 1 (fully tolerant)
+struct DoseIntake {
+    int drugId;
+    float dose;
+    float tolerance;
+};
+
+// Dose- and tolerance-aware overdose risk, for dose sweeps and "how much is too
+// much" charts.
+//
+// Each drug's DoseResponse is reduced to a scale and a curve shape. At dose d and
+// tolerance t the curve is evaluated at u = d / (midpoint * (1 + shift * t)), where
+// the logistic is u^slope / (1 + u^slope). Drugs with the same slope share one
+// table of that function sampled over w = u / (1 + u), which maps all doses into
+// [0, 1) and stays smooth for slopes of at least DoseResponse::MIN_SLOPE, so a
+// lookup is a division, a clamp and a linear interpolation with no pow() or exp().
+// Sampling error stays below 0.001 in probability. Combination follows
+// calculateCombinationRisk, with the individual probabilities summed and the
+// 1 - (1 - sum)^1.3 curve read from a second table. At one typical dose without
+// tolerance every drug has its flat overdose percentage, so a regimen scores what
+// calculateCombinationRisk gives it, up to rounding.
+//
+// The table is built from a snapshot of the catalog; rebuild it after loading
+// more drugs or curves.
+class DoseResponseTable {
+public:
+    static constexpr int CURVE_INTERVALS = 256;
+    static constexpr int COMBINATION_INTERVALS = 512;
+
+private:
+    struct DrugCurve {
+        float inverseMidpoint;  // 0 for a drug without overdose risk
+        float toleranceShift;
+        uint32_t curveOffset;   // Into curves
+    };
+
+    const CombinationPatterns& patterns;
+    std::vector<DrugCurve> drugCurves;   // By catalog id
+    std::vector<float> curves;           // CURVE_INTERVALS + 1 samples per distinct slope
+    float combinationTable[COMBINATION_INTERVALS + 1];
+
+    static float interpolate(const float* table, int intervals, float x) {
+        int i = std::min(static_cast<int>(x), intervals - 1);
+        float fraction = x - static_cast<float>(i);
+        return table[i] + (table[i + 1] - table[i]) * fraction;
+    }
+
+    // u is dose over effective midpoint; NaN and negative doses count as none
+    float curveRisk(const float* curve, float u) const {
+        u = std::max(0.0f, u);
+        return interpolate(curve, CURVE_INTERVALS, u / (1.0f + u) * CURVE_INTERVALS);
+    }
+
+    float scaleFor(const DrugCurve& drug, float tolerance) const {
+        tolerance = std::min(1.0f, std::max(0.0f, tolerance));
+        return drug.inverseMidpoint / (1.0f + drug.toleranceShift * tolerance);
+    }
+
+    // Percent risk from the summed probabilities; above 1 is certain overdose
+    float combine(float probabilitySum, bool speedball) const {
+        float x = std::min(1.0f, std::max(0.0f, probabilitySum)) * COMBINATION_INTERVALS;
+        float risk = interpolate(combinationTable, COMBINATION_INTERVALS, x) * (speedball ? 1.4f : 1.0f);
+        return (probabilitySum > 1.0f ? 1.0f : std::min(risk, 0.99f)) * 100.0f;
+    }
+
+public:
+    DoseResponseTable(const DrugDatabase& database, const OverdosePotentialDatabase& overdoseDB,
+        const CombinationPatterns& combinationPatterns)
+        : patterns(combinationPatterns) {
+        std::map<double, uint32_t> curveBySlope;
+        for (size_t id = 0; id < database.getDrugCount(); ++id) {
+            DoseResponse response = overdoseDB.getDoseResponse(*database.getDrugById(static_cast<int>(id)));
+            auto [slot, added] = curveBySlope.emplace(response.slope, static_cast<uint32_t>(curves.size()));
+            if (added) {
+                for (int i = 0; i <= CURVE_INTERVALS; ++i) {
+                    double w = static_cast<double>(i) / CURVE_INTERVALS;
+                    double rising = std::pow(w, response.slope);
+                    curves.push_back(static_cast<float>(rising / (rising + std::pow(1.0 - w, response.slope))));
+                }
+            }
+            drugCurves.push_back({ static_cast<float>(1.0 / response.midpoint),
+                static_cast<float>(response.toleranceShift), slot->second });
+        }
+        for (int i = 0; i <= COMBINATION_INTERVALS; ++i) {
+            combinationTable[i] = static_cast<float>(1.0 - std::pow(1.0 - static_cast<double>(i) / COMBINATION_INTERVALS, 1.3));
+        }
+    }
+
+    size_t getDrugCount() const { return drugCurves.size(); }
+    size_t getCurveCount() const { return curves.size() / (CURVE_INTERVALS + 1); }
+
+    size_t getMemoryBytes() const {
+        return drugCurves.capacity() * sizeof(DrugCurve) + curves.capacity() * sizeof(float) + sizeof(combinationTable);
+    }
+
+    // Overdose probability (0..1) of one drug; the id must be a catalog id
+    float drugRisk(int drugId, float dose, float tolerance) const {
+        const DrugCurve& drug = drugCurves[drugId];
+        return curveRisk(curves.data() + drug.curveOffset, dose * scaleFor(drug, tolerance));
+    }
+
+    void drugRisks(const DoseIntake* intakes, size_t count, float* risks) const {
+        for (size_t i = 0; i < count; ++i) {
+            risks[i] = drugRisk(intakes[i].drugId, intakes[i].dose, intakes[i].tolerance);
+        }
+    }
+
+    // Combined percent risk (0..100) of the intakes, with the speedball multiplier
+    // when their drugs match the SPEEDBALL pattern
+    float combinationRisk(const DoseIntake* intakes, size_t count) const {
+        thread_local std::vector<int> ids;
+        ids.clear();
+        float probabilitySum = 0.0f;
+        for (size_t i = 0; i < count; ++i) {
+            probabilitySum += drugRisk(intakes[i].drugId, intakes[i].dose, intakes[i].tolerance);
+            ids.push_back(intakes[i].drugId);
+        }
+        return combine(probabilitySum,
+            patterns.matches(patterns.regimenMask(ids.data(), ids.size()), CombinationPatterns::SPEEDBALL));
+    }
+
+    // Combined percent risk of the regimen with every drug at each dose scale and
+    // each tolerance: risks[t * scaleCount + s] for doseScales[s] and tolerances[t]
+    void sweep(const int* drugIds, size_t drugCount, const float* doseScales, size_t scaleCount,
+        const float* tolerances, size_t toleranceCount, float* risks) const {
+        std::fill(risks, risks + scaleCount * toleranceCount, 0.0f);
+        for (size_t t = 0; t < toleranceCount; ++t) {
+            float* row = risks + t * scaleCount;
+            for (size_t d = 0; d < drugCount; ++d) {
+                const DrugCurve& drug = drugCurves[drugIds[d]];
+                const float* curve = curves.data() + drug.curveOffset;
+                float scale = scaleFor(drug, tolerances[t]);
+                for (size_t s = 0; s < scaleCount; ++s) {
+                    row[s] += curveRisk(curve, doseScales[s] * scale);
+                }
+            }
+        }
+
+        bool speedball = patterns.matches(patterns.regimenMask(drugIds, drugCount), CombinationPatterns::SPEEDBALL);
+        for (size_t cell = 0; cell < scaleCount * toleranceCount; ++cell) {
+            risks[cell] = combine(risks[cell], speedball);
+        }
+    }
+};
@@ -1,34 +1,71 @@
 #pragma once
+#include <memory_resource>
 #include <string>
 
+#include "memory_accounting.h"
+
+// Allocator-aware: a Drug built in a pmr container keeps its name, effects and
+// affinities in the container's resource. Plain copies use the default resource.
 class Drug {
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
 private:
-    std::string name;
+    std::pmr::string name;
+    int id;
     DrugClass drugClass;
-    std::vector<SideEffect> primaryEffects;
-    std::map<std::string, double> receptorAffinities;
+    std::pmr::vector<SideEffect> primaryEffects;
+    std::pmr::map<std::pmr::string, double, StringKeyLess> receptorAffinities;
     double halfLife;
     bool causesRespiratoryDepression;
     bool affectsCNS;
+    uint8_t metabolicPathways;  // MetabolicPathway bits
 
 public:
     Drug(const std::string& drugName, DrugClass type,
-        const std::vector<SideEffect>& effects, double t_half)
-        : name(drugName), drugClass(type), primaryEffects(effects),
-        halfLife(t_half), causesRespiratoryDepression(false), affectsCNS(true) {
+        const std::vector<SideEffect>& effects, double t_half, allocator_type allocator = {})
+        : name(drugName, allocator), id(-1), drugClass(type), primaryEffects(effects.begin(), effects.end(), allocator),
+        receptorAffinities(allocator), halfLife(t_half), causesRespiratoryDepression(false), affectsCNS(true),
+        metabolicPathways(0) {
+    }
+
+    Drug(const Drug& other) = default;
+    Drug(Drug&& other) = default;
+    Drug& operator=(const Drug& other) = default;
+    Drug& operator=(Drug&& other) = default;
+
+    Drug(const Drug& other, allocator_type allocator)
+        : name(other.name, allocator), id(other.id), drugClass(other.drugClass),
+        primaryEffects(other.primaryEffects, allocator), receptorAffinities(other.receptorAffinities, allocator),
+        halfLife(other.halfLife), causesRespiratoryDepression(other.causesRespiratoryDepression),
+        affectsCNS(other.affectsCNS), metabolicPathways(other.metabolicPathways) {
+    }
+
+    Drug(Drug&& other, allocator_type allocator)
+        : name(std::move(other.name), allocator), id(other.id), drugClass(other.drugClass),
+        primaryEffects(std::move(other.primaryEffects), allocator),
+        receptorAffinities(std::move(other.receptorAffinities), allocator),
+        halfLife(other.halfLife), causesRespiratoryDepression(other.causesRespiratoryDepression),
+        affectsCNS(other.affectsCNS), metabolicPathways(other.metabolicPathways) {
     }
 
     // Getters
-    const std::string& getName() const { return name; }
+    const std::pmr::string& getName() const { return name; }
+    int getId() const { return id; }
     DrugClass getDrugClass() const { return drugClass; }
-    const std::vector<SideEffect>& getPrimaryEffects() const { return primaryEffects; }
+    const std::pmr::vector<SideEffect>& getPrimaryEffects() const { return primaryEffects; }
     double getHalfLife() const { return halfLife; }
     bool causesRespDepression() const { return causesRespiratoryDepression; }
+    uint8_t getMetabolicPathways() const { return metabolicPathways; }
 
     // Setters for specific properties
     void setRespiratoryDepression(bool value) { causesRespiratoryDepression = value; }
+    void setMetabolicPathways(uint8_t pathways) { metabolicPathways = pathways; }
+    void setId(int value) { id = value; }
     void addReceptorAffinity(const std::string& receptor, double affinity) {
-        receptorAffinities[receptor] = affinity;
+        auto it = receptorAffinities.find(receptor);
+        if (it != receptorAffinities.end()) it->second = affinity;
+        else receptorAffinities.emplace(receptor, affinity);
     }
 
     bool hasEffect(SideEffect effect) const {
@@ -0,0 +1,185 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "db.h"
+
+// How a regimen's pair effects are combined: SEQUENTIAL is consolidateEffects,
+// NOISY_OR is ParallelEffectReducer
+enum class EffectCombination {
+    SEQUENTIAL,
+    NOISY_OR
+};
+
+inline bool parseEffectCombination(const std::string& text, EffectCombination& combination) {
+    if (text == "sequential") combination = EffectCombination::SEQUENTIAL;
+    else if (text == "noisy-or") combination = EffectCombination::NOISY_OR;
+    else return false;
+    return true;
+}
+
+// Order-independent combination of interaction effects.
+//
+// consolidateEffects counts the first occurrence of an effect fully and later ones
+// at half weight, so its result depends on pair order. Here independent pairs
+// combine by noisy-OR, P = 1 - prod(1 - p). To make the merge exactly associative
+// and commutative, each probability is stored as its survival log -ln(1 - p) in
+// 32.32 fixed point and summed as integers (saturating at certainty), so any
+// grouping or order gives the same bits. Severity is the maximum; the description
+// is that of the most probable contribution at that severity, ties going to the
+// lower description id.
+class EffectAccumulator {
+private:
+    static constexpr double FIXED_ONE = 4294967296.0;       // 2^32
+    static constexpr uint64_t CERTAIN = uint64_t(1) << 62;  // Survival log of p = 1
+
+    struct Slot {
+        uint64_t logSurvival = 0;
+        int severity = -1;            // -1: effect not present
+        double bestProbability = 0.0;
+        uint32_t descriptionId = 0;
+    };
+
+    Slot slots[SIDE_EFFECT_COUNT];
+
+    static uint64_t saturatingAdd(uint64_t a, uint64_t b) {
+        return std::min(a + b, CERTAIN);  // Both at most CERTAIN, so no wrap
+    }
+
+    static uint64_t toLogSurvival(double probability) {
+        if (probability >= 1.0) return CERTAIN;
+        if (probability <= 0.0) return 0;
+        return std::min(static_cast<uint64_t>(std::llround(-std::log1p(-probability) * FIXED_ONE)), CERTAIN);
+    }
+
+    // The representative of two contributions at the same effect
+    static bool outranks(int severity, double probability, uint32_t descriptionId, const Slot& slot) {
+        if (severity != slot.severity) return severity > slot.severity;
+        if (probability != slot.bestProbability) return probability > slot.bestProbability;
+        return descriptionId < slot.descriptionId;
+    }
+
+public:
+    // Adds an effect produced by `pairs` independent drug pairs
+    void add(const InteractionEffect& effect, uint64_t pairs = 1) {
+        Slot& slot = slots[static_cast<int>(effect.effect)];
+        uint64_t log = toLogSurvival(effect.probability);
+        uint64_t total = (log != 0 && pairs > CERTAIN / log) ? CERTAIN : log * pairs;
+        slot.logSurvival = saturatingAdd(slot.logSurvival, total);
+
+        int severity = static_cast<int>(effect.severity);
+        if (outranks(severity, effect.probability, effect.descriptionId, slot)) {
+            slot.severity = severity;
+            slot.bestProbability = effect.probability;
+            slot.descriptionId = effect.descriptionId;
+        }
+    }
+
+    void merge(const EffectAccumulator& other) {
+        for (int e = 0; e < SIDE_EFFECT_COUNT; ++e) {
+            const Slot& theirs = other.slots[e];
+            if (theirs.severity < 0) continue;
+
+            Slot& mine = slots[e];
+            mine.logSurvival = saturatingAdd(mine.logSurvival, theirs.logSurvival);
+            if (outranks(theirs.severity, theirs.bestProbability, theirs.descriptionId, mine)) {
+                mine.severity = theirs.severity;
+                mine.bestProbability = theirs.bestProbability;
+                mine.descriptionId = theirs.descriptionId;
+            }
+        }
+    }
+
+    // Combined effects, ordered by SideEffect like consolidateEffects
+    std::vector<InteractionEffect> results() const {
+        std::vector<InteractionEffect> effects;
+        for (int e = 0; e < SIDE_EFFECT_COUNT; ++e) {
+            const Slot& slot = slots[e];
+            if (slot.severity < 0) continue;
+
+            double probability = (slot.logSurvival >= CERTAIN)
+                ? 1.0 : -std::expm1(-static_cast<double>(slot.logSurvival) / FIXED_ONE);
+            effects.push_back({ static_cast<SideEffect>(e), static_cast<InteractionSeverity>(slot.severity),
+                probability, slot.descriptionId });
+        }
+        return effects;
+    }
+};
+
+// Noisy-OR analysis of a regimen with its pairs split across threads. Each thread
+// accumulates a contiguous range of pairs and the partial results are merged as a
+// binary tree; the merge is exact, so the result does not depend on the thread
+// count or on the order of the drugs.
+class ParallelEffectReducer {
+private:
+    const InteractionAnalyzer& analyzer;
+
+    // Accumulates pairs [firstPair, lastPair) of the i < j loop
+    void accumulateRange(const std::vector<Drug>& drugs, size_t firstPair, size_t lastPair,
+        EffectAccumulator& accumulator) const {
+        size_t n = drugs.size();
+        size_t i = 0;
+        size_t rowStart = 0;  // Index of pair (i, i + 1)
+        while (rowStart + (n - i - 1) <= firstPair) {
+            rowStart += n - i - 1;
+            ++i;
+        }
+        size_t j = i + 1 + (firstPair - rowStart);
+
+        for (size_t pair = firstPair; pair < lastPair; ++pair) {
+            for (const auto& effect : analyzer.analyzeInteraction(drugs[i], drugs[j])) {
+                accumulator.add(effect);
+            }
+            if (++j == n) {
+                ++i;
+                j = i + 1;
+            }
+        }
+    }
+
+public:
+    // Below this many pairs a regimen is reduced on the calling thread
+    static constexpr size_t MIN_PAIRS_PER_THREAD = 256;
+
+    explicit ParallelEffectReducer(const InteractionAnalyzer& interactionAnalyzer)
+        : analyzer(interactionAnalyzer) {
+    }
+
+    // threads = 0 picks the hardware concurrency
+    std::vector<InteractionEffect> analyze(const std::vector<Drug>& drugs, size_t threads = 0) const {
+        size_t pairCount = drugs.size() < 2 ? 0 : drugs.size() * (drugs.size() - 1) / 2;
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+            threads = std::min(threads, std::max<size_t>(1, pairCount / MIN_PAIRS_PER_THREAD));
+        }
+        threads = std::max<size_t>(1, std::min(threads, std::max<size_t>(1, pairCount)));
+
+        std::vector<EffectAccumulator> partials(threads);
+        if (threads == 1) {
+            accumulateRange(drugs, 0, pairCount, partials[0]);
+        }
+        else {
+            std::vector<std::thread> workers;
+            for (size_t t = 0; t < threads; ++t) {
+                workers.emplace_back([&, t] {
+                    accumulateRange(drugs, pairCount * t / threads, pairCount * (t + 1) / threads, partials[t]);
+                });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        }
+
+        // Tree reduction: neighbours merge at doubling strides
+        for (size_t stride = 1; stride < partials.size(); stride *= 2) {
+            for (size_t t = 0; t + stride < partials.size(); t += 2 * stride) {
+                partials[t].merge(partials[t + stride]);
+            }
+        }
+        return partials[0].results();
+    }
+};
@@ -1,11 +1,44 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <span>
+
+#include "description_pool.h"
+#include "memory_accounting.h"
+#include "pair_overrides.h"
+#include "query_context.h"
 
 class InteractionAnalyzer {
+public:
+    // Interned ids of the texts used by the drug-specific rules
+    struct RuleDescriptions {
+        uint32_t pcpOxycodoneRespDep;
+        uint32_t pcpOxycodoneRespDepAdded;
+        uint32_t pcpOxycodoneMania;
+        uint32_t pcpOxycodoneDeathRisk;
+        uint32_t pcpOxycodoneDissociative;
+        uint32_t pcpDepressantRespDep;
+        uint32_t pcpDepressantMania;
+    };
+
 private:
-    std::map<std::pair<DrugClass, DrugClass>, std::vector<InteractionEffect>> interactionMatrix;
-    std::map<std::string, std::vector<InteractionEffect>> specificDrugInteractions;
+    // Matrix entries as written in initializeInteractionMatrix; the text is
+    // interned when the entry is added
+    struct EffectTemplate {
+        SideEffect effect;
+        InteractionSeverity severity;
+        double probability;
+        const char* description;
+    };
+
+    // One entry per unordered class pair, keyed with the lower class first
+    std::pmr::map<std::pair<DrugClass, DrugClass>, std::pmr::vector<InteractionEffect>> interactionMatrix;
+    PairOverrideTable pairOverrides;  // Drug-pair entries that replace the class matrix
+    uint64_t ruleVersion = 0;         // Bumped whenever the matrix or the overrides change
+
+    DescriptionPool descriptions;
+    RuleDescriptions ruleDescriptions;
+    std::vector<uint32_t> cypEnhancedDescriptions;  // description id -> CYP-enhanced variant id, UINT32_MAX for none
 
     void initializeInteractionMatrix() {
         // Depressant + Depressant combinations (high risk)
@@ -154,55 +187,416 @@ private:
             });
     }
 
+    void initializeRuleDescriptions() {
+        ruleDescriptions.pcpOxycodoneRespDep = descriptions.intern(
+            "PCP's NMDA antagonism potentiates oxycodone respiratory depression");
+        ruleDescriptions.pcpOxycodoneRespDepAdded = descriptions.intern(
+            "PCP's NMDA antagonism dangerously potentiates oxycodone respiratory depression");
+        ruleDescriptions.pcpOxycodoneMania = descriptions.intern(
+            "PCP can trigger manic episodes, especially dangerous with opioid euphoria");
+        ruleDescriptions.pcpOxycodoneDeathRisk = descriptions.intern(
+            "Extremely high risk due to respiratory depression and unpredictable PCP effects");
+        ruleDescriptions.pcpOxycodoneDissociative = descriptions.intern(
+            "Intense dissociative effects combined with opioid sedation");
+        ruleDescriptions.pcpDepressantRespDep = descriptions.intern(
+            "PCP's complex CNS effects dangerously interact with depressants");
+        ruleDescriptions.pcpDepressantMania = descriptions.intern(
+            "PCP can trigger manic/psychotic episodes when combined with depressants");
+
+        // The CYP rule appends to whatever text the effect already has, so every
+        // base text gets its composed variant up front
+        size_t baseCount = descriptions.size();
+        cypEnhancedDescriptions.resize(baseCount);
+        for (uint32_t id = 0; id < baseCount; ++id) {
+            cypEnhancedDescriptions[id] = descriptions.compose(id, " - Enhanced by CYP enzyme inhibition");
+        }
+    }
+
     void addInteraction(DrugClass drug1, DrugClass drug2,
-        const std::vector<InteractionEffect>& effects) {
-        auto key1 = std::make_pair(drug1, drug2);
-        auto key2 = std::make_pair(drug2, drug1);
-        interactionMatrix[key1] = effects;
-        interactionMatrix[key2] = effects;
+        const std::vector<EffectTemplate>& templates) {
+        std::vector<InteractionEffect> effects;
+        for (const auto& entry : templates) {
+            effects.push_back({ entry.effect, entry.severity, entry.probability,
+                descriptions.intern(entry.description) });
+        }
+
+        setClassEffects(drug1, drug2, effects);
     }
 
-    // Helper function to get drug class interactions
-    std::vector<InteractionEffect> getClassInteraction(DrugClass class1, DrugClass class2) {
-        auto key = std::make_pair(class1, class2);
-        auto it = interactionMatrix.find(key);
-        return (it != interactionMatrix.end()) ? it->second : std::vector<InteractionEffect>{};
+    // Replaces the contents of effects with the pair's override, or else its class
+    // interaction, and applies the drug-specific modifiers
+    template <typename Effects>
+    void fillInteraction(const Drug& drug1, const Drug& drug2, Effects& effects) const {
+        size_t overrideCount = 0;
+        const InteractionEffect* overridden = pairOverrides.find(drug1.getId(), drug2.getId(), overrideCount);
+        if (overridden) {
+            effects.assign(overridden, overridden + overrideCount);
+        }
+        else {
+            auto classEffects = getClassEffects(drug1.getDrugClass(), drug2.getDrugClass());
+            effects.assign(classEffects.begin(), classEffects.end());
+        }
+        modifyEffectsForSpecificDrugs(effects, drug1, drug2);
     }
 
 public:
-    InteractionAnalyzer() {
+    explicit InteractionAnalyzer(
+        std::pmr::memory_resource* resource = &memoryAccount(MemorySubsystem::INTERACTION_MATRIX))
+        : interactionMatrix(resource) {
         initializeInteractionMatrix();
+        initializeRuleDescriptions();
     }
 
-    std::vector<InteractionEffect> analyzeInteraction(const Drug& drug1, const Drug& drug2) {
-        // Get base class interaction
-        std::vector<InteractionEffect> effects = getClassInteraction(
-            drug1.getDrugClass(), drug2.getDrugClass());
+    // Materializes the text of an effect; only needed when a report is rendered
+    const std::pmr::string& getDescription(const InteractionEffect& effect) const {
+        return descriptions.get(effect.descriptionId);
+    }
 
-        // Apply drug-specific modifiers
-        modifyEffectsForSpecificDrugs(effects, drug1, drug2);
+    const DescriptionPool& getDescriptionPool() const { return descriptions; }
+    const RuleDescriptions& getRuleDescriptions() const { return ruleDescriptions; }
+
+    // Text id with " - Enhanced by CYP enzyme inhibition" appended, for base texts
+    uint32_t getCypEnhancedDescription(uint32_t descriptionId) const {
+        uint32_t enhanced = descriptionId < cypEnhancedDescriptions.size() ? cypEnhancedDescriptions[descriptionId] : UINT32_MAX;
+        return enhanced != UINT32_MAX ? enhanced : descriptionId;
+    }
+
+    // Text id for an effect loaded at run time; its CYP-enhanced variant is
+    // registered alongside so the CYP rule applies to it as well
+    uint32_t internDescription(const std::string& text) {
+        uint32_t id = descriptions.intern(text);
+        if (id >= cypEnhancedDescriptions.size()) {
+            cypEnhancedDescriptions.resize(id + 1, UINT32_MAX);
+        }
+        if (cypEnhancedDescriptions[id] == UINT32_MAX) {
+            cypEnhancedDescriptions[id] = descriptions.compose(id, " - Enhanced by CYP enzyme inhibition");
+        }
+        return id;
+    }
+
+    // Replaces the class matrix entry for both orders of the class pair
+    void setClassEffects(DrugClass class1, DrugClass class2, const std::vector<InteractionEffect>& effects) {
+        interactionMatrix[std::minmax(class1, class2)].assign(effects.begin(), effects.end());
+        ++ruleVersion;
+    }
 
+    // Replaces every drug-pair override; pairs without one use the class matrix
+    void setPairOverrides(PairOverrideTable table) {
+        pairOverrides = std::move(table);
+        ++ruleVersion;
+    }
+
+    // Changes whenever a rule that analyzeInteraction uses changes, for caches of its results
+    uint64_t getRuleVersion() const { return ruleVersion; }
+
+    const PairOverrideTable& getPairOverrides() const { return pairOverrides; }
+
+    // Class-level matrix entry, before any drug-specific rule is applied
+    std::span<const InteractionEffect> getClassEffects(DrugClass class1, DrugClass class2) const {
+        auto it = interactionMatrix.find(std::minmax(class1, class2));
+        return (it != interactionMatrix.end()) ? std::span<const InteractionEffect>(it->second)
+            : std::span<const InteractionEffect>();
+    }
+
+    std::vector<InteractionEffect> analyzeInteraction(const Drug& drug1, const Drug& drug2) const {
+        std::vector<InteractionEffect> effects;
+        fillInteraction(drug1, drug2, effects);
         return effects;
     }
 
-    std::vector<InteractionEffect> analyzeMultipleInteractions(const std::vector<Drug>& drugs) {
-        std::vector<InteractionEffect> allEffects;
+    // Pair effects for a patient whose phenotype scales drug exposure; exposure is
+    // by catalog id (see PhenotypeTables), and drugs past its end count as 1
+    std::vector<InteractionEffect> analyzeInteraction(const Drug& drug1, const Drug& drug2,
+        std::span<const float> exposure) const {
+        std::vector<InteractionEffect> effects = analyzeInteraction(drug1, drug2);
+        applyExposure(effects, exposureOf(exposure, drug1) * exposureOf(exposure, drug2));
+        return effects;
+    }
+
+    // Same effects written into a caller's vector, replacing its contents; query
+    // loops pass one vector from their arena and reuse it for every pair
+    void analyzeInteraction(const Drug& drug1, const Drug& drug2, std::span<const float> exposure,
+        std::pmr::vector<InteractionEffect>& effects) const {
+        fillInteraction(drug1, drug2, effects);
+        applyExposure(effects, exposureOf(exposure, drug1) * exposureOf(exposure, drug2));
+    }
+
+    bool isCYPInhibitor(std::string_view drugName) const {
+        // Common CYP2D6/CYP3A4 inhibitors that interact with oxycodone
+        static const std::set<std::string, std::less<>> cypInhibitors = {
+            "fluoxetine", "paroxetine", "sertraline", "clarithromycin",
+            "erythromycin", "ketoconazole", "itraconazole", "ritonavir"
+        };
+        return cypInhibitors.find(drugName) != cypInhibitors.end();
+    }
+
+    // Regimens at least this large go through the class-bucketed path
+    static constexpr size_t BUCKETED_PATH_THRESHOLD = 16;
+
+    // One per InteractionSeverity
+    static constexpr int SEVERITY_TIERS = static_cast<int>(InteractionSeverity::LETHAL) + 1;
+
+    // An exposure table applies a patient's phenotype to every pair; empty for none
+    std::vector<InteractionEffect> analyzeMultipleInteractions(const std::vector<Drug>& drugs,
+        std::span<const float> exposure = {}) const {
+        if (drugs.size() >= BUCKETED_PATH_THRESHOLD) {
+            return analyzeMultipleInteractionsBucketed(drugs, exposure);
+        }
+
+        QueryArena arena;
+        std::pmr::vector<InteractionEffect> allEffects(arena.resource());
+        std::pmr::vector<InteractionEffect> effects(arena.resource());
 
         for (size_t i = 0; i < drugs.size(); ++i) {
             for (size_t j = i + 1; j < drugs.size(); ++j) {
-                auto effects = analyzeInteraction(drugs[i], drugs[j]);
+                analyzeInteraction(drugs[i], drugs[j], exposure, effects);
                 allEffects.insert(allEffects.end(), effects.begin(), effects.end());
             }
         }
 
-        return consolidateEffects(allEffects);
+        return consolidateEffects(allEffects, arena.resource());
+    }
+
+    // Same result as the pairwise loop, in O(classes^2 + pairs involving a drug with
+    // specific rules). Pairs of drugs without specific rules only depend on their
+    // classes, so each class pair is looked up once and weighted by its multiplicity.
+    //
+    // consolidateEffects counts the first occurrence of an effect fully and every
+    // later one at half weight, and keeps the text of the first occurrence with the
+    // highest severity. Each contribution therefore carries the position of the first
+    // pair (in i < j loop order) it stands for, and is consolidated in that order.
+    //
+    // With an exposure table, drugs are bucketed by class and exposure instead: a
+    // plain pair's effects depend only on both classes and the product of both
+    // exposures, so a patient's phenotype costs one lookup per bucket pair as well.
+    std::vector<InteractionEffect> analyzeMultipleInteractionsBucketed(const std::vector<Drug>& drugs,
+        std::span<const float> exposure = {}) const {
+        return analyzeBucketed(drugs, nullptr, exposure).effects;
+    }
+
+    // Same result as analyzeMultipleInteractions while the context does not fire.
+    // When it does, the result consolidates the pairs analysed so far and is marked
+    // incomplete. Pairs involving drugs with specific rules are analysed in order of
+    // the worst severity they can reach, after the class pairs (which cost one lookup
+    // each), so a cut-short result still has the most severe effects.
+    InteractionOutcome analyzeMultipleInteractions(const std::vector<Drug>& drugs, const QueryContext& context,
+        std::span<const float> exposure = {}) const {
+        if (!context.canFire() && drugs.size() < BUCKETED_PATH_THRESHOLD) {
+            size_t pairs = drugs.size() < 2 ? 0 : drugs.size() * (drugs.size() - 1) / 2;
+            return { analyzeMultipleInteractions(drugs, exposure), true, pairs, pairs };
+        }
+        return analyzeBucketed(drugs, &context, exposure);
     }
 
 private:
-    void modifyEffectsForSpecificDrugs(std::vector<InteractionEffect>& effects,
-        const Drug& drug1, const Drug& drug2) {
-        std::string name1 = drug1.getName();
-        std::string name2 = drug2.getName();
+    static double exposureOf(std::span<const float> exposure, const Drug& drug) {
+        return static_cast<size_t>(drug.getId()) < exposure.size() ? exposure[drug.getId()] : 1.0;
+    }
+
+    // Higher exposure to either drug deepens respiratory depression and death risk,
+    // like the CYP inhibitor rule; at 1.5 times or more the severity goes up a
+    // level, and at half or less it goes down one
+    static void applyExposure(InteractionEffect& effect, double pairExposure) {
+        if (pairExposure == 1.0) return;
+        if (effect.effect != SideEffect::RESPIRATORY_DEPRESSION && effect.effect != SideEffect::DEATH_RISK) return;
+
+        int shift = pairExposure >= 1.5 ? 1 : (pairExposure <= 0.5 ? -1 : 0);
+        effect.probability = std::min(1.0, effect.probability * pairExposure);
+        effect.severity = static_cast<InteractionSeverity>(std::clamp(static_cast<int>(effect.severity) + shift,
+            static_cast<int>(InteractionSeverity::MINOR), static_cast<int>(InteractionSeverity::LETHAL)));
+    }
+
+    template <typename Effects>
+    static void applyExposure(Effects& effects, double pairExposure) {
+        for (auto& effect : effects) {
+            applyExposure(effect, pairExposure);
+        }
+    }
+
+    InteractionOutcome analyzeBucketed(const std::vector<Drug>& drugs, const QueryContext* context,
+        std::span<const float> exposure) const {
+        struct Contribution {
+            size_t first;
+            size_t second;
+            size_t order;     // Position within the pair's effect list
+            double pairs;     // Number of drug pairs this contribution stands for
+            InteractionEffect effect;
+        };
+
+        // Drugs without specific rules that share a class and an exposure
+        struct Bucket {
+            DrugClass drugClass;
+            double exposure;
+            size_t count;
+            size_t first;     // Index of the bucket's first drug
+            size_t second;    // And of its second, if any
+        };
+
+        constexpr size_t NONE = SIZE_MAX;
+        // Temporaries live in the query's arena and are freed together on return
+        QueryArena arena;
+        std::pmr::vector<bool> special(drugs.size(), arena.resource());
+        std::pmr::vector<Bucket> buckets(arena.resource());
+
+        for (size_t i = 0; i < drugs.size(); ++i) {
+            special[i] = hasSpecificRules(drugs[i]);
+            if (special[i]) continue;
+
+            DrugClass drugClass = drugs[i].getDrugClass();
+            double drugExposure = exposureOf(exposure, drugs[i]);
+            auto bucket = std::find_if(buckets.begin(), buckets.end(), [&](const Bucket& b) {
+                return b.drugClass == drugClass && b.exposure == drugExposure;
+            });
+            if (bucket == buckets.end()) buckets.push_back({ drugClass, drugExposure, 1, i, NONE });
+            else if (bucket->count++ == 1) bucket->second = i;
+        }
+
+        std::pmr::vector<Contribution> contributions(arena.resource());
+
+        // Pairs without specific rules, one lookup per bucket pair. Buckets are in
+        // order of their first drug, so x.first < y.first below.
+        for (size_t g = 0; g < buckets.size(); ++g) {
+            for (size_t h = g; h < buckets.size(); ++h) {
+                const Bucket& x = buckets[g];
+                const Bucket& y = buckets[h];
+                double pairs = (g == h)
+                    ? x.count * (x.count - 1) / 2.0
+                    : static_cast<double>(x.count) * y.count;
+                if (pairs == 0.0) continue;
+
+                size_t first = x.first;
+                size_t second = (g == h) ? x.second : y.first;
+                double pairExposure = x.exposure * y.exposure;
+                const auto& effects = getClassEffects(x.drugClass, y.drugClass);
+                for (size_t k = 0; k < effects.size(); ++k) {
+                    InteractionEffect effect = effects[k];
+                    applyExposure(effect, pairExposure);
+                    contributions.push_back({ first, second, k, pairs, effect });
+                }
+            }
+        }
+
+        // The pairs of drugs without specific rules are all covered by now
+        size_t plain = std::count(special.begin(), special.end(), false);
+        InteractionOutcome outcome;
+        outcome.pairCount = drugs.size() < 2 ? 0 : drugs.size() * (drugs.size() - 1) / 2;
+        outcome.pairsAnalyzed = plain < 2 ? 0 : plain * (plain - 1) / 2;
+
+        std::pmr::vector<InteractionEffect> effects(arena.resource());
+        auto addPair = [&](size_t i, size_t j) {
+            analyzeInteraction(drugs[i], drugs[j], exposure, effects);
+            for (size_t k = 0; k < effects.size(); ++k) {
+                contributions.push_back({ i, j, k, 1.0, effects[k] });
+            }
+            ++outcome.pairsAnalyzed;
+        };
+
+        // Pairs involving a drug with specific rules, evaluated individually. Each is
+        // taken with its lower special drug, so only special drugs' rows are walked.
+        if (!context) {
+            for (size_t i = 0; i < drugs.size(); ++i) {
+                if (!special[i]) continue;
+                for (size_t j = 0; j < drugs.size(); ++j) {
+                    if (j != i && (j > i || !special[j])) addPair(std::min(i, j), std::max(i, j));
+                }
+            }
+        }
+        else {
+            // Drugs are ranked by the worst severity their own rules can give a pair,
+            // and each pair is taken with the higher-ranked of its two drugs, so pairs
+            // come in descending order of that bound without sorting them. Drugs
+            // without specific rules rank last; their partner's bound covers the pair.
+            // applyExposure lifts a pair one level once the product of the two drugs'
+            // exposures reaches 1.5, so the drug's exposure times the highest in the
+            // regimen bounds every pair it takes
+            std::pmr::vector<int> tier(drugs.size(), -1, arena.resource());
+            std::pmr::vector<size_t> ranked(arena.resource());
+            double maxExposure = 0.0;
+            for (const auto& drug : drugs) {
+                maxExposure = std::max(maxExposure, exposureOf(exposure, drug));
+            }
+            for (size_t i = 0; i < drugs.size(); ++i) {
+                if (special[i]) {
+                    bool lifted = exposureOf(exposure, drugs[i]) * maxExposure >= 1.5;
+                    tier[i] = std::min(SEVERITY_TIERS - 1, worstReachable(drugs[i]) + (lifted ? 1 : 0));
+                }
+            }
+            for (int t = SEVERITY_TIERS - 1; t >= -1; --t) {
+                for (size_t i = 0; i < drugs.size(); ++i) {
+                    if (special[i] && tier[i] == t) ranked.push_back(i);
+                }
+            }
+            for (size_t r = 0; r < ranked.size() && !context->hasFired(); ++r) {
+                size_t i = ranked[r];
+                for (size_t j = 0; j < drugs.size() && !context->shouldStop(); ++j) {
+                    bool ranksLower = !special[j] || tier[j] < tier[i] || (tier[j] == tier[i] && j > i);
+                    if (ranksLower) addPair(std::min(i, j), std::max(i, j));
+                }
+            }
+        }
+
+        std::sort(contributions.begin(), contributions.end(),
+            [](const Contribution& x, const Contribution& y) {
+                if (x.first != y.first) return x.first < y.first;
+                if (x.second != y.second) return x.second < y.second;
+                return x.order < y.order;
+            });
+
+        bool seen[SIDE_EFFECT_COUNT] = {};
+        double extra[SIDE_EFFECT_COUNT] = {};
+        InteractionEffect consolidated[SIDE_EFFECT_COUNT];
+        // A context that fired during the pair loop still gets what was found
+        // consolidated; one that fires now keeps the effects consolidated so far
+        bool watchConsolidation = context && !context->hasFired();
+        for (const auto& contribution : contributions) {
+            if (watchConsolidation && context->shouldStop()) break;
+
+            const InteractionEffect& effect = contribution.effect;
+            int e = static_cast<int>(effect.effect);
+            if (!seen[e]) {
+                seen[e] = true;
+                consolidated[e] = effect;
+                extra[e] = (contribution.pairs - 1.0) * effect.probability * 0.5;
+            }
+            else {
+                extra[e] += contribution.pairs * effect.probability * 0.5;
+                if (effect.severity > consolidated[e].severity) {
+                    consolidated[e].severity = effect.severity;
+                    consolidated[e].descriptionId = effect.descriptionId;
+                }
+            }
+        }
+
+        // Every increment is non-negative, so clamping once at the end is the same
+        // as clamping after each step
+        for (int e = 0; e < SIDE_EFFECT_COUNT; ++e) {
+            if (!seen[e]) continue;
+            consolidated[e].probability = std::min(1.0, consolidated[e].probability + extra[e]);
+            outcome.effects.push_back(consolidated[e]);
+        }
+
+        outcome.complete = !context || !context->hasFired();
+        return outcome;
+    }
+
+    // Upper bound on the severity analyzeInteraction can return for a pair with the
+    // drug, unless the partner has rules of its own; -1 for none
+    int worstReachable(const Drug& drug) const {
+        if (hasNameRules(drug)) return SEVERITY_TIERS - 1;
+
+        int worst = pairOverrides.getWorstSeverity(drug.getId());
+        for (int c = 0; c < DRUG_CLASS_COUNT; ++c) {
+            for (const auto& effect : getClassEffects(drug.getDrugClass(), static_cast<DrugClass>(c))) {
+                worst = std::max(worst, static_cast<int>(effect.severity));
+            }
+        }
+        return worst;
+    }
+
+    template <typename Effects>
+    void modifyEffectsForSpecificDrugs(Effects& effects, const Drug& drug1, const Drug& drug2) const {
+        const std::pmr::string& name1 = drug1.getName();
+        const std::pmr::string& name2 = drug2.getName();
 
         // PCP + Oxycodone specific interaction (very dangerous)
         if ((name1 == "pcp" && name2 == "oxycodone") ||
@@ -215,7 +609,7 @@ private:
                 if (effect.effect == SideEffect::RESPIRATORY_DEPRESSION) {
                     effect.probability = std::min(1.0, effect.probability * 1.8);
                     effect.severity = InteractionSeverity::LETHAL;
-                    effect.description = "PCP's NMDA antagonism potentiates oxycodone respiratory depression";
+                    effect.descriptionId = ruleDescriptions.pcpOxycodoneRespDep;
                     foundRespDep = true;
                 }
                 if (effect.effect == SideEffect::DEATH_RISK) {
@@ -228,20 +622,20 @@ private:
             // Add new effects if not present
             if (!foundRespDep) {
                 effects.push_back({ SideEffect::RESPIRATORY_DEPRESSION, InteractionSeverity::LETHAL, 0.75,
-                    "PCP's NMDA antagonism dangerously potentiates oxycodone respiratory depression" });
+                    ruleDescriptions.pcpOxycodoneRespDepAdded });
             }
             if (!foundMania) {
                 effects.push_back({ SideEffect::MANIA, InteractionSeverity::MAJOR, 0.65,
-                    "PCP can trigger manic episodes, especially dangerous with opioid euphoria" });
+                    ruleDescriptions.pcpOxycodoneMania });
             }
             if (!foundDeathRisk) {
                 effects.push_back({ SideEffect::DEATH_RISK, InteractionSeverity::LETHAL, 0.55,
-                    "Extremely high risk due to respiratory depression and unpredictable PCP effects" });
+                    ruleDescriptions.pcpOxycodoneDeathRisk });
             }
 
             // Add dissociative effects
             effects.push_back({ SideEffect::HALLUCINATIONS, InteractionSeverity::MAJOR, 0.85,
-                "Intense dissociative effects combined with opioid sedation" });
+                ruleDescriptions.pcpOxycodoneDissociative });
         }
 
         // PCP with any depressant is dangerous
@@ -251,7 +645,7 @@ private:
                 if (effect.effect == SideEffect::RESPIRATORY_DEPRESSION) {
                     effect.probability = std::min(1.0, effect.probability * 1.4);
                     effect.severity = InteractionSeverity::MAJOR;
-                    effect.description = "PCP's complex CNS effects dangerously interact with depressants";
+                    effect.descriptionId = ruleDescriptions.pcpDepressantRespDep;
                 }
             }
 
@@ -265,7 +659,7 @@ private:
             }
             if (!foundMania) {
                 effects.push_back({ SideEffect::MANIA, InteractionSeverity::MAJOR, 0.45,
-                    "PCP can trigger manic/psychotic episodes when combined with depressants" });
+                    ruleDescriptions.pcpDepressantMania });
             }
         }
 
@@ -290,7 +684,7 @@ private:
                 if (effect.effect == SideEffect::RESPIRATORY_DEPRESSION ||
                     effect.effect == SideEffect::DEATH_RISK) {
                     effect.probability = std::min(1.0, effect.probability * 1.3);
-                    effect.description += " - Enhanced by CYP enzyme inhibition";
+                    effect.descriptionId = getCypEnhancedDescription(effect.descriptionId);
                 }
             }
         }
@@ -306,30 +700,35 @@ private:
         }
     }
 
-private:
-    bool isCYPInhibitor(const std::string& drugName) {
-        // Common CYP2D6/CYP3A4 inhibitors that interact with oxycodone
-        std::set<std::string> cypInhibitors = {
-            "fluoxetine", "paroxetine", "sertraline", "clarithromycin",
-            "erythromycin", "ketoconazole", "itraconazole", "ritonavir"
-        };
-        return cypInhibitors.find(drugName) != cypInhibitors.end();
+public:
+    // Drugs that modifyEffectsForSpecificDrugs looks at or that have pair overrides;
+    // pairs of any other drugs only depend on their classes. Keep both, and the rule
+    // table in compact_catalog.h, in sync
+    bool hasSpecificRules(const Drug& drug) const {
+        return hasNameRules(drug) || pairOverrides.involves(drug.getId());
     }
 
+    bool hasNameRules(const Drug& drug) const {
+        const std::pmr::string& name = drug.getName();
+        return name == "pcp" || name == "oxycodone" || name == "fentanyl" || isCYPInhibitor(name);
+    }
 
-    bool isDepressant(const Drug& drug) {
+private:
+    bool isDepressant(const Drug& drug) const {
         return drug.getDrugClass() == DrugClass::DEPRESSANT ||
             drug.getDrugClass() == DrugClass::OPIOID ||
             drug.getDrugClass() == DrugClass::BENZODIAZEPINE ||
             drug.getDrugClass() == DrugClass::ALCOHOL;
     }
 
-    bool isDrugClass(const Drug& drug, DrugClass targetClass) {
+    bool isDrugClass(const Drug& drug, DrugClass targetClass) const {
         return drug.getDrugClass() == targetClass;
     }
 
-    std::vector<InteractionEffect> consolidateEffects(std::vector<InteractionEffect>& effects) {
-        std::map<SideEffect, InteractionEffect> consolidated;
+    // The consolidation map is a temporary of the query, taken from its arena
+    std::vector<InteractionEffect> consolidateEffects(const std::pmr::vector<InteractionEffect>& effects,
+        std::pmr::memory_resource* scratch) const {
+        std::pmr::map<SideEffect, InteractionEffect> consolidated(scratch);
 
         for (const auto& effect : effects) {
             auto it = consolidated.find(effect.effect);
@@ -342,7 +741,7 @@ private:
                     it->second.probability + effect.probability * 0.5);
                 if (effect.severity > it->second.severity) {
                     it->second.severity = effect.severity;
-                    it->second.description = effect.description;
+                    it->second.descriptionId = effect.descriptionId;
                 }
             }
         }
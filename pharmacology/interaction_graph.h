@@ -0,0 +1,609 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "db.h"
+#include "query_context.h"
+
+// The catalog as a weighted graph: drugs are nodes, and every pair of drugs is an
+// edge weighted with the worst severity analyzeInteraction gives the pair and the
+// highest probability among its effects of that severity.
+//
+// A pair of drugs without name rules and without an override between them only
+// depends on the two classes, so the graph is a class-pair weight table plus
+// compressed sparse rows of the exceptions: pairs with a name-rule drug or an
+// override whose weight differs from their class entry. A catalog of 50k drugs
+// with a few rule drugs and 30k overrides has a few hundred thousand stored edges
+// in place of 1.25 billion.
+//
+// The algorithms take the edges at or above a severity threshold. A class block is
+// walked through a per-class list of the drugs not reached yet, so each drug
+// leaves a block list once and every other step is paid for by an exception edge:
+// components, degrees and safe paths are linear in drugs times classes plus
+// exceptions.
+//
+// Drugs added to the database after the build are appended incrementally, their
+// exceptions going to a sorted side list that is merged into the rows when it
+// grows; replacing a drug or changing the analyzer's rules rebuilds the graph on
+// the next query.
+class InteractionGraph {
+public:
+    struct Weight {
+        int8_t severity;     // Worst InteractionSeverity, -1 when the drugs do not interact
+        float probability;   // Highest probability among the effects of that severity
+    };
+
+    struct DrugDegree {
+        int drug;
+        size_t degree;           // Partners at or above the threshold
+        double weightedDegree;   // Sum of the probabilities of those edges
+    };
+
+    struct CliqueResult {
+        std::vector<std::vector<int>> cliques;  // Drug ids, ascending within a clique
+        bool complete;                          // False when cut short by the limit or the context
+    };
+
+    struct SafePath {
+        std::vector<int> drugs;  // From the first drug to the last, empty when there is none
+        double risk;             // Chance that at least one step's worst effect occurs
+    };
+
+private:
+    struct Edge {
+        int32_t drug;
+        Weight weight;
+    };
+
+    struct PendingEdge {
+        int32_t from;
+        Edge edge;
+    };
+
+    DrugDatabase& database;
+    const InteractionAnalyzer& analyzer;
+    int listenerHandle;
+    size_t threads;
+
+    size_t drugCount = 0;
+    uint64_t builtRuleVersion = 0;
+    bool stale = true;                             // Rebuild before the next query
+    std::vector<int> newDrugs;                     // Added since the last update
+    std::vector<int8_t> drugClass;                 // By drug id
+    std::vector<std::vector<int>> classMembers;    // Drug ids of each class, ascending
+    std::vector<int> nameRuleDrugs;
+    Weight classWeight[DRUG_CLASS_COUNT][DRUG_CLASS_COUNT];
+
+    std::vector<uint32_t> rowStart;   // By drug id; rowStart[a + 1] ends row a
+    std::vector<Edge> edges;          // Both directions, ascending partner id within a row
+    std::vector<PendingEdge> pending; // Exceptions of appended drugs, sorted by (from, drug)
+
+    static Weight weightOf(std::span<const InteractionEffect> effects) {
+        Weight weight{ -1, 0.0f };
+        for (const auto& effect : effects) {
+            int8_t severity = static_cast<int8_t>(effect.severity);
+            float probability = static_cast<float>(effect.probability);
+            if (severity > weight.severity) weight = { severity, probability };
+            else if (severity == weight.severity) weight.probability = std::max(weight.probability, probability);
+        }
+        return weight;
+    }
+
+    static bool sameWeight(const Weight& x, const Weight& y) {
+        return x.severity == y.severity && x.probability == y.probability;
+    }
+
+    Weight pairWeight(int a, int b) const {
+        return weightOf(analyzer.analyzeInteraction(*database.getDrugById(a), *database.getDrugById(b)));
+    }
+
+    const Weight& blockWeight(int a, int b) const {
+        return classWeight[drugClass[a]][drugClass[b]];
+    }
+
+    // Calls visit(edge) for every exception of the drug, its own pair included
+    template <typename Visit>
+    void forEachException(int drug, Visit visit) const {
+        for (uint32_t k = rowStart[drug]; k < rowStart[drug + 1]; ++k) {
+            visit(edges[k]);
+        }
+        auto it = std::lower_bound(pending.begin(), pending.end(), drug,
+            [](const PendingEdge& entry, int from) { return entry.from < from; });
+        for (; it != pending.end() && it->from == drug; ++it) {
+            visit(it->edge);
+        }
+    }
+
+    // Weights of the pairs, computed in parallel; exceptions are the ones that differ
+    // from their class entry
+    std::vector<PendingEdge> computeExceptions(const std::vector<std::pair<int, int>>& pairs) const {
+        std::vector<Weight> weights(pairs.size());
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (size_t p = pairs.size() * t / threads; p < pairs.size() * (t + 1) / threads; ++p) {
+                    weights[p] = pairWeight(pairs[p].first, pairs[p].second);
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        std::vector<PendingEdge> exceptions;
+        for (size_t p = 0; p < pairs.size(); ++p) {
+            auto [a, b] = pairs[p];
+            if (sameWeight(weights[p], blockWeight(a, b))) continue;
+            exceptions.push_back({ a, { b, weights[p] } });
+            if (a != b) exceptions.push_back({ b, { a, weights[p] } });
+        }
+        return exceptions;
+    }
+
+    // Pairs with one of the listed drugs that may differ from their class entry, each
+    // once: every pair with a name-rule drug, the same drug twice included, and every
+    // override pair
+    std::vector<std::pair<int, int>> candidatePairs(const std::vector<int>& drugs) const {
+        std::vector<bool> isRuleDrug(drugCount, false);
+        std::vector<bool> listed(drugCount, false);
+        for (int r : nameRuleDrugs) {
+            isRuleDrug[r] = true;
+        }
+        for (int d : drugs) {
+            listed[d] = true;
+        }
+
+        std::vector<std::pair<int, int>> pairs;
+        for (int r : nameRuleDrugs) {
+            if (listed[r]) {
+                for (size_t other = 0; other < drugCount; ++other) {
+                    pairs.push_back(std::minmax(r, static_cast<int>(other)));
+                }
+            }
+            else {
+                for (int d : drugs) {
+                    pairs.push_back(std::minmax(r, d));
+                }
+            }
+        }
+
+        const PairOverrideTable& overrides = analyzer.getPairOverrides();
+        if (std::any_of(drugs.begin(), drugs.end(), [&](int d) { return overrides.involves(d); })) {
+            overrides.forEachPair([&](int a, int b, const InteractionEffect*, size_t) {
+                if (static_cast<size_t>(b) < drugCount && !isRuleDrug[a] && !isRuleDrug[b] && (listed[a] || listed[b])) {
+                    pairs.push_back({ a, b });
+                }
+            });
+        }
+        std::sort(pairs.begin(), pairs.end());
+        pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+        return pairs;
+    }
+
+    void addToRows(std::vector<PendingEdge>& exceptions) {
+        for (uint32_t a = 0; a + 1 < rowStart.size(); ++a) {
+            for (uint32_t k = rowStart[a]; k < rowStart[a + 1]; ++k) {
+                exceptions.push_back({ static_cast<int32_t>(a), edges[k] });
+            }
+        }
+        std::sort(exceptions.begin(), exceptions.end(), [](const PendingEdge& x, const PendingEdge& y) {
+            return x.from != y.from ? x.from < y.from : x.edge.drug < y.edge.drug;
+        });
+
+        rowStart.assign(drugCount + 1, 0);
+        edges.clear();
+        edges.reserve(exceptions.size());
+        for (const auto& entry : exceptions) {
+            ++rowStart[entry.from + 1];
+            edges.push_back(entry.edge);
+        }
+        for (size_t a = 0; a < drugCount; ++a) {
+            rowStart[a + 1] += rowStart[a];
+        }
+    }
+
+    void rebuild() {
+        drugCount = database.getDrugCount();
+        builtRuleVersion = analyzer.getRuleVersion();
+        stale = false;
+        newDrugs.clear();
+        drugClass.assign(drugCount, 0);
+        classMembers.assign(DRUG_CLASS_COUNT, {});
+        nameRuleDrugs.clear();
+        for (size_t id = 0; id < drugCount; ++id) {
+            const Drug& drug = *database.getDrugById(static_cast<int>(id));
+            drugClass[id] = static_cast<int8_t>(drug.getDrugClass());
+            classMembers[drugClass[id]].push_back(static_cast<int>(id));
+            if (analyzer.hasNameRules(drug)) nameRuleDrugs.push_back(static_cast<int>(id));
+        }
+        for (int a = 0; a < DRUG_CLASS_COUNT; ++a) {
+            for (int b = 0; b < DRUG_CLASS_COUNT; ++b) {
+                classWeight[a][b] = weightOf(analyzer.getClassEffects(static_cast<DrugClass>(a), static_cast<DrugClass>(b)));
+            }
+        }
+
+        std::vector<int> all(drugCount);
+        for (size_t id = 0; id < drugCount; ++id) {
+            all[id] = static_cast<int>(id);
+        }
+        std::vector<PendingEdge> exceptions = computeExceptions(candidatePairs(all));
+        rowStart.assign(drugCount + 1, 0);
+        edges.clear();
+        pending.clear();
+        addToRows(exceptions);
+    }
+
+    // Adds the drugs appended to the database since the last update
+    void append() {
+        std::vector<int> added = newDrugs;
+        newDrugs.clear();
+        drugCount = database.getDrugCount();
+        drugClass.resize(drugCount, 0);
+        rowStart.resize(drugCount + 1, rowStart.back());
+        for (int id : added) {
+            const Drug& drug = *database.getDrugById(id);
+            drugClass[id] = static_cast<int8_t>(drug.getDrugClass());
+            classMembers[drugClass[id]].push_back(id);
+            if (analyzer.hasNameRules(drug)) nameRuleDrugs.push_back(id);
+        }
+
+        std::vector<PendingEdge> exceptions = computeExceptions(candidatePairs(added));
+        if (pending.size() + exceptions.size() > edges.size() / 4 + 4096) {
+            exceptions.insert(exceptions.end(), pending.begin(), pending.end());
+            pending.clear();
+            addToRows(exceptions);
+            return;
+        }
+        pending.insert(pending.end(), exceptions.begin(), exceptions.end());
+        std::sort(pending.begin(), pending.end(), [](const PendingEdge& x, const PendingEdge& y) {
+            return x.from != y.from ? x.from < y.from : x.edge.drug < y.edge.drug;
+        });
+    }
+
+    void onDrugAdded(const Drug& drug) {
+        size_t known = drugCount + newDrugs.size();
+        if (static_cast<size_t>(drug.getId()) < known) stale = true;
+        else newDrugs.push_back(drug.getId());
+    }
+
+public:
+    InteractionGraph(DrugDatabase& db, const InteractionAnalyzer& interactionAnalyzer,
+        size_t threadCount = std::max(1u, std::thread::hardware_concurrency()))
+        : database(db), analyzer(interactionAnalyzer), threads(std::max<size_t>(threadCount, 1)) {
+        listenerHandle = database.addDrugAddedListener([this](const Drug& drug) { onDrugAdded(drug); });
+    }
+
+    InteractionGraph(const InteractionGraph&) = delete;
+    InteractionGraph& operator=(const InteractionGraph&) = delete;
+
+    ~InteractionGraph() {
+        database.removeDrugAddedListener(listenerHandle);
+    }
+
+    // Brings the graph up to date with the database and the analyzer; queries call it
+    void update() {
+        if (stale || analyzer.getRuleVersion() != builtRuleVersion) rebuild();
+        else if (!newDrugs.empty()) append();
+    }
+
+    size_t getDrugCount() const { return drugCount; }
+    size_t getExceptionCount() const { return edges.size() + pending.size(); }
+
+    size_t getMemoryBytes() const {
+        size_t members = 0;
+        for (const auto& list : classMembers) {
+            members += list.capacity() * sizeof(int);
+        }
+        return drugClass.capacity() + members + rowStart.capacity() * sizeof(uint32_t) +
+            edges.capacity() * sizeof(Edge) + pending.capacity() * sizeof(PendingEdge) + sizeof(classWeight);
+    }
+
+    // Weight of the pair as analyzeInteraction gives it, the same drug twice included
+    Weight weight(int a, int b) const {
+        const Edge* row = edges.data() + rowStart[a];
+        const Edge* rowEnd = edges.data() + rowStart[a + 1];
+        const Edge* it = std::lower_bound(row, rowEnd, b, [](const Edge& edge, int drug) { return edge.drug < drug; });
+        if (it != rowEnd && it->drug == b) return it->weight;
+
+        auto pendingIt = std::lower_bound(pending.begin(), pending.end(), std::make_pair(a, b),
+            [](const PendingEdge& entry, const std::pair<int, int>& key) {
+                return entry.from != key.first ? entry.from < key.first : entry.edge.drug < key.second;
+            });
+        if (pendingIt != pending.end() && pendingIt->from == a && pendingIt->edge.drug == b) return pendingIt->edge.weight;
+        return blockWeight(a, b);
+    }
+
+    // Component id of every drug (by drug id) in the graph of the edges at or above
+    // minSeverity; components are numbered in order of their lowest drug id
+    std::vector<int> components(InteractionSeverity minSeverity) {
+        update();
+        int tier = static_cast<int>(minSeverity);
+        std::vector<int> component(drugCount, -1);
+        std::vector<int> marked(drugCount, -1);  // marked[w] == u: w is an exception of u
+        std::vector<std::vector<int>> remaining = classMembers;
+        std::vector<int> queue;
+
+        int count = 0;
+        for (size_t seed = 0; seed < drugCount; ++seed) {
+            if (component[seed] >= 0) continue;
+            component[seed] = count;
+            queue.assign(1, static_cast<int>(seed));
+            for (size_t head = 0; head < queue.size(); ++head) {
+                int u = queue[head];
+                forEachException(u, [&](const Edge& edge) {
+                    marked[edge.drug] = u;
+                    if (edge.weight.severity >= tier && component[edge.drug] < 0) {
+                        component[edge.drug] = count;
+                        queue.push_back(edge.drug);
+                    }
+                });
+                for (int c = 0; c < DRUG_CLASS_COUNT; ++c) {
+                    if (classWeight[drugClass[u]][c].severity < tier) continue;
+
+                    // Exceptions of u stay listed; everything else in the block is reached
+                    auto& members = remaining[c];
+                    size_t kept = 0;
+                    for (int w : members) {
+                        if (component[w] >= 0) continue;
+                        if (marked[w] == u) {
+                            members[kept++] = w;
+                            continue;
+                        }
+                        component[w] = count;
+                        queue.push_back(w);
+                    }
+                    members.resize(kept);
+                }
+            }
+            ++count;
+        }
+        return component;
+    }
+
+    // Degree of every drug at or above minSeverity, most connected first (ties by
+    // weighted degree, then drug id). Drugs are split across threads.
+    std::vector<DrugDegree> degrees(InteractionSeverity minSeverity) {
+        update();
+        int tier = static_cast<int>(minSeverity);
+        std::vector<DrugDegree> result(drugCount);
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (size_t u = drugCount * t / threads; u < drugCount * (t + 1) / threads; ++u) {
+                    int own = drugClass[u];
+                    long long degree = 0;
+                    double weighted = 0.0;
+                    for (int c = 0; c < DRUG_CLASS_COUNT; ++c) {
+                        const Weight& block = classWeight[own][c];
+                        if (block.severity < tier) continue;
+                        size_t partners = classMembers[c].size() - (c == own ? 1 : 0);
+                        degree += partners;
+                        weighted += partners * static_cast<double>(block.probability);
+                    }
+                    forEachException(static_cast<int>(u), [&](const Edge& edge) {
+                        if (edge.drug == static_cast<int>(u)) return;
+                        const Weight& block = blockWeight(static_cast<int>(u), edge.drug);
+                        if (block.severity >= tier) {
+                            --degree;
+                            weighted -= block.probability;
+                        }
+                        if (edge.weight.severity >= tier) {
+                            ++degree;
+                            weighted += edge.weight.probability;
+                        }
+                    });
+                    result[u] = { static_cast<int>(u), static_cast<size_t>(degree), weighted };
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        std::sort(result.begin(), result.end(), [](const DrugDegree& x, const DrugDegree& y) {
+            if (x.degree != y.degree) return x.degree > y.degree;
+            if (x.weightedDegree != y.weightedDegree) return x.weightedDegree > y.weightedDegree;
+            return x.drug < y.drug;
+        });
+        return result;
+    }
+
+    // Maximal sets of at least minSize drugs in which every pair is at or above
+    // minSeverity (Bron-Kerbosch with pivoting), at most maxCliques of them.
+    // Each drug roots the cliques whose lowest id it is, and roots are split across
+    // threads; the result lists cliques by root, so it is the same for any thread
+    // count. Cut short when the limit is reached or the context fires.
+    CliqueResult cliques(InteractionSeverity minSeverity, size_t minSize, size_t maxCliques,
+        const QueryContext& context = QueryContext()) {
+        update();
+        int tier = static_cast<int>(minSeverity);
+        auto adjacent = [&](int a, int b) { return weight(a, b).severity >= tier; };
+
+        std::vector<std::vector<std::vector<int>>> byRoot(drugCount);
+        std::atomic<size_t> nextRoot{ 0 };
+        std::atomic<size_t> found{ 0 };
+        std::atomic<bool> cutShort{ false };
+
+        auto worker = [&] {
+            // The context counts clock checks, so every thread works on its own copy
+            QueryContext local = context;
+            std::vector<int> clique;
+
+            std::function<void(std::vector<int>&, std::vector<int>&, std::vector<std::vector<int>>&)> expand =
+                [&](std::vector<int>& candidates, std::vector<int>& excluded, std::vector<std::vector<int>>& out) {
+                // One clique past the limit tells the caller the limit cut the list
+                if (local.shouldStop() || out.size() > maxCliques) return;
+                if (clique.size() + candidates.size() < minSize) return;
+                if (candidates.empty()) {
+                    if (excluded.empty()) out.push_back(clique);
+                    return;
+                }
+
+                // Pivot with the most candidate neighbours; only its non-neighbours branch
+                int pivot = candidates[0];
+                long best = -1;
+                for (const auto* set : { &candidates, &excluded }) {
+                    for (int u : *set) {
+                        long neighbours = std::count_if(candidates.begin(), candidates.end(),
+                            [&](int v) { return v != u && adjacent(u, v); });
+                        if (neighbours > best) {
+                            best = neighbours;
+                            pivot = u;
+                        }
+                    }
+                }
+                std::vector<int> branches;
+                for (int v : candidates) {
+                    if (v == pivot || !adjacent(pivot, v)) branches.push_back(v);
+                }
+
+                for (int v : branches) {
+                    std::vector<int> nextCandidates;
+                    std::vector<int> nextExcluded;
+                    for (int w : candidates) {
+                        if (w != v && adjacent(v, w)) nextCandidates.push_back(w);
+                    }
+                    for (int w : excluded) {
+                        if (adjacent(v, w)) nextExcluded.push_back(w);
+                    }
+                    clique.push_back(v);
+                    expand(nextCandidates, nextExcluded, out);
+                    clique.pop_back();
+
+                    candidates.erase(std::find(candidates.begin(), candidates.end(), v));
+                    excluded.push_back(v);
+                }
+            };
+
+            for (size_t root = nextRoot++; root < drugCount; root = nextRoot++) {
+                if (found.load() >= maxCliques || local.hasFired()) {
+                    cutShort = true;
+                    break;
+                }
+                std::vector<int> candidates;
+                std::vector<int> excluded;
+                for (size_t w = 0; w < drugCount; ++w) {
+                    if (w == root || !adjacent(static_cast<int>(root), static_cast<int>(w))) continue;
+                    (w > root ? candidates : excluded).push_back(static_cast<int>(w));
+                }
+                clique.assign(1, static_cast<int>(root));
+                expand(candidates, excluded, byRoot[root]);
+                found += byRoot[root].size();
+            }
+            if (local.hasFired()) cutShort = true;
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back(worker);
+        }
+        for (auto& thread : workers) {
+            thread.join();
+        }
+
+        CliqueResult result{ {}, !cutShort };
+        for (auto& list : byRoot) {
+            for (auto& clique : list) {
+                if (result.cliques.size() == maxCliques) {
+                    result.complete = false;
+                    return result;
+                }
+                std::sort(clique.begin(), clique.end());
+                result.cliques.push_back(std::move(clique));
+            }
+        }
+        return result;
+    }
+
+    // Lowest-risk chain of substitutions from one drug to another in which every
+    // consecutive pair stays below maxSeverity, as when one drug is tapered onto
+    // the next. A step costs -ln(1 - p) for the probability of its worst effect
+    // (nothing for drugs that do not interact), so the total is the chance that any
+    // step's worst effect occurs; ties go to fewer steps. Dijkstra, with a class
+    // block settled in one step: when the block's offer is the lowest in the queue,
+    // every unsettled drug of the block gets it except the offering drug's
+    // exceptions.
+    SafePath safePath(int from, int to, InteractionSeverity maxSeverity) {
+        update();
+        int tier = static_cast<int>(maxSeverity);
+        auto stepCost = [](const Weight& weight) {
+            return weight.severity < 0 ? 0.0 : -std::log1p(-std::min(static_cast<double>(weight.probability), 1.0));
+        };
+        auto safe = [&](const Weight& weight) { return weight.severity < tier && stepCost(weight) < HUGE_VAL; };
+
+        struct Offer {
+            double cost;
+            size_t steps;
+            int target;  // Drug id, or -1 - class for a block
+            int via;
+        };
+        auto later = [](const Offer& x, const Offer& y) {
+            return x.cost != y.cost ? x.cost > y.cost : x.steps > y.steps;
+        };
+        std::priority_queue<Offer, std::vector<Offer>, decltype(later)> offers(later);
+
+        std::vector<int> previous(drugCount, -2);  // -2 until settled
+        std::vector<double> cost(drugCount, 0.0);
+        std::vector<size_t> steps(drugCount, 0);
+        std::vector<int> marked(drugCount, -1);
+        std::vector<std::vector<int>> remaining = classMembers;
+
+        auto settle = [&](int drug, const Offer& offer) {
+            previous[drug] = offer.via;
+            cost[drug] = offer.cost;
+            steps[drug] = offer.steps;
+            forEachException(drug, [&](const Edge& edge) {
+                if (edge.drug != drug && previous[edge.drug] == -2 && safe(edge.weight)) {
+                    offers.push({ offer.cost + stepCost(edge.weight), offer.steps + 1, edge.drug, drug });
+                }
+            });
+            for (int c = 0; c < DRUG_CLASS_COUNT; ++c) {
+                const Weight& block = classWeight[drugClass[drug]][c];
+                if (safe(block)) offers.push({ offer.cost + stepCost(block), offer.steps + 1, -1 - c, drug });
+            }
+        };
+
+        settle(from, { 0.0, 0, from, -1 });
+        while (!offers.empty() && previous[to] == -2) {
+            Offer offer = offers.top();
+            offers.pop();
+            if (offer.target >= 0) {
+                if (previous[offer.target] == -2) settle(offer.target, offer);
+                continue;
+            }
+
+            forEachException(offer.via, [&](const Edge& edge) { marked[edge.drug] = offer.via; });
+            auto& members = remaining[-1 - offer.target];
+            std::vector<int> reached;
+            size_t kept = 0;
+            for (int w : members) {
+                if (previous[w] != -2) continue;
+                if (marked[w] == offer.via) {
+                    members[kept++] = w;
+                    continue;
+                }
+                reached.push_back(w);
+            }
+            members.resize(kept);
+            for (int w : reached) {
+                settle(w, { offer.cost, offer.steps, w, offer.via });
+            }
+        }
+
+        SafePath path{ {}, 0.0 };
+        if (previous[to] == -2) return path;
+        for (int drug = to; drug != -1; drug = previous[drug]) {
+            path.drugs.push_back(drug);
+        }
+        std::reverse(path.drugs.begin(), path.drugs.end());
+        path.risk = -std::expm1(-cost[to]);
+        return path;
+    }
+};
@@ -0,0 +1,269 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "db.h"
+
+struct PairPosting {
+    int32_t drugA;  // drugA < drugB, catalog ids
+    int32_t drugB;
+    double probability;
+};
+
+// One term of a multi-effect query
+struct EffectQuery {
+    SideEffect effect;
+    InteractionSeverity minSeverity = InteractionSeverity::MINOR;
+    double minProbability = 0.0;
+    double maxProbability = 1.0;
+};
+
+// Reverse lookup from an effect to the catalog pairs that can produce it.
+//
+// For every SideEffect x InteractionSeverity there is a posting list of
+// (drugA, drugB, probability), sorted by descending probability, so a probability
+// range is two binary searches. A pair that reaches an effect through several
+// rules is posted once per severity with its highest probability.
+//
+// A pair without an override and without a drug that has name rules only
+// depends on the two classes, so each class pair is analysed once and its
+// postings are copied to every such pair; only the other pairs are analysed
+// individually, as in InteractionGraph. The
+// index follows DrugDatabase::addDrug: a new drug's pairs are merged into the
+// lists, and a replaced drug's postings are dropped and rebuilt. A change to the
+// analyzer's rules (see getRuleVersion) rebuilds the whole index on the next query.
+class InteractionIndex {
+private:
+    static constexpr int TIER_COUNT = 4;  // One per InteractionSeverity
+
+    // Highest probability of one effect at one severity within a pair
+    struct TierPosting {
+        int effect;
+        int tier;
+        double probability;
+    };
+
+    DrugDatabase& database;
+    const InteractionAnalyzer& analyzer;
+    std::vector<PairPosting> postings[SIDE_EFFECT_COUNT][TIER_COUNT];
+    std::vector<TierPosting> classPostings[DRUG_CLASS_COUNT][DRUG_CLASS_COUNT];
+    std::vector<bool> nameRules;       // By drug id
+    std::vector<int8_t> drugClass;     // By drug id
+    size_t indexedDrugs = 0;
+    uint64_t builtRuleVersion = 0;
+    int listenerHandle;
+
+    static bool byProbability(const PairPosting& a, const PairPosting& b) {
+        if (a.probability != b.probability) return a.probability > b.probability;
+        return a.drugA != b.drugA ? a.drugA < b.drugA : a.drugB < b.drugB;
+    }
+
+    static bool byPair(const PairPosting& a, const PairPosting& b) {
+        return a.drugA != b.drugA ? a.drugA < b.drugA : a.drugB < b.drugB;
+    }
+
+    // Highest probability per effect and severity within one pair's effects
+    static void bestPerTier(std::span<const InteractionEffect> effects, std::vector<TierPosting>& out) {
+        double best[SIDE_EFFECT_COUNT][TIER_COUNT] = {};
+        bool seen[SIDE_EFFECT_COUNT][TIER_COUNT] = {};
+        for (const auto& effect : effects) {
+            int e = static_cast<int>(effect.effect);
+            int tier = static_cast<int>(effect.severity);
+            best[e][tier] = seen[e][tier] ? std::max(best[e][tier], effect.probability) : effect.probability;
+            seen[e][tier] = true;
+        }
+
+        out.clear();
+        for (int e = 0; e < SIDE_EFFECT_COUNT; ++e) {
+            for (int tier = 0; tier < TIER_COUNT; ++tier) {
+                if (seen[e][tier]) out.push_back({ e, tier, best[e][tier] });
+            }
+        }
+    }
+
+    void describeDrug(int id) {
+        if (static_cast<size_t>(id) >= nameRules.size()) {
+            nameRules.resize(id + 1, false);
+            drugClass.resize(id + 1, 0);
+        }
+        const Drug& drug = *database.getDrugById(id);
+        nameRules[id] = analyzer.hasNameRules(drug);
+        drugClass[id] = static_cast<int8_t>(drug.getDrugClass());
+    }
+
+    // Postings of every pair between drug and the drugs before it, appended unsorted
+    void collectPairs(int drug, std::vector<PairPosting> (&added)[SIDE_EFFECT_COUNT][TIER_COUNT]) const {
+        const Drug& second = *database.getDrugById(drug);
+        const PairOverrideTable& overrides = analyzer.getPairOverrides();
+        bool overridden = overrides.involves(drug);
+        std::vector<TierPosting> analysed;
+        for (int other = 0; other < static_cast<int>(indexedDrugs); ++other) {
+            if (other == drug) continue;
+
+            const std::vector<TierPosting>* pairPostings = &classPostings[drugClass[other]][drugClass[drug]];
+            size_t count = 0;
+            if (nameRules[other] || nameRules[drug] || (overridden && overrides.find(other, drug, count))) {
+                bestPerTier(analyzer.analyzeInteraction(*database.getDrugById(other), second), analysed);
+                pairPostings = &analysed;
+            }
+            for (const auto& posting : *pairPostings) {
+                added[posting.effect][posting.tier].push_back(
+                    { std::min(other, drug), std::max(other, drug), posting.probability });
+            }
+        }
+    }
+
+    void rebuild() {
+        builtRuleVersion = analyzer.getRuleVersion();
+        for (int x = 0; x < DRUG_CLASS_COUNT; ++x) {
+            for (int y = 0; y < DRUG_CLASS_COUNT; ++y) {
+                bestPerTier(analyzer.getClassEffects(static_cast<DrugClass>(x), static_cast<DrugClass>(y)),
+                    classPostings[x][y]);
+            }
+        }
+        nameRules.clear();
+        drugClass.clear();
+        for (size_t id = 0; id < database.getDrugCount(); ++id) {
+            describeDrug(static_cast<int>(id));
+        }
+
+        // Each drug only pairs with the drugs before it
+        std::vector<PairPosting> added[SIDE_EFFECT_COUNT][TIER_COUNT];
+        for (size_t id = 0; id < database.getDrugCount(); ++id) {
+            indexedDrugs = id + 1;
+            collectPairs(static_cast<int>(id), added);
+        }
+        for (int e = 0; e < SIDE_EFFECT_COUNT; ++e) {
+            for (int tier = 0; tier < TIER_COUNT; ++tier) {
+                postings[e][tier] = std::move(added[e][tier]);
+                std::sort(postings[e][tier].begin(), postings[e][tier].end(), byProbability);
+            }
+        }
+    }
+
+    void onDrugAdded(const Drug& drug) {
+        if (analyzer.getRuleVersion() != builtRuleVersion) return;  // The next query rebuilds everything
+
+        int id = drug.getId();
+        describeDrug(id);
+        if (id < static_cast<int>(indexedDrugs)) {
+            for (auto& lists : postings) {
+                for (auto& list : lists) {
+                    std::erase_if(list, [id](const PairPosting& p) { return p.drugA == id || p.drugB == id; });
+                }
+            }
+        }
+        else {
+            indexedDrugs = id + 1;
+        }
+
+        std::vector<PairPosting> added[SIDE_EFFECT_COUNT][TIER_COUNT];
+        collectPairs(id, added);
+        for (int e = 0; e < SIDE_EFFECT_COUNT; ++e) {
+            for (int tier = 0; tier < TIER_COUNT; ++tier) {
+                auto& list = postings[e][tier];
+                std::sort(added[e][tier].begin(), added[e][tier].end(), byProbability);
+                size_t middle = list.size();
+                list.insert(list.end(), added[e][tier].begin(), added[e][tier].end());
+                std::inplace_merge(list.begin(), list.begin() + middle, list.end(), byProbability);
+            }
+        }
+    }
+
+    // Appends the postings of one list with probability in [low, high]
+    static void appendRange(const std::vector<PairPosting>& list, double low, double high,
+        std::vector<PairPosting>& out) {
+        auto first = std::lower_bound(list.begin(), list.end(), high,
+            [](const PairPosting& p, double value) { return p.probability > value; });
+        auto last = std::upper_bound(first, list.end(), low,
+            [](double value, const PairPosting& p) { return value > p.probability; });
+        out.insert(out.end(), first, last);
+    }
+
+public:
+    InteractionIndex(DrugDatabase& db, const InteractionAnalyzer& interactionAnalyzer)
+        : database(db), analyzer(interactionAnalyzer) {
+        rebuild();
+        listenerHandle = database.addDrugAddedListener([this](const Drug& drug) { onDrugAdded(drug); });
+    }
+
+    InteractionIndex(const InteractionIndex&) = delete;
+    InteractionIndex& operator=(const InteractionIndex&) = delete;
+
+    ~InteractionIndex() {
+        database.removeDrugAddedListener(listenerHandle);
+    }
+
+    // Rebuilds the index if the analyzer's rules changed since it was built; queries call it
+    void update() {
+        if (analyzer.getRuleVersion() != builtRuleVersion) rebuild();
+    }
+
+    // Pairs producing the effect at minSeverity or above with probability in the
+    // query's range, by descending probability. A pair reaching the effect at
+    // several severities is listed once, with its highest probability.
+    std::vector<PairPosting> query(const EffectQuery& term) {
+        update();
+        std::vector<PairPosting> result;
+        int e = static_cast<int>(term.effect);
+        size_t lists = 0;
+        for (int tier = static_cast<int>(term.minSeverity); tier < TIER_COUNT; ++tier) {
+            if (!postings[e][tier].empty()) ++lists;
+            appendRange(postings[e][tier], term.minProbability, term.maxProbability, result);
+        }
+        if (lists <= 1) return result;
+
+        // Highest probability first within each pair, then keep one posting per pair
+        std::sort(result.begin(), result.end(), [](const PairPosting& a, const PairPosting& b) {
+            return byPair(a, b) || (!byPair(b, a) && a.probability > b.probability);
+        });
+        result.erase(std::unique(result.begin(), result.end(), [](const PairPosting& a, const PairPosting& b) {
+            return a.drugA == b.drugA && a.drugB == b.drugB;
+        }), result.end());
+        std::sort(result.begin(), result.end(), byProbability);
+        return result;
+    }
+
+    // Pairs matching every term, ordered by pair; the probability is the first term's
+    std::vector<PairPosting> intersect(const std::vector<EffectQuery>& terms) {
+        if (terms.empty()) return {};
+
+        std::vector<std::vector<PairPosting>> lists;
+        for (const auto& term : terms) {
+            lists.push_back(query(term));
+            std::sort(lists.back().begin(), lists.back().end(), byPair);
+        }
+
+        // Start from the shortest list so the work is bounded by the rarest term
+        std::vector<PairPosting> result = lists[0];
+        std::vector<size_t> order(lists.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::sort(order.begin(), order.end(), [&lists](size_t a, size_t b) { return lists[a].size() < lists[b].size(); });
+
+        std::vector<PairPosting> narrowed = lists[order[0]];
+        for (size_t k = 1; k < order.size() && !narrowed.empty(); ++k) {
+            std::vector<PairPosting> next;
+            std::set_intersection(narrowed.begin(), narrowed.end(), lists[order[k]].begin(), lists[order[k]].end(),
+                std::back_inserter(next), byPair);
+            narrowed.swap(next);
+        }
+
+        // Report the first term's probabilities
+        std::vector<PairPosting> matches;
+        std::set_intersection(result.begin(), result.end(), narrowed.begin(), narrowed.end(),
+            std::back_inserter(matches), byPair);
+        return matches;
+    }
+
+    size_t getPostingCount() const {
+        size_t count = 0;
+        for (const auto& lists : postings) {
+            for (const auto& list : lists) count += list.size();
+        }
+        return count;
+    }
+};
@@ -0,0 +1,129 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "db.h"
+
+// Yes/no triage over a regimen: "is there any pair at or above this severity?"
+//
+// For every catalog drug and every severity tier the screen keeps a bitset row with
+// one bit per catalog drug it reaches that tier with. Screening a regimen ORs the
+// rows of its members and ANDs the result with the regimen's own membership bitset;
+// the full analysis only needs to run when that is non-zero.
+class InteractionScreen {
+private:
+    static constexpr int TIER_COUNT = 4;  // One per InteractionSeverity
+
+    size_t drugCount;
+    size_t words;                        // 64-bit words per row
+    std::vector<uint64_t> rows;          // [tier][drug][word]
+    std::vector<int8_t> selfSeverity;    // Worst severity of a drug taken twice, -1 for none
+
+    const uint64_t* row(int tier, int drug) const {
+        return rows.data() + (static_cast<size_t>(tier) * drugCount + drug) * words;
+    }
+
+    static int8_t worstOf(std::span<const InteractionEffect> effects) {
+        int8_t worst = -1;
+        for (const auto& effect : effects) {
+            worst = std::max(worst, static_cast<int8_t>(effect.severity));
+        }
+        return worst;
+    }
+
+public:
+    InteractionScreen(const DrugDatabase& database, const InteractionAnalyzer& analyzer)
+        : drugCount(database.getDrugCount()), words((database.getDrugCount() + 63) / 64),
+        rows(TIER_COUNT * database.getDrugCount() * words, 0), selfSeverity(database.getDrugCount(), -1) {
+        // Pairs of drugs without specific rules only depend on their classes, so large
+        // catalogs need one analysis per class pair plus the pairs with specific rules
+        int8_t classWorst[DRUG_CLASS_COUNT][DRUG_CLASS_COUNT];
+        for (int x = 0; x < DRUG_CLASS_COUNT; ++x) {
+            for (int y = 0; y < DRUG_CLASS_COUNT; ++y) {
+                classWorst[x][y] = worstOf(analyzer.getClassEffects(static_cast<DrugClass>(x), static_cast<DrugClass>(y)));
+            }
+        }
+        std::vector<bool> special(drugCount);
+        std::vector<int> drugClass(drugCount);
+        for (size_t a = 0; a < drugCount; ++a) {
+            const Drug& drug = *database.getDrugById(static_cast<int>(a));
+            special[a] = analyzer.hasSpecificRules(drug);
+            drugClass[a] = static_cast<int>(drug.getDrugClass());
+        }
+
+        for (size_t a = 0; a < drugCount; ++a) {
+            const Drug& first = *database.getDrugById(static_cast<int>(a));
+            selfSeverity[a] = worstOf(analyzer.analyzeInteraction(first, first));
+
+            for (size_t b = a + 1; b < drugCount; ++b) {
+                int8_t worst = (special[a] || special[b])
+                    ? worstOf(analyzer.analyzeInteraction(first, *database.getDrugById(static_cast<int>(b))))
+                    : classWorst[drugClass[a]][drugClass[b]];
+
+                // A pair at some tier is also at every lower tier
+                for (int tier = 0; tier <= worst; ++tier) {
+                    rows[(tier * drugCount + a) * words + b / 64] |= uint64_t(1) << (b % 64);
+                    rows[(tier * drugCount + b) * words + a / 64] |= uint64_t(1) << (a % 64);
+                }
+            }
+        }
+    }
+
+    // True when the two catalog drugs interact at minSeverity or above
+    bool pairAtLeast(int a, int b, InteractionSeverity minSeverity) const {
+        if (a == b) return selfSeverity[a] >= static_cast<int8_t>(minSeverity);
+        return (row(static_cast<int>(minSeverity), a)[b / 64] >> (b % 64)) & 1;
+    }
+
+    // Worst severity of one pair, -1 when the two drugs do not interact
+    int pairSeverity(int a, int b) const {
+        for (int tier = TIER_COUNT - 1; tier >= 0; --tier) {
+            if (pairAtLeast(a, b, static_cast<InteractionSeverity>(tier))) return tier;
+        }
+        return -1;
+    }
+
+    // True when any pair of the regimen (catalog drug ids) reaches minSeverity
+    bool screen(const std::vector<int>& drugIds, InteractionSeverity minSeverity) const {
+        int tier = static_cast<int>(minSeverity);
+
+        if (words == 1) {
+            uint64_t members = 0;
+            uint64_t reached = 0;
+            for (int id : drugIds) {
+                uint64_t bit = uint64_t(1) << id;
+                if ((members & bit) && selfSeverity[id] >= tier) return true;
+                members |= bit;
+                reached |= rows[tier * drugCount + id];
+            }
+            return (reached & members) != 0;
+        }
+
+        thread_local std::vector<uint64_t> members;
+        thread_local std::vector<uint64_t> reached;
+        members.assign(words, 0);
+        reached.assign(words, 0);
+        for (int id : drugIds) {
+            uint64_t bit = uint64_t(1) << (id % 64);
+            if ((members[id / 64] & bit) && selfSeverity[id] >= tier) return true;
+            members[id / 64] |= bit;
+
+            const uint64_t* drugRow = row(tier, id);
+            for (size_t w = 0; w < words; ++w) {
+                reached[w] |= drugRow[w];
+            }
+        }
+        for (size_t w = 0; w < words; ++w) {
+            if (reached[w] & members[w]) return true;
+        }
+        return false;
+    }
+
+    // Highest severity any pair of the regimen reaches, -1 when nothing interacts
+    int worstSeverity(const std::vector<int>& drugIds) const {
+        for (int tier = TIER_COUNT - 1; tier >= 0; --tier) {
+            if (screen(drugIds, static_cast<InteractionSeverity>(tier))) return tier;
+        }
+        return -1;
+    }
+};
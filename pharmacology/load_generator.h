@@ -0,0 +1,305 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "columnar_results.h"
+#include "db.h"
+
+// Declarative description of a synthetic query mix. Loaded from "key = value"
+// lines; anything not given keeps the defaults below:
+//
+//   sizes = 2:35 3:25 4:15      regimen size : weight
+//   class.opioid = 6            weight of a drug class when drawing a drug
+//   zipf = 1.1                  popularity skew of drugs within a class
+//   rare = 0.03                 share of drugs drawn uniformly from the catalog
+//   rate = 1000                 target queries per second, 0 for as fast as possible
+//   duration = 5                seconds
+//   concurrency = 4
+//   seed = 1
+struct WorkloadProfile {
+    std::vector<std::pair<size_t, double>> sizeWeights = {
+        { 2, 35 }, { 3, 25 }, { 4, 15 }, { 5, 10 }, { 6, 8 }, { 8, 5 }, { 12, 2 }
+    };
+    // Opioid, benzodiazepine and alcohol combinations dominate real traffic
+    double classWeights[DRUG_CLASS_COUNT] = { 6, 5, 2, 5, 2, 1, 1, 0.5, 0.5 };
+    double zipfExponent = 1.1;
+    double rareDrugShare = 0.03;
+    double rate = 1000.0;
+    double durationSeconds = 5.0;
+    size_t concurrency = 4;
+    uint32_t seed = 1;
+
+    // Returns false with a message for the first line it cannot use
+    bool load(const std::string& path, std::string& error) {
+        std::ifstream input(path);
+        if (!input) {
+            error = "cannot open profile '" + path + "'";
+            return false;
+        }
+
+        std::string line;
+        for (int lineNumber = 1; std::getline(input, line); ++lineNumber) {
+            line = line.substr(0, line.find('#'));
+            size_t equals = line.find('=');
+            if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+
+            std::istringstream keyStream(line.substr(0, equals));
+            std::string key;
+            keyStream >> key;
+            std::string value = (equals == std::string::npos) ? "" : line.substr(equals + 1);
+            if (!apply(key, value)) {
+                error = "line " + std::to_string(lineNumber) + ": cannot use '" + line + "'";
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    bool apply(const std::string& key, const std::string& value) {
+        std::istringstream values(value);
+        try {
+            if (key == "sizes") {
+                sizeWeights.clear();
+                std::string entry;
+                while (values >> entry) {
+                    size_t colon = entry.find(':');
+                    if (colon == std::string::npos) return false;
+                    sizeWeights.push_back({ std::stoul(entry.substr(0, colon)), std::stod(entry.substr(colon + 1)) });
+                }
+                return !sizeWeights.empty();
+            }
+            if (key.rfind("class.", 0) == 0) {
+                for (int c = 0; c < DRUG_CLASS_COUNT; ++c) {
+                    std::string name = drugClassToString(static_cast<DrugClass>(c));
+                    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+                    if (key.substr(6) == name) {
+                        classWeights[c] = std::stod(value);
+                        return true;
+                    }
+                }
+                return false;
+            }
+            if (key == "zipf") zipfExponent = std::stod(value);
+            else if (key == "rare") rareDrugShare = std::stod(value);
+            else if (key == "rate") rate = std::stod(value);
+            else if (key == "duration") durationSeconds = std::stod(value);
+            else if (key == "concurrency") concurrency = std::max<size_t>(1, std::stoul(value));
+            else if (key == "seed") seed = static_cast<uint32_t>(std::stoul(value));
+            else return false;
+            return true;
+        }
+        catch (const std::exception&) {
+            return false;
+        }
+    }
+};
+
+// Draws regimens (catalog drug ids) following a WorkloadProfile
+class WorkloadGenerator {
+private:
+    std::mt19937 rng;
+    std::discrete_distribution<size_t> sizeDist;
+    std::vector<size_t> sizes;
+    std::discrete_distribution<int> classDist;
+    std::vector<std::vector<int>> classDrugs;
+    std::vector<std::discrete_distribution<size_t>> popularity;  // Zipf over each class's drugs
+    std::uniform_int_distribution<int> anyDrug;
+    std::bernoulli_distribution rareDrug;
+
+public:
+    WorkloadGenerator(const DrugDatabase& database, const WorkloadProfile& profile)
+        : rng(profile.seed), classDrugs(DRUG_CLASS_COUNT),
+        anyDrug(0, static_cast<int>(database.getDrugCount()) - 1), rareDrug(profile.rareDrugShare) {
+        std::vector<double> sizeWeights;
+        for (const auto& entry : profile.sizeWeights) {
+            sizes.push_back(entry.first);
+            sizeWeights.push_back(entry.second);
+        }
+        sizeDist = std::discrete_distribution<size_t>(sizeWeights.begin(), sizeWeights.end());
+
+        for (size_t id = 0; id < database.getDrugCount(); ++id) {
+            int c = static_cast<int>(database.getDrugById(static_cast<int>(id))->getDrugClass());
+            classDrugs[c].push_back(static_cast<int>(id));
+        }
+
+        std::vector<double> classWeights;
+        for (int c = 0; c < DRUG_CLASS_COUNT; ++c) {
+            classWeights.push_back(classDrugs[c].empty() ? 0.0 : profile.classWeights[c]);
+
+            std::vector<double> ranks;
+            for (size_t rank = 1; rank <= std::max<size_t>(1, classDrugs[c].size()); ++rank) {
+                ranks.push_back(1.0 / std::pow(static_cast<double>(rank), profile.zipfExponent));
+            }
+            popularity.emplace_back(ranks.begin(), ranks.end());
+        }
+        classDist = std::discrete_distribution<int>(classWeights.begin(), classWeights.end());
+    }
+
+    std::vector<int> next() {
+        std::vector<int> regimen(sizes[sizeDist(rng)]);
+        for (int& id : regimen) {
+            if (rareDrug(rng)) {
+                id = anyDrug(rng);
+            }
+            else {
+                int c = classDist(rng);
+                id = classDrugs[c][popularity[c](rng)];
+            }
+        }
+        return regimen;
+    }
+};
+
+struct LoadReport {
+    size_t queries = 0;
+    double seconds = 0.0;
+    double throughput = 0.0;  // Queries per second actually completed
+    double p50Ms = 0.0;
+    double p90Ms = 0.0;
+    double p99Ms = 0.0;
+    double p999Ms = 0.0;
+    double maxMs = 0.0;
+};
+
+// Drives queries open-loop: query i is due at start + i / rate regardless of how
+// earlier queries fared, and its latency counts from that due time. A saturated
+// engine therefore shows up as growing latency instead of a quietly lower send
+// rate (coordinated omission). A rate of 0 runs closed-loop as fast as possible.
+class LoadDriver {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static double percentile(const std::vector<double>& sorted, double fraction) {
+        if (sorted.empty()) return 0.0;
+        return sorted[std::min(sorted.size() - 1, static_cast<size_t>(sorted.size() * fraction))];
+    }
+
+    static LoadReport summarize(std::vector<double>& latencies, double seconds) {
+        std::sort(latencies.begin(), latencies.end());
+        LoadReport report;
+        report.queries = latencies.size();
+        report.seconds = seconds;
+        report.throughput = seconds > 0.0 ? latencies.size() / seconds : 0.0;
+        report.p50Ms = percentile(latencies, 0.50);
+        report.p90Ms = percentile(latencies, 0.90);
+        report.p99Ms = percentile(latencies, 0.99);
+        report.p999Ms = percentile(latencies, 0.999);
+        report.maxMs = latencies.empty() ? 0.0 : latencies.back();
+        return report;
+    }
+
+public:
+    // Runs query(regimens[i]) for every regimen on `concurrency` threads
+    static LoadReport run(const std::vector<std::vector<int>>& regimens, double rate, size_t concurrency,
+        const std::function<void(const std::vector<int>&)>& query) {
+        std::atomic<size_t> next{ 0 };
+        std::vector<std::vector<double>> latencies(concurrency);
+        Clock::time_point start = Clock::now();
+
+        std::vector<std::thread> workers;
+        for (size_t w = 0; w < concurrency; ++w) {
+            workers.emplace_back([&, w] {
+                for (size_t i = next++; i < regimens.size(); i = next++) {
+                    Clock::time_point due = Clock::now();
+                    if (rate > 0.0) {
+                        due = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(i / rate));
+                        std::this_thread::sleep_until(due);
+                    }
+                    query(regimens[i]);
+                    latencies[w].push_back(std::chrono::duration<double, std::milli>(Clock::now() - due).count());
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::vector<double> all;
+        for (const auto& part : latencies) {
+            all.insert(all.end(), part.begin(), part.end());
+        }
+        return summarize(all, seconds);
+    }
+
+    // Runs the batch CLI (executable [--catalog ...] --batch) over the regimens
+    // split into `concurrency` files processed by concurrent processes. Latencies
+    // are per process; queries and throughput count the rows the processes wrote,
+    // so regimens they could not analyse do not count.
+    static LoadReport runBatchProcesses(const std::string& executable, const std::vector<std::string>& catalogPaths,
+        const DrugDatabase& database, const std::vector<std::vector<int>>& regimens, size_t concurrency) {
+        std::filesystem::path directory = std::filesystem::temp_directory_path() /
+            ("pharmacology-load-" + std::to_string(Clock::now().time_since_epoch().count()));
+        std::filesystem::create_directories(directory);
+
+        for (size_t p = 0; p < concurrency; ++p) {
+            std::ofstream out(directory / ("regimens-" + std::to_string(p) + ".txt"));
+            for (size_t r = regimens.size() * p / concurrency; r < regimens.size() * (p + 1) / concurrency; ++r) {
+                for (size_t k = 0; k < regimens[r].size(); ++k) {
+                    out << (k ? " " : "") << database.getDrugById(regimens[r][k])->getName();
+                }
+                out << "\n";
+            }
+        }
+
+#ifdef _WIN32
+        const char* discard = " > NUL";
+#else
+        const char* discard = " > /dev/null";
+#endif
+        std::string catalogs;
+        for (const auto& path : catalogPaths) {
+            catalogs += " --catalog \"" + path + "\"";
+        }
+        std::vector<double> latencies(concurrency);
+        std::atomic<bool> failed{ false };
+        Clock::time_point start = Clock::now();
+        std::vector<std::thread> processes;
+        for (size_t p = 0; p < concurrency; ++p) {
+            processes.emplace_back([&, p] {
+                std::string command = "\"" + executable + "\"" + catalogs + " --batch \"" + (directory / ("regimens-" + std::to_string(p) + ".txt")).string() +
+                    "\" \"" + (directory / ("results-" + std::to_string(p) + ".phrc")).string() + "\"" + discard;
+                Clock::time_point launched = Clock::now();
+                if (std::system(command.c_str()) != 0) failed = true;
+                latencies[p] = std::chrono::duration<double, std::milli>(Clock::now() - launched).count();
+            });
+        }
+        for (auto& process : processes) {
+            process.join();
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        size_t analyzed = 0;
+        for (size_t p = 0; p < concurrency && !failed; ++p) {
+            ColumnarResultReader reader;
+            if (!reader.load((directory / ("results-" + std::to_string(p) + ".phrc")).string()) || !reader.isComplete()) {
+                failed = true;
+                break;
+            }
+            for (size_t g = 0; g < reader.getRowGroupCount(); ++g) {
+                analyzed += reader.getRowGroup(g).rows;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::remove_all(directory, error);
+
+        LoadReport report = summarize(latencies, seconds);
+        report.queries = failed ? 0 : analyzed;
+        report.throughput = failed ? 0.0 : analyzed / seconds;
+        return report;
+    }
+};
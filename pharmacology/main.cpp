@@ -1,5 +1,8 @@
 #pragma once
 
+#include <csignal>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -12,36 +15,76 @@
 #include <ranges>
 
 #include "od_db.h"
+#include "batch_runner.h"
+#include "differential_harness.h"
+#include "interaction_screen.h"
+#include "dispensing_stream.h"
+#include "audit_log.h"
+#include "risk_kernel.h"
+#include "interaction_index.h"
+#include "query_scheduler.h"
+#include "effect_reduction.h"
+#include "load_generator.h"
+#include "compact_catalog.h"
+#include "report_renderer.h"
+#include "catalog_diff.h"
+#include "interaction_graph.h"
+#include "dose_response.h"
+#include "pharmacogenomics.h"
+#include "sharded_batch.h"
 
 class PharmacologyProgram {
 private:
     DrugDatabase database;
     InteractionAnalyzer analyzer;
     OverdosePotentialDatabase overdoseDB;  
+    CombinationPatterns patterns{ database };
+    std::shared_ptr<const InteractionScreen> screen;  // Built on first use
+    std::unique_ptr<AuditLog> auditLog;               // Only with --audit
+    std::unique_ptr<PharmacogenomicCache> pharmacogenomics;  // Built on first use
+    uint64_t catalogVersion = 0;
+    ReportRenderer reports;
+    std::vector<std::string> catalogPaths;            // Loaded with --catalog, in order
+    std::chrono::milliseconds queryTimeout{ 0 };      // Per interaction query, 0 for none
+    EffectCombination effectCombination = EffectCombination::SEQUENTIAL;
 
-    std::string severityToString(InteractionSeverity severity) {
-        switch (severity) {
-        case InteractionSeverity::MINOR: return "MINOR";
-        case InteractionSeverity::MODERATE: return "MODERATE";
-        case InteractionSeverity::MAJOR: return "MAJOR";
-        case InteractionSeverity::LETHAL: return "LETHAL";
-        default: return "UNKNOWN";
+    std::shared_ptr<const InteractionScreen> getScreen() {
+        if (!screen) {
+            screen = std::make_shared<InteractionScreen>(database, analyzer);
         }
+        return screen;
     }
 
-    std::string effectToString(SideEffect effect) {
-        switch (effect) {
-        case SideEffect::DROWSINESS: return "Drowsiness";
-        case SideEffect::RESPIRATORY_DEPRESSION: return "Respiratory Depression";
-        case SideEffect::CARDIAC_ARRHYTHMIA: return "Cardiac Arrhythmia";
-        case SideEffect::TORSADES_DE_POINTES: return "Torsades de Pointes";
-        case SideEffect::NODDING: return "Nodding";
-        case SideEffect::HYPERTHERMIA: return "Hyperthermia";
-        case SideEffect::DEATH_RISK: return "Risk of Death";
-        case SideEffect::NAUSEA: return "Nausea";
-        case SideEffect::HALLUCINATIONS: return "Hallucinations";
-        case SideEffect::MANIA: return "Mania or hypomania";
-        default: return "Unknown Effect";
+    PharmacogenomicCache& getPharmacogenomics() {
+        if (!pharmacogenomics) {
+            pharmacogenomics = std::make_unique<PharmacogenomicCache>(database, overdoseDB, patterns);
+        }
+        return *pharmacogenomics;
+    }
+
+    // The audit record of one assessment, partial or not
+    AuditRecord auditRecord(const std::vector<std::string>& drugNames, const InteractionOutcome& outcome) const {
+        AuditRecord record;
+        record.timestamp = auditTimestampNow();
+        record.regimenHash = hashRegimen(drugNames);
+        record.catalogVersion = catalogVersion;
+        record.drugs = drugNames;
+        record.setEffects(outcome.effects, analyzer);
+        record.combinedRisk = (drugNames.size() == 1)
+            ? overdoseDB.getOverdosePercentage(drugNames[0])
+            : overdoseDB.calculateCombinationRisk(drugNames, patterns);
+        record.complete = outcome.complete;
+        record.pairsAnalyzed = outcome.pairsAnalyzed;
+        record.pairCount = outcome.pairCount;
+        return record;
+    }
+
+    // Appends one assessment to the audit log, if auditing is enabled
+    void auditAssessment(const std::vector<std::string>& drugNames, const InteractionOutcome& outcome) {
+        if (!auditLog) return;
+
+        if (auditLog->append(auditRecord(drugNames, outcome)) == 0) {
+            std::cout << "Warning: the audit log has failed; this assessment was not recorded.\n";
         }
     }
 
@@ -71,6 +114,33 @@ private:
     }
 
 public:
+    // Must run before anything that caches catalog data (audit version, screen)
+    bool loadCatalog(const std::string& path, std::string& error) {
+        catalogPaths.push_back(path);
+        return loadCatalogFile(path, database, overdoseDB, analyzer, error);
+    }
+
+    // Interactive checks, reports, letters and served queries past this budget
+    // return a partial result marked as incomplete
+    void setQueryTimeout(std::chrono::milliseconds timeout) {
+        queryTimeout = timeout;
+    }
+
+    // Applies to the same queries as the timeout
+    void setEffectCombination(EffectCombination combination) {
+        effectCombination = combination;
+    }
+
+    bool enableAudit(const std::string& directory) {
+        auditLog = std::make_unique<AuditLog>();
+        if (!auditLog->open(directory)) {
+            auditLog.reset();
+            return false;
+        }
+        catalogVersion = computeCatalogVersion(database, analyzer, overdoseDB);
+        return true;
+    }
+
     void runInteractionCheck() {
         std::cout << "\n=== DRUG INTERACTION ANALYZER ===\n";
 
@@ -174,176 +244,1205 @@ public:
         }
     }
 
-private:
-    void analyzeAndDisplayResults(const std::vector<Drug>& drugs,
-        const std::vector<std::string>& drugNames) {
-        std::cout << "\n=== INTERACTION ANALYSIS RESULTS ===\n";
-        std::cout << "Analyzing combination of: ";
-        for (size_t i = 0; i < drugNames.size(); ++i) {
-            std::cout << drugNames[i];
-            if (i < drugNames.size() - 1) std::cout << " + ";
+    int runBatch(const std::string& inputPath, const std::string& outputPath, bool withStatistics) {
+        std::ifstream input(inputPath);
+        if (!input) {
+            std::cout << "Error: cannot open regimen file '" << inputPath << "'.\n";
+            return 1;
         }
-        std::cout << "\n\n";
 
-        auto effects = analyzer.analyzeMultipleInteractions(drugs);
+        ColumnarResultWriter writer;
+        if (!writer.open(outputPath, database)) {
+            std::cout << "Error: cannot create result file '" << outputPath << "'.\n";
+            return 1;
+        }
 
-        if (effects.empty()) {
-            std::cout << "No specific dangerous interactions found in database.\n";
-            return;
+        std::unique_ptr<PopulationAggregator> aggregator;
+        if (withStatistics) {
+            aggregator = std::make_unique<PopulationAggregator>(database, getScreen());
         }
 
-        // Sort by severity
-        std::ranges::sort(effects,
-                          [](const InteractionEffect& a, const InteractionEffect& b) {
-                              return a.severity > b.severity;
-                          });
+        // Ctrl+C stops the run between blocks of regimens; everything before is kept
+        static CancellationToken interrupted;
+        std::signal(SIGINT, [](int) { interrupted.cancel(); });
+        QueryContext context(&interrupted);
+
+        BatchRunner runner(database, analyzer, overdoseDB, patterns);
+        runner.setAuditLog(auditLog.get(), catalogVersion);
+        runner.setPharmacogenomics(&getPharmacogenomics());
+        BatchRunner::Summary summary = runner.run(input, writer, aggregator.get(), 1, &context,
+            std::max(1u, std::thread::hardware_concurrency()));
+        std::signal(SIGINT, SIG_DFL);
+        if (!writer.close()) {
+            std::cout << "Error: failed writing result file '" << outputPath << "'.\n";
+            return 1;
+        }
+        if (auditLog && !auditLog->flush()) {
+            std::cout << "Error: failed writing the audit log; not every assessment was recorded.\n";
+            return 1;
+        }
 
-        bool hasLethalRisk = false;
-        bool hasMajorRisk = false;
+        std::cout << "Analyzed " << summary.regimens << " regimens ("
+                  << summary.skipped << " skipped, "
+                  << summary.unknownDrugs << " unknown drug names).\n";
+        if (!summary.complete) {
+            std::cout << "Interrupted: the remaining regimens were not analyzed.\n";
+        }
+        if (aggregator) {
+            std::cout << "\n";
+            aggregator->writeReport(std::cout);
+        }
+        return 0;
+    }
 
-        for (const auto& effect : effects) {
-            if (effect.severity == InteractionSeverity::LETHAL) hasLethalRisk = true;
-            if (effect.severity == InteractionSeverity::MAJOR) hasMajorRisk = true;
+    // Worker of a sharded batch: analyses the shard's lines with their regimen ids
+    // in the whole file, saves its population statistics when asked to, renames the
+    // results into place once complete, and leaves the final counts in the progress file
+    int runBatchShard(const std::string& inputPath, const ShardTask& task) {
+        constexpr uint64_t PROGRESS_LINES = 16384;
+        FileRangeBuffer range(inputPath, task.shard.begin, task.shard.end);
+        if (!range.isOpen()) return 1;
+        std::istream input(&range);
 
-            std::cout << "   Severity: " << severityToString(effect.severity) << "\n";
-            std::cout << "   Probability: " << (effect.probability * 100) << "%\n";
-            std::cout << "   Description: " << effect.description << "\n\n";
+        std::string partialPath = task.outputPath + ".partial";
+        ColumnarResultWriter writer;
+        if (!writer.open(partialPath, database)) return 1;
+
+        std::unique_ptr<PopulationAggregator> aggregator;
+        if (!task.statisticsPath.empty()) {
+            aggregator = std::make_unique<PopulationAggregator>(database, getScreen());
         }
 
-        // Risk assessment summary
-        std::cout << "=== RISK ASSESSMENT ===\n";
-        if (hasLethalRisk) {
-            std::cout << "   EXTREME DANGER: This combination has LETHAL potential.\n";
-            std::cout << "   Immediate medical supervision required.\n";
+        BatchRunner runner(database, analyzer, overdoseDB, patterns);
+        runner.setPharmacogenomics(&getPharmacogenomics());
+        runner.setProgressCallback(PROGRESS_LINES, [&task](uint64_t lines) {
+            std::ofstream(task.progressPath, std::ios::trunc) << lines << "\n";
+        });
+        BatchRunner::Summary summary = runner.run(input, writer, aggregator.get(), task.shard.firstRegimenId);
+        if (!writer.close()) return 1;
+        if (aggregator) {
+            std::ofstream statistics(task.statisticsPath, std::ios::binary | std::ios::trunc);
+            aggregator->write(statistics);
+            statistics.close();
+            if (statistics.fail()) return 1;
         }
-        else if (hasMajorRisk) {
-            std::cout << "   HIGH RISK: This combination poses significant health risks.\n";
-            std::cout << "   Medical consultation strongly recommended.\n";
+
+        std::error_code error;
+        std::filesystem::rename(partialPath, task.outputPath, error);
+        if (error) return 1;
+        std::ofstream progress(task.progressPath, std::ios::trunc);
+        progress << "done " << summary.regimens << " " << summary.skipped << " " << summary.unknownDrugs << "\n";
+        progress.close();
+        return progress.fail() ? 1 : 0;
+    }
+
+    // Batch analysis split over worker processes; same results file and statistics
+    // as runBatch. Workers are forked from this process, which has the catalog
+    // built already, or with a command (always on Windows) run as
+    // "<prefix> <executable> [--catalog ...] --batch-shard ...", e.g. behind ssh on
+    // hosts that see the same paths.
+    int runShardedBatch(const std::string& inputPath, const std::string& outputPath,
+        const ShardCoordinator::Options& options, bool throughCommand,
+        const std::string& commandPrefix, const std::string& executable) {
+        if (auditLog) {
+            std::cout << "Error: sharded batches do not write audit logs; use --batch.\n";
+            return 1;
         }
-        else {
-            std::cout << "   MODERATE RISK: Monitor for side effects.\n";
+
+        ShardCoordinator coordinator(options);
+        std::string workDirectory = outputPath + ".shards";
+        std::error_code directoryError;
+        std::filesystem::create_directories(workDirectory, directoryError);
+        std::string error;
+        if (directoryError) {
+            std::cout << "Error: cannot create shard directory '" << workDirectory << "'.\n";
+            return 1;
+        }
+        if (!coordinator.plan(inputPath, workDirectory, error)) {
+            std::cout << "Error: " << error << ".\n";
+            return 1;
         }
+        std::cout << "Split " << coordinator.getLineCount() << " lines into " << coordinator.getShards().size()
+                  << " shards for " << std::max<size_t>(options.workers, 1) << " workers.\n";
+
+        std::unique_ptr<ShardLauncher> launcher;
+#ifndef _WIN32
+        if (!throughCommand) {
+            launcher = std::make_unique<ForkShardLauncher>(
+                [this, inputPath](const ShardTask& task) { return runBatchShard(inputPath, task); });
+        }
+#endif
+        if (!launcher) {
+            std::string catalogs;
+            for (const auto& path : catalogPaths) {
+                catalogs += " --catalog \"" + path + "\"";
+            }
+            launcher = std::make_unique<CommandShardLauncher>([=](const ShardTask& task) {
+                return (commandPrefix.empty() ? "" : commandPrefix + " ") + "\"" + executable + "\"" + catalogs +
+                    " --batch-shard \"" + inputPath + "\" " + std::to_string(task.shard.begin) + " " +
+                    std::to_string(task.shard.end) + " " + std::to_string(task.shard.firstRegimenId) + " \"" +
+                    task.outputPath + "\" \"" + task.progressPath + "\"" +
+                    (task.statisticsPath.empty() ? "" : " \"" + task.statisticsPath + "\"");
+            });
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        ShardCoordinator::Summary summary = coordinator.execute(*launcher, std::cout);
+        launcher.reset();
+        if (!summary.complete) {
+            std::cout << "Error: not every shard could be analyzed; shard files are kept in '" << workDirectory << "'.\n";
+            return 1;
+        }
+
+        ColumnarResultWriter writer;
+        if (!writer.open(outputPath, database)) {
+            std::cout << "Error: cannot create result file '" << outputPath << "'.\n";
+            return 1;
+        }
+        std::unique_ptr<PopulationAggregator> aggregator;
+        if (options.statistics) {
+            aggregator = std::make_unique<PopulationAggregator>(database, getScreen());
+        }
+        bool merged = coordinator.merge(writer, aggregator.get(), error);
+        if (!writer.close() || !merged) {
+            std::cout << "Error: " << (merged ? "failed writing result file '" + outputPath + "'" : error) << ".\n";
+            return 1;
+        }
+        coordinator.removeWorkFiles();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "Analyzed " << summary.batch.regimens << " regimens ("
+                  << summary.batch.skipped << " skipped, "
+                  << summary.batch.unknownDrugs << " unknown drug names).\n";
+        std::cout << summary.shards << " shards, " << summary.retries << " retries (" << summary.timeouts
+                  << " timed out), " << seconds << " s.\n";
+        if (aggregator) {
+            std::cout << "\n";
+            aggregator->writeReport(std::cout);
+        }
+        return 0;
     }
 
-    void analyzeOverdoseRisk(const std::vector<std::string>& drugNames) {
-        std::cout << "\n=== OVERDOSE RISK ANALYSIS ===\n";
+    // Triage: screens every regimen and runs the full analysis only for the ones
+    // with a pair at or above minSeverity
+    int runScreen(const std::string& inputPath, InteractionSeverity minSeverity) {
+        std::ifstream input(inputPath);
+        if (!input) {
+            std::cout << "Error: cannot open regimen file '" << inputPath << "'.\n";
+            return 1;
+        }
 
-        if (drugNames.size() == 1) {
-            // Single drug analysis
-            const std::string& drugName = drugNames[0];
-            int overdosePercentage = overdoseDB.getOverdosePercentage(drugName);
-            std::string riskDescription = overdoseDB.getRiskDescription(drugName);
+        auto triage = getScreen();
+        std::string line;
+        std::string drugName;
+        std::vector<int> ids;
+        size_t regimens = 0;
+        size_t flagged = 0;
+
+        for (uint64_t regimenId = 1; std::getline(input, line); ++regimenId) {
+            ids.clear();
+            std::istringstream iss(line);
+            while (iss >> drugName) {
+                int id = database.getDrugId(drugName);
+                if (id >= 0) ids.push_back(id);
+            }
+            if (ids.empty()) continue;
+            ++regimens;
+
+            if (!triage->screen(ids, minSeverity)) continue;
+            ++flagged;
+
+            std::vector<Drug> drugs;
+            for (int id : ids) {
+                drugs.push_back(*database.getDrugById(id));
+            }
+            std::cout << "Regimen " << regimenId << ":";
+            for (const auto& effect : analyzer.analyzeMultipleInteractions(drugs)) {
+                if (effect.severity >= minSeverity) {
+                    std::cout << " " << effectToString(effect.effect) << " ("
+                              << severityToString(effect.severity) << ")";
+                }
+            }
+            std::cout << "\n";
+        }
+
+        std::cout << "Screened " << regimens << " regimens, " << flagged << " with "
+                  << severityToString(minSeverity) << " or worse interactions.\n";
+        return 0;
+    }
+
+    // Replays dispensing events ("<patient id> <drug> <unix seconds>" per line, in time
+    // order) and prints an alert for every new MAJOR or LETHAL pair
+    int runStream(const std::string& inputPath) {
+        std::ifstream input(inputPath);
+        if (!input) {
+            std::cout << "Error: cannot open event file '" << inputPath << "'.\n";
+            return 1;
+        }
+
+        DispensingStreamEngine engine(database, getScreen());
+        std::string line;
+        std::string drugName;
+        size_t events = 0;
+        size_t alerts = 0;
+
+        while (std::getline(input, line)) {
+            std::istringstream iss(line);
+            DispensingEvent event;
+            if (!(iss >> event.patientId >> drugName >> event.timestamp)) continue;
+            event.drugId = database.getDrugId(drugName);
+            if (event.drugId < 0) {
+                std::cout << "Warning: Drug '" << drugName << "' not found.\n";
+                continue;
+            }
+
+            ++events;
+            engine.process(event, [&](const StreamAlert& alert) {
+                ++alerts;
+                std::cout << "ALERT t=" << alert.timestamp << " patient " << alert.patientId << ": "
+                          << database.getDrugById(alert.newDrugId)->getName() << " + "
+                          << database.getDrugById(alert.activeDrugId)->getName() << " ("
+                          << severityToString(alert.severity) << ")\n";
+            });
+        }
+
+        std::cout << "Processed " << events << " events, " << alerts << " alerts, "
+                  << engine.getActivePatientCount() << " patients with active drugs ("
+                  << engine.getMemoryBytes() / 1024 << " KB state).\n";
+        return 0;
+    }
+
+    // Lists the catalog pairs matching every term ("EFFECT[,SEVERITY[,MIN_PROBABILITY]]")
+    int runIndexQuery(const std::vector<std::string>& termTexts) {
+        std::vector<EffectQuery> terms;
+        for (const auto& text : termTexts) {
+            std::istringstream fields(text);
+            std::string effectName, severityName, probability;
+            std::getline(fields, effectName, ',');
+            std::getline(fields, severityName, ',');
+            std::getline(fields, probability, ',');
+
+            EffectQuery term;
+            bool valid = parseSideEffect(effectName, term.effect) &&
+                (severityName.empty() || parseSeverity(severityName, term.minSeverity));
+            try {
+                if (!probability.empty()) term.minProbability = std::stod(probability);
+            }
+            catch (const std::exception&) {
+                valid = false;
+            }
+            if (!valid) {
+                std::cout << "Error: invalid query term '" << text << "'.\n";
+                return 1;
+            }
+            terms.push_back(term);
+        }
+
+        InteractionIndex index(database, analyzer);
+        auto start = std::chrono::steady_clock::now();
+        std::vector<PairPosting> pairs = terms.size() == 1 ? index.query(terms[0]) : index.intersect(terms);
+        double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
 
-            std::cout << "Drug: " << drugName << "\n";
-            std::cout << "Overdose Risk Percentage: " << overdosePercentage << "%\n";
-            std::cout << "Risk Level: " << riskDescription << "\n\n";
+        for (const auto& pair : pairs) {
+            std::cout << database.getDrugById(pair.drugA)->getName() << " + "
+                      << database.getDrugById(pair.drugB)->getName() << ": "
+                      << (pair.probability * 100) << "%\n";
+        }
+        std::cout << pairs.size() << " pairs (" << index.getPostingCount() << " postings, query "
+                  << micros << " us).\n";
+        return 0;
+    }
 
-            // Additional safety information
-            displaySafetyRecommendations(drugName, overdosePercentage);
+    // Serves interactive checks (one regimen per line on standard input) while the
+    // regimen file is screened in the background, then prints scheduler metrics
+    int runServe(const std::string& inputPath) {
+        std::ifstream input(inputPath);
+        if (!input) {
+            std::cout << "Error: cannot open regimen file '" << inputPath << "'.\n";
+            return 1;
+        }
 
+        auto parseRegimen = [this](const std::string& line) {
+            std::vector<int> ids;
+            std::istringstream iss(line);
+            std::string drugName;
+            while (iss >> drugName) {
+                int id = database.getDrugId(drugName);
+                if (id >= 0) ids.push_back(id);
+            }
+            return ids;
+        };
+
+        std::vector<int32_t> offsets{ 0 };
+        std::vector<int32_t> drugIds;
+        std::string line;
+        while (std::getline(input, line)) {
+            for (int id : parseRegimen(line)) drugIds.push_back(id);
+            offsets.push_back(static_cast<int32_t>(drugIds.size()));
+        }
+
+        auto triage = getScreen();
+        CombinationRiskKernel kernel(database, overdoseDB, patterns);
+        size_t regimenCount = offsets.size() - 1;
+        std::vector<int8_t> worst(regimenCount);
+        std::vector<uint8_t> risks(regimenCount);
+
+        QueryScheduler scheduler;
+        scheduler.submitBatch(regimenCount, 1024, [&](size_t first, size_t last) {
+            std::vector<int> ids;
+            for (size_t r = first; r < last; ++r) {
+                ids.assign(drugIds.begin() + offsets[r], drugIds.begin() + offsets[r + 1]);
+                worst[r] = static_cast<int8_t>(triage->worstSeverity(ids));
+            }
+            kernel.score(offsets.data() + first, drugIds.data(), last - first, risks.data() + first);
+        });
+
+        while (std::getline(std::cin, line)) {
+            std::vector<int> ids = parseRegimen(line);
+            if (ids.size() < 2) {
+                std::cout << "Please enter at least 2 valid drugs.\n";
+                continue;
+            }
+            // The budget starts at submission, so queue wait counts against it
+            QueryContext context = QueryContext::withTimeout(queryTimeout);
+            auto answer = scheduler.submitInteractive([&, ids, context] {
+                std::vector<Drug> drugs;
+                std::vector<std::string> names;
+                for (int id : ids) {
+                    drugs.push_back(*database.getDrugById(id));
+                    names.emplace_back(drugs.back().getName());
+                }
+                InteractionOutcome outcome = analyzeRegimen(drugs, context);
+                auditAssessment(names, outcome);
+
+                int worstSeverity = -1;
+                for (const auto& effect : outcome.effects) {
+                    worstSeverity = std::max(worstSeverity, static_cast<int>(effect.severity));
+                }
+                std::ostringstream text;
+                text << outcome.effects.size() << " effects, worst "
+                     << (worstSeverity < 0 ? "none" : severityToString(static_cast<InteractionSeverity>(worstSeverity)))
+                     << ", combined risk " << kernel.score(ids) << "%";
+                if (!outcome.complete) {
+                    text << " (partial: " << outcome.pairsAnalyzed << " of " << outcome.pairCount << " pairs)";
+                }
+                return text.str();
+            });
+            std::cout << answer.get() << "\n";
+        }
+        scheduler.waitIdle();
+
+        size_t flagged = std::count_if(worst.begin(), worst.end(),
+            [](int8_t severity) { return severity >= static_cast<int8_t>(InteractionSeverity::MAJOR); });
+        std::cout << "Screened " << regimenCount << " regimens, " << flagged << " with MAJOR or worse interactions.\n";
+
+        auto printMetrics = [](const char* name, const QueryScheduler::ClassMetrics& metrics) {
+            std::cout << name << ": " << metrics.completed << "/" << metrics.submitted << " completed, "
+                      << metrics.shed << " shed, " << metrics.deferred << " deferred, wait p50 "
+                      << metrics.p50WaitMs << " ms, p99 " << metrics.p99WaitMs << " ms, max "
+                      << metrics.maxWaitMs << " ms\n";
+        };
+        printMetrics("Interactive", scheduler.getInteractiveMetrics());
+        printMetrics("Batch", scheduler.getBatchMetrics());
+        return 0;
+    }
+
+    // Drives the engine with the given regimens, in process or through concurrent
+    // --batch processes of this executable (with the same catalogs), and prints
+    // throughput and latency. Batch processes are not paced, so a rate only
+    // applies in process.
+    int runLoad(const std::vector<std::vector<int>>& regimens, double rate, size_t concurrency,
+        bool throughBatch, const std::string& executable) {
+        LoadReport report;
+        if (throughBatch) {
+            if (rate > 0.0) {
+                std::cout << "Note: batch processes run unpaced; the rate of " << rate << "/s is not applied.\n";
+            }
+            report = LoadDriver::runBatchProcesses(executable, catalogPaths, database, regimens, concurrency);
+            if (report.queries == 0) {
+                std::cout << "Error: a batch process failed.\n";
+                return 1;
+            }
         }
         else {
-            // Multiple drug combination analysis
-            std::cout << "Analyzing combination of: ";
-            for (size_t i = 0; i < drugNames.size(); ++i) {
-                std::cout << drugNames[i];
-                if (i < drugNames.size() - 1) std::cout << " + ";
+            CombinationRiskKernel kernel(database, overdoseDB, patterns);
+            report = LoadDriver::run(regimens, rate, concurrency, [&](const std::vector<int>& ids) {
+                std::vector<Drug> drugs;
+                for (int id : ids) {
+                    drugs.push_back(*database.getDrugById(id));
+                }
+                analyzer.analyzeMultipleInteractions(drugs);
+                kernel.score(ids);
+            });
+        }
+
+        std::cout << "Target: " << (throughBatch ? "batch CLI" : "in-process API") << ", "
+                  << concurrency << (throughBatch ? " processes" : " threads") << ", rate "
+                  << (throughBatch || rate <= 0.0 ? std::string("unlimited") : std::to_string(static_cast<long long>(rate)) + "/s") << "\n";
+        std::cout << "Completed " << report.queries << " regimens in " << report.seconds << " s ("
+                  << static_cast<long long>(report.throughput) << " regimens/s)\n";
+        if (report.queries < regimens.size()) {
+            std::cout << "Warning: " << regimens.size() - report.queries << " of " << regimens.size()
+                      << " regimens were not analyzed by the batch processes.\n";
+        }
+        std::cout << "Latency" << (throughBatch ? " per process" : "") << ": p50 " << report.p50Ms << " ms, p90 "
+                  << report.p90Ms << " ms, p99 " << report.p99Ms << " ms, p99.9 " << report.p999Ms
+                  << " ms, max " << report.maxMs << " ms\n";
+        return 0;
+    }
+
+    // Synthetic load from a profile (defaults when profilePath is empty)
+    int runSyntheticLoad(const std::string& profilePath, bool throughBatch, const std::string& executable) {
+        WorkloadProfile profile;
+        std::string error;
+        if (!profilePath.empty() && !profile.load(profilePath, error)) {
+            std::cout << "Error: " << error << ".\n";
+            return 1;
+        }
+
+        WorkloadGenerator generator(database, profile);
+        size_t count = profile.rate > 0.0
+            ? static_cast<size_t>(profile.rate * profile.durationSeconds) : 100000;
+        std::vector<std::vector<int>> regimens;
+        for (size_t i = 0; i < count; ++i) {
+            regimens.push_back(generator.next());
+        }
+        return runLoad(regimens, profile.rate, profile.concurrency, throughBatch, executable);
+    }
+
+    // Replays a recorded regimen file (batch input format) at a target rate
+    int runReplay(const std::string& inputPath, double rate, size_t concurrency, bool throughBatch,
+        const std::string& executable) {
+        std::ifstream input(inputPath);
+        if (!input) {
+            std::cout << "Error: cannot open regimen file '" << inputPath << "'.\n";
+            return 1;
+        }
+
+        std::vector<std::vector<int>> regimens;
+        std::string line;
+        std::string drugName;
+        while (std::getline(input, line)) {
+            std::istringstream iss(line);
+            std::vector<int> ids;
+            while (iss >> drugName) {
+                int id = database.getDrugId(drugName);  // Also skips a "<patient>:" prefix
+                if (id >= 0) ids.push_back(id);
             }
-            std::cout << "\n\n";
+            if (!ids.empty()) regimens.push_back(std::move(ids));
+        }
+        return runLoad(regimens, rate, concurrency, throughBatch, executable);
+    }
 
-            // Individual drug risks
-            std::cout << "Individual Drug Risks:\n";
-            for (const std::string& drugName : drugNames) {
-                int percentage = overdoseDB.getOverdosePercentage(drugName);
-                std::cout << "  " << drugName << ": " << percentage << "% risk\n";
+    // Prints the letter for one regimen in the given format; the assessment is audited
+    int runReport(ReportFormat format, const std::vector<std::string>& drugNames) {
+        std::vector<std::string> known;
+        for (const auto& name : drugNames) {
+            if (database.getDrugId(name) >= 0) {
+                known.push_back(name);
+            }
+            else {
+                std::cout << "Warning: Drug '" << name << "' not found.\n";
             }
+        }
+        if (known.empty()) {
+            std::cout << "Please enter at least 1 valid drug for the report.\n";
+            return 1;
+        }
 
-            // Combined risk calculation
-            int combinedRisk = overdoseDB.calculateCombinationRisk(drugNames);
-            std::cout << "\nCombined Overdose Risk: " << combinedRisk << "%\n";
+        InteractionOutcome outcome;
+        std::cout << renderLetter(known, format, &outcome);
+        auditAssessment(known, outcome);
+        return 0;
+    }
+
+    // Renders a letter for every regimen line of the input. Blocks of regimens are
+    // split across threads, each rendering into its own buffer, and written in
+    // input order; with --audit, their assessments are logged in the same order.
+    int runLetters(ReportFormat format, const std::string& inputPath, const std::string& outputPath) {
+        std::ifstream input(inputPath);
+        if (!input) {
+            std::cout << "Error: cannot open regimen file '" << inputPath << "'.\n";
+            return 1;
+        }
+        std::ofstream output(outputPath, std::ios::binary);
+        if (!output) {
+            std::cout << "Error: cannot create letter file '" << outputPath << "'.\n";
+            return 1;
+        }
+
+        const size_t BLOCK_REGIMENS = 4096;
+        size_t threads = std::max(1u, std::thread::hardware_concurrency());
+        std::vector<std::string> rendered(threads);
+        std::vector<std::vector<AuditRecord>> audited(threads);
+        std::vector<std::vector<std::string>> block;
+        size_t letters = 0;
+
+        auto renderBlock = [&] {
+            std::vector<std::thread> workers;
+            for (size_t t = 0; t < threads; ++t) {
+                workers.emplace_back([&, t] {
+                    rendered[t].clear();
+                    audited[t].clear();
+                    InteractionOutcome outcome;
+                    for (size_t r = block.size() * t / threads; r < block.size() * (t + 1) / threads; ++r) {
+                        rendered[t] += renderLetter(block[r], format, auditLog ? &outcome : nullptr);
+                        if (auditLog) audited[t].push_back(auditRecord(block[r], outcome));
+                    }
+                });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+            for (size_t t = 0; t < threads; ++t) {
+                output.write(rendered[t].data(), static_cast<std::streamsize>(rendered[t].size()));
+                for (const auto& record : audited[t]) {
+                    auditLog->append(record);
+                }
+            }
+            letters += block.size();
+            block.clear();
+        };
+
+        if (format == ReportFormat::HTML) output << "<!DOCTYPE html>\n<html>\n<body>\n";
+        std::string line;
+        std::string drugName;
+        while (std::getline(input, line)) {
+            std::vector<std::string> names;
+            std::istringstream iss(line);
+            while (iss >> drugName) {
+                if (database.getDrugId(drugName) >= 0) names.push_back(drugName);
+            }
+            if (names.empty()) continue;
+
+            block.push_back(std::move(names));
+            if (block.size() == BLOCK_REGIMENS) renderBlock();
+        }
+        if (!block.empty()) renderBlock();
+        if (format == ReportFormat::HTML) output << "</body>\n</html>\n";
+
+        if (!output) {
+            std::cout << "Error: writing '" << outputPath << "' failed.\n";
+            return 1;
+        }
+        if (auditLog && !auditLog->flush()) {
+            std::cout << "Error: failed writing the audit log; not every assessment was recorded.\n";
+            return 1;
+        }
+        std::cout << "Rendered " << letters << " letters to " << outputPath << "\n";
+        return 0;
+    }
+
+    // Reports the regimens whose assessment changes when the patch catalog is
+    // loaded on top of the current one
+    int runCatalogDiff(const std::string& patchPath, const std::string& inputPath,
+        const std::string& outputPath, double threshold) {
+        CatalogVersion patched;
+        std::vector<std::string> paths = catalogPaths;
+        paths.push_back(patchPath);
+        std::string error;
+        if (!patched.load(paths, error)) {
+            std::cout << "Error: " << error << "\n";
+            return 1;
+        }
+        std::ifstream input(inputPath);
+        if (!input) {
+            std::cout << "Error: cannot open regimen file '" << inputPath << "'.\n";
+            return 1;
+        }
+        std::ofstream output(outputPath, std::ios::binary);
+        if (!output) {
+            std::cout << "Error: cannot create change file '" << outputPath << "'.\n";
+            return 1;
+        }
+
+        CatalogDiff diff({ database, analyzer, overdoseDB, patterns }, patched.view());
+        std::cout << "Affected: " << diff.getAffectedDrugCount() << " drugs, " << diff.getAffectedClassPairCount()
+                  << " class pairs, " << diff.getAffectedDrugPairCount() << " drug pairs\n";
+
+        CatalogDiffSummary summary = diff.run(input, output, threshold, std::max(1u, std::thread::hardware_concurrency()));
+        if (!output) {
+            std::cout << "Error: writing '" << outputPath << "' failed.\n";
+            return 1;
+        }
+        std::cout << "Regimens: " << summary.regimens << ", skipped " << summary.skipped << " unaffected, re-screened "
+                  << summary.regimens - summary.skipped << "\n";
+        std::cout << "Changed: " << summary.changed << " (effects " << summary.effectChanges << ", severity "
+                  << summary.severityChanges << ", probability " << summary.probabilityChanges << ", risk "
+                  << summary.riskChanges << ") written to " << outputPath << "\n";
+        return 0;
+    }
+
+    static void printMemoryAccounts(const std::string& title) {
+        std::cout << title << ":\n";
+        for (int s = 0; s < MEMORY_SUBSYSTEM_COUNT; ++s) {
+            MemorySubsystem subsystem = static_cast<MemorySubsystem>(s);
+            AccountingResource::Stats stats = memoryAccount(subsystem).getStats();
+            std::cout << "  " << memorySubsystemName(subsystem) << ": " << stats.liveBytes << " bytes live, "
+                      << stats.peakBytes << " peak, " << stats.allocations << " allocations, "
+                      << stats.deallocations << " frees\n";
+        }
+    }
+
+    // Memory of each engine subsystem after startup and any --catalog files, and
+    // again after analysing every regimen of the input, if one is given
+    int runMemoryReport(const std::string& inputPath) {
+        printMemoryAccounts("After startup");
+        if (inputPath.empty()) return 0;
 
-            // Risk category for combination
-            std::string combinedDescription = getCombinedRiskDescription(combinedRisk);
-            std::cout << "Combined Risk Level: " << combinedDescription << "\n\n";
+        std::ifstream input(inputPath);
+        if (!input) {
+            std::cout << "Error: cannot open regimen file '" << inputPath << "'.\n";
+            return 1;
+        }
+
+        size_t regimens = 0;
+        std::string line;
+        std::string drugName;
+        std::vector<Drug> drugs;
+        while (std::getline(input, line)) {
+            drugs.clear();
+            std::istringstream iss(line);
+            while (iss >> drugName) {
+                const Drug* drug = database.getDrugById(database.getDrugId(drugName));
+                if (drug) drugs.push_back(*drug);
+            }
+            if (drugs.empty()) continue;
 
-            displayCombinationWarnings(drugNames, combinedRisk);
+            analyzer.analyzeMultipleInteractions(drugs);
+            ++regimens;
         }
+        std::cout << "\n";
+        printMemoryAccounts("After " + std::to_string(regimens) + " regimens");
+        return 0;
     }
 
-    void displaySafetyRecommendations(const std::string& drugName, int riskPercentage) {
-        std::cout << "=== SAFETY RECOMMENDATIONS ===\n";
+    std::string joinDrugNames(const std::vector<int>& drugIds, size_t limit) const {
+        std::string names;
+        for (size_t i = 0; i < drugIds.size() && i < limit; ++i) {
+            names += (i ? ", " : "") + database.getDrugById(drugIds[i])->getName();
+        }
+        if (drugIds.size() > limit) names += ", ... (" + std::to_string(drugIds.size() - limit) + " more)";
+        return names;
+    }
 
-        if (riskPercentage >= 90) {
-            std::cout << "   CRITICAL WARNING: Extremely high overdose risk!\n";
-            std::cout << "   - Never use without medical supervision\n";
-            std::cout << "   - Have naloxone (Narcan) immediately available\n";
-            std::cout << "   - Consider addiction treatment resources\n";
+    // Catalog graph analytics:
+    //   components [severity]                  drugs linked by pairs at or above severity (LETHAL)
+    //   central [severity] [count]             drugs with the most such pairs (MAJOR, 10)
+    //   cliques [severity] [min size] [count]  sets where every pair is at or above severity (LETHAL, 3, 20)
+    //   path <from> <to> [severity]            lowest-risk substitution chain below severity (MAJOR)
+    int runGraphQuery(const std::vector<std::string>& args) {
+        const std::string usage = "Usage: pharmacology --graph components [severity]\n"
+            "       pharmacology --graph central [severity] [count]\n"
+            "       pharmacology --graph cliques [severity] [min size] [count]\n"
+            "       pharmacology --graph path <from> <to> [severity]\n";
+        const std::string& query = args.empty() ? "" : args[0];
+        size_t severityArg = query == "path" ? 3 : 1;
+        InteractionSeverity severity = (query == "central" || query == "path")
+            ? InteractionSeverity::MAJOR : InteractionSeverity::LETHAL;
+        size_t first = 0;
+        size_t second = 0;
+        bool valid = (query == "components" && args.size() <= 2) || (query == "central" && args.size() <= 3) ||
+            (query == "cliques" && args.size() <= 4) || (query == "path" && (args.size() == 3 || args.size() == 4));
+        try {
+            if (valid && args.size() > severityArg) valid = parseSeverity(args[severityArg], severity);
+            if (valid && args.size() > severityArg + 1) first = std::stoul(args[severityArg + 1]);
+            if (valid && args.size() > severityArg + 2) second = std::stoul(args[severityArg + 2]);
+        }
+        catch (const std::exception&) {
+            valid = false;
         }
-        else if (riskPercentage >= 75) {
-            std::cout << "   HIGH RISK WARNING:\n";
-            std::cout << "   - Use extreme caution with dosing\n";
-            std::cout << "   - Never use alone - have someone present\n";
-            std::cout << "   - Keep emergency contacts readily available\n";
+        if (!valid) {
+            std::cout << usage;
+            return 1;
+        }
+
+        InteractionGraph graph(database, analyzer);
+        auto start = std::chrono::steady_clock::now();
+        graph.update();
+        double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Graph: " << graph.getDrugCount() << " drugs, " << graph.getExceptionCount()
+                  << " exception edges, " << graph.getMemoryBytes() / 1024 << " KB, built in " << buildMs << " ms\n";
+
+        start = std::chrono::steady_clock::now();
+        if (query == "components") {
+            std::vector<int> component = graph.components(severity);
+            std::vector<std::vector<int>> members;
+            for (size_t drug = 0; drug < component.size(); ++drug) {
+                if (component[drug] >= static_cast<int>(members.size())) members.resize(component[drug] + 1);
+                members[component[drug]].push_back(static_cast<int>(drug));
+            }
+            std::stable_sort(members.begin(), members.end(),
+                [](const std::vector<int>& x, const std::vector<int>& y) { return x.size() > y.size(); });
+            size_t linked = std::count_if(members.begin(), members.end(),
+                [](const std::vector<int>& list) { return list.size() > 1; });
+            for (size_t c = 0; c < linked && c < 20; ++c) {
+                std::cout << members[c].size() << " drugs: " << joinDrugNames(members[c], 12) << "\n";
+            }
+            std::cout << linked << " components with " << severityToString(severity) << " pairs, "
+                      << members.size() - linked << " drugs without";
         }
-        else if (riskPercentage >= 60) {
-            std::cout << "   MODERATE-HIGH RISK:\n";
-            std::cout << "   - Start with lower doses\n";
-            std::cout << "   - Avoid mixing with other substances\n";
-            std::cout << "   - Monitor for adverse effects\n";
+        else if (query == "central") {
+            std::vector<InteractionGraph::DrugDegree> ranking = graph.degrees(severity);
+            size_t count = args.size() > 2 ? first : 10;
+            for (size_t r = 0; r < ranking.size() && r < count; ++r) {
+                std::cout << r + 1 << ". " << database.getDrugById(ranking[r].drug)->getName() << ": "
+                          << ranking[r].degree << " " << severityToString(severity) << "+ partners, expected "
+                          << ranking[r].weightedDegree << "\n";
+            }
+            std::cout << "Ranked " << ranking.size() << " drugs";
         }
-        else if (riskPercentage >= 40) {
-            std::cout << "   MODERATE RISK:\n";
-            std::cout << "   - Follow prescribed dosages carefully\n";
-            std::cout << "   - Be aware of tolerance changes\n";
+        else if (query == "cliques") {
+            size_t minSize = args.size() > 2 ? std::max<size_t>(first, 2) : 3;
+            size_t count = args.size() > 3 ? second : 20;
+            InteractionGraph::CliqueResult result = graph.cliques(severity, minSize, count,
+                QueryContext::withTimeout(queryTimeout));
+            for (const auto& clique : result.cliques) {
+                std::cout << clique.size() << " drugs: " << joinDrugNames(clique, 12) << "\n";
+            }
+            std::cout << result.cliques.size() << (result.complete ? "" : "+") << " maximal cliques of "
+                      << minSize << " or more with " << severityToString(severity) << " pairs";
         }
         else {
-            std::cout << "   LOWER RISK:\n";
-            std::cout << "   - Still exercise caution with dosing\n";
-            std::cout << "   - Monitor for unexpected reactions\n";
+            int from = database.getDrugId(args[1]);
+            int to = database.getDrugId(args[2]);
+            if (from < 0 || to < 0) {
+                std::cout << "Error: unknown drug '" << (from < 0 ? args[1] : args[2]) << "'.\n";
+                return 1;
+            }
+            InteractionGraph::SafePath path = graph.safePath(from, to, severity);
+            if (path.drugs.empty()) {
+                std::cout << "No chain from " << args[1] << " to " << args[2] << " stays below "
+                          << severityToString(severity);
+            }
+            else {
+                for (size_t i = 0; i < path.drugs.size(); ++i) {
+                    std::cout << (i ? " -> " : "") << database.getDrugById(path.drugs[i])->getName();
+                }
+                std::cout << "\n" << path.drugs.size() - 1 << (path.drugs.size() == 2 ? " step" : " steps") << " below "
+                          << severityToString(severity)
+                          << ", risk " << path.risk * 100 << "%";
+            }
         }
+        double queryMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << " (" << queryMs << " ms).\n";
+        return 0;
     }
 
-    void displayCombinationWarnings(const std::vector<std::string>& drugNames, int combinedRisk) {
-        std::cout << "=== COMBINATION WARNINGS ===\n";
+    // Dose-aware overdose risk for intakes "<drug>[:<typical doses>[:<tolerance 0-1>]]",
+    // with the sweep chart of the same drugs at multiples of their typical dose
+    int runDoseQuery(const std::vector<std::string>& args) {
+        std::vector<DoseIntake> intakes;
+        for (const auto& arg : args) {
+            size_t first = arg.find(':');
+            size_t second = first == std::string::npos ? first : arg.find(':', first + 1);
+            DoseIntake intake{ database.getDrugId(arg.substr(0, first)), 1.0f, 0.0f };
+            try {
+                if (first != std::string::npos) intake.dose = std::stof(arg.substr(first + 1, second - first - 1));
+                if (second != std::string::npos) intake.tolerance = std::stof(arg.substr(second + 1));
+            }
+            catch (const std::exception&) {
+                intake.dose = -1.0f;
+            }
+            if (intake.drugId < 0 || !(intake.dose >= 0.0f) || !(intake.tolerance >= 0.0f && intake.tolerance <= 1.0f)) {
+                std::cout << "Usage: pharmacology --dose <drug>[:<typical doses>[:<tolerance 0-1>]] ...\n";
+                return 1;
+            }
+            intakes.push_back(intake);
+        }
+
+        DoseResponseTable table(database, overdoseDB, patterns);
+        std::vector<float> risks(intakes.size());
+        table.drugRisks(intakes.data(), intakes.size(), risks.data());
+        std::vector<int> drugIds;
+        for (size_t i = 0; i < intakes.size(); ++i) {
+            const Drug& drug = *database.getDrugById(intakes[i].drugId);
+            DoseResponse response = overdoseDB.getDoseResponse(drug);
+            std::cout << drug.getName() << " at " << intakes[i].dose << "x typical dose, tolerance "
+                      << intakes[i].tolerance << ": " << risks[i] * 100.0f << "% (50% risk at "
+                      << response.midpoint * (1.0 + response.toleranceShift * intakes[i].tolerance) << "x)\n";
+            drugIds.push_back(intakes[i].drugId);
+        }
+        std::cout << "Combined risk: " << table.combinationRisk(intakes.data(), intakes.size()) << "%\n";
 
-        // Check for specific dangerous combinations
-        bool hasOpioid = false;
-        bool hasBenzo = false;
-        bool hasAlcohol = false;
-        bool hasStimulant = false;
+        const float scales[] = { 0.25f, 0.5f, 1.0f, 1.5f, 2.0f, 3.0f, 4.0f, 6.0f, 8.0f, 12.0f, 16.0f };
+        const float tolerances[] = { 0.0f, 0.25f, 0.5f, 0.75f, 1.0f };
+        constexpr size_t SCALES = std::size(scales);
+        constexpr size_t TOLERANCES = std::size(tolerances);
+        constexpr int REPEATS = 1000;
+        float grid[TOLERANCES * SCALES];
+        auto start = std::chrono::steady_clock::now();
+        for (int repeat = 0; repeat < REPEATS; ++repeat) {
+            table.sweep(drugIds.data(), drugIds.size(), scales, SCALES, tolerances, TOLERANCES, grid);
+        }
+        double sweepUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / REPEATS;
 
-        for (const std::string& drug : drugNames) {
-            Drug* drugPtr = database.getDrug(drug);
-            if (drugPtr) {
-                if (drugPtr->getDrugClass() == DrugClass::OPIOID) hasOpioid = true;
-                if (drugPtr->getDrugClass() == DrugClass::BENZODIAZEPINE) hasBenzo = true;
-                if (drugPtr->getDrugClass() == DrugClass::ALCOHOL) hasAlcohol = true;
-                if (drugPtr->getDrugClass() == DrugClass::STIMULANT) hasStimulant = true;
+        std::cout << "\nCombined risk (%) with every drug at a multiple of its typical dose:\n" << std::setw(10) << "tolerance";
+        for (float scale : scales) {
+            std::cout << std::setw(6) << scale << "x";
+        }
+        std::cout << "\n" << std::fixed << std::setprecision(0);
+        for (size_t t = 0; t < TOLERANCES; ++t) {
+            std::cout << std::setw(10) << std::setprecision(2) << tolerances[t] << std::setprecision(0);
+            for (size_t s = 0; s < SCALES; ++s) {
+                std::cout << std::setw(7) << grid[t * SCALES + s];
             }
+            std::cout << "\n";
+        }
+        std::cout << std::defaultfloat << std::setprecision(6) << TOLERANCES * SCALES << " points in " << sweepUs
+                  << " us per sweep (" << table.getCurveCount() << " curves, " << table.getMemoryBytes() / 1024
+                  << " KB of tables).\n";
+        return 0;
+    }
+
+    // Interactions and overdose risk of a regimen for one patient profile, next to
+    // the baseline figures
+    int runProfileQuery(const std::string& profileText, const std::vector<std::string>& drugNames) {
+        PatientProfile profile;
+        if (!parsePatientProfile(profileText, profile)) {
+            std::cout << "Error: unknown profile '" << profileText << "'; use normal or any of cyp2d6-poor, "
+                "cyp2d6-ultrarapid, cyp3a4-inhibited, hepatic, renal, opioid-tolerant joined by commas.\n";
+            return 1;
+        }
+        std::vector<Drug> drugs;
+        std::vector<int> ids;
+        for (const auto& name : drugNames) {
+            int id = database.getDrugId(name);
+            if (id < 0) {
+                std::cout << "Error: unknown drug '" << name << "'.\n";
+                return 1;
+            }
+            drugs.push_back(*database.getDrugById(id));
+            ids.push_back(id);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::shared_ptr<const PhenotypeTables> phenotype = getPharmacogenomics().getTables(profile);
+        double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Phenotype " << profile.toString() << " (key " << profile.phenotypeKey() << "): "
+                  << phenotype->getAdjustedDrugCount() << " of " << database.getDrugCount()
+                  << " drugs adjusted, tables built in " << buildMs << " ms\n\n";
+
+        for (const auto& drug : drugs) {
+            int id = drug.getId();
+            std::cout << drug.getName() << ": exposure x" << phenotype->getExposure(id) << ", half-life "
+                      << drug.getHalfLife() << " -> " << phenotype->getHalfLife(id) << " h, overdose "
+                      << overdoseDB.getOverdosePercentage(drug.getName()) << "% -> "
+                      << phenotype->getOverdosePercentage(id) << "%\n";
+        }
+
+        if (drugs.size() >= 2) {
+            std::vector<InteractionEffect> baseline = analyzer.analyzeMultipleInteractions(drugs);
+            start = std::chrono::steady_clock::now();
+            InteractionOutcome outcome = analyzer.analyzeMultipleInteractions(drugs,
+                QueryContext::withTimeout(queryTimeout), phenotype->getExposure());
+            double queryUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "\nInteractions for this patient" << (outcome.complete ? "" : " (incomplete)") << ":\n";
+            for (const auto& effect : outcome.effects) {
+                auto base = std::find_if(baseline.begin(), baseline.end(),
+                    [&effect](const InteractionEffect& other) { return other.effect == effect.effect; });
+                std::cout << "  " << effectToString(effect.effect) << ": " << severityToString(effect.severity) << ", "
+                          << effect.probability * 100.0 << "%";
+                if (base != baseline.end() && (base->severity != effect.severity || base->probability != effect.probability)) {
+                    std::cout << " (baseline " << severityToString(base->severity) << ", " << base->probability * 100.0 << "%)";
+                }
+                std::cout << "\n";
+            }
+            std::cout << "Analyzed in " << queryUs << " us\n";
+        }
+
+        int baselineRisk = drugs.size() == 1 ? overdoseDB.getOverdosePercentage(drugNames[0])
+            : overdoseDB.calculateCombinationRisk(drugNames, patterns);
+        int patientRisk = drugs.size() == 1 ? phenotype->getOverdosePercentage(ids[0]) : phenotype->combinationRisk(ids);
+        std::cout << "\nCombined overdose risk: " << patientRisk << "% (baseline " << baselineRisk << "%)\n";
+        return 0;
+    }
+
+    // Writes the compact catalog image for low-memory devices
+    int runCompactBuild(const std::string& outputPath) {
+        CompactCatalog catalog;
+        if (!catalog.build(database, analyzer, overdoseDB, patterns)) {
+            std::cout << "Error: catalog too large for the compact format.\n";
+            return 1;
+        }
+        if (!catalog.save(outputPath)) {
+            std::cout << "Error: cannot write compact catalog '" << outputPath << "'.\n";
+            return 1;
+        }
+        std::cout << "Wrote " << catalog.getDrugCount() << " drugs, " << catalog.getMemoryBytes()
+                  << " bytes working set.\n";
+        return 0;
+    }
+
+    // Analyzes a regimen with nothing but a compact catalog image
+    static int runCompactAnalysis(const std::string& imagePath, const std::vector<std::string>& drugNames) {
+        CompactCatalog catalog;
+        if (!catalog.load(imagePath)) {
+            std::cout << "Error: cannot load compact catalog '" << imagePath << "'.\n";
+            return 1;
+        }
+
+        std::vector<int> ids;
+        for (const auto& name : drugNames) {
+            int id = catalog.findDrug(name);
+            if (id >= 0) {
+                ids.push_back(id);
+            }
+            else {
+                std::cout << "Warning: Drug '" << name << "' not found.\n";
+            }
+        }
+
+        CompactEffect effects[SIDE_EFFECT_COUNT];
+        size_t count = catalog.analyze(ids.data(), ids.size(), effects);
+        for (size_t i = 0; i < count; ++i) {
+            std::cout << effectToString(static_cast<SideEffect>(effects[i].effect)) << " ("
+                      << severityToString(static_cast<InteractionSeverity>(effects[i].severity)) << ", "
+                      << effects[i].probability * 100 / CompactCatalog::Q15_ONE << "%): "
+                      << catalog.getDescription(effects[i].descriptionId) << "\n";
+        }
+        int combinedRisk = (ids.size() == 1) ? catalog.getOverdosePercentage(ids[0])
+            : catalog.combinationRisk(ids.data(), ids.size());
+        std::cout << "Combined Overdose Risk: " << combinedRisk << "%\n";
+        std::cout << "Working set: " << catalog.getMemoryBytes() << " bytes\n";
+        return 0;
+    }
+
+    // Prints every audited assessment of the given regimen, for the given patient
+    // profile or else for none
+    int runAuditQuery(std::vector<std::string> drugNames) {
+        if (!auditLog) return 1;
+
+        std::string profileName;
+        if (!drugNames.empty() && drugNames[0][0] == '@') {
+            PatientProfile profile;
+            if (!parsePatientProfile(drugNames[0].substr(1), profile)) {
+                std::cout << "Error: unknown profile '" << drugNames[0].substr(1) << "'.\n";
+                return 1;
+            }
+            profileName = profile.toString();
+            drugNames.erase(drugNames.begin());
+        }
+        std::vector<AuditRecord> records = auditLog->findByRegimen(drugNames, profileName);
+        for (const auto& record : records) {
+            std::cout << "t=" << record.timestamp << " catalog " << std::hex << record.catalogVersion
+                      << std::dec << ": ";
+            for (size_t i = 0; i < record.drugs.size(); ++i) {
+                std::cout << record.drugs[i];
+                if (i < record.drugs.size() - 1) std::cout << " + ";
+            }
+            if (!record.profile.empty()) std::cout << " for " << record.profile;
+            std::cout << ", combined risk " << record.combinedRisk << "%";
+            if (!record.complete) {
+                std::cout << " (partial: " << record.pairsAnalyzed << " of " << record.pairCount << " pairs)";
+            }
+            std::cout << "\n";
+            for (size_t i = 0; i < record.effects.size(); ++i) {
+                const InteractionEffect& effect = record.effects[i];
+                std::cout << "   " << effectToString(effect.effect) << " ("
+                          << severityToString(effect.severity) << ", "
+                          << (effect.probability * 100) << "%)";
+                if (i < record.descriptions.size()) std::cout << ": " << record.descriptions[i];
+                std::cout << "\n";
+            }
+        }
+        std::cout << records.size() << " audited assessments.\n";
+        return 0;
+    }
+
+    // Diffs every optimized engine path against the frozen reference implementation
+    int runVerification(const DifferentialHarness::Options& options) {
+        DifferentialHarness harness(database, analyzer, overdoseDB, options);
+        harness.addInteractionPath("analyzeMultipleInteractions",
+            [this](const std::vector<Drug>& drugs) { return analyzer.analyzeMultipleInteractions(drugs); });
+        harness.addInteractionPath("analyzeMultipleInteractionsBucketed",
+            [this](const std::vector<Drug>& drugs) { return analyzer.analyzeMultipleInteractionsBucketed(drugs); });
+        harness.addInteractionPath("analyzeMultipleInteractions (QueryContext)",
+            [this, never = std::make_shared<CancellationToken>()](const std::vector<Drug>& drugs) {
+                return analyzer.analyzeMultipleInteractions(drugs, QueryContext(never.get())).effects;
+            });
+        harness.addInteractionPath("analyzeMultipleInteractions (normal phenotype)",
+            [this, normal = getPharmacogenomics().getTables(PatientProfile())](const std::vector<Drug>& drugs) {
+                return analyzer.analyzeMultipleInteractions(drugs, normal->getExposure());
+            });
+        harness.addScreenPath("InteractionScreen::worstSeverity",
+            [this, triage = getScreen()](const std::vector<Drug>& drugs) {
+                thread_local std::vector<int> ids;
+                ids.clear();
+                for (const auto& drug : drugs) {
+                    ids.push_back(drug.getId());
+                }
+                return triage->worstSeverity(ids);
+            });
+        auto graph = std::make_shared<InteractionGraph>(database, analyzer);
+        graph->update();
+        harness.addScreenPath("InteractionGraph::weight",
+            [graph](const std::vector<Drug>& drugs) {
+                int worst = -1;
+                for (size_t i = 0; i < drugs.size(); ++i) {
+                    for (size_t j = i + 1; j < drugs.size(); ++j) {
+                        worst = std::max<int>(worst, graph->weight(drugs[i].getId(), drugs[j].getId()).severity);
+                    }
+                }
+                return worst;
+            });
+        harness.addRiskPath("calculateCombinationRisk",
+            [this](const std::vector<std::string>& drugs) { return overdoseDB.calculateCombinationRisk(drugs, patterns); });
+        harness.addRiskPath("DoseResponseTable (one typical dose)",
+            [this, table = std::make_shared<DoseResponseTable>(database, overdoseDB, patterns)](
+                const std::vector<std::string>& drugs) {
+                thread_local std::vector<DoseIntake> intakes;
+                intakes.clear();
+                for (const auto& name : drugs) {
+                    intakes.push_back({ database.getDrugId(name), 1.0f, 0.0f });
+                }
+                return static_cast<int>(table->combinationRisk(intakes.data(), intakes.size()));
+            }, 1);
+        harness.addOrderInvariantPath("ParallelEffectReducer (noisy-OR)",
+            [reducer = ParallelEffectReducer(analyzer)](const std::vector<Drug>& drugs, size_t threads) {
+                return reducer.analyze(drugs, threads);
+            });
+        auto compact = std::make_shared<CompactCatalog>();
+        if (compact->build(database, analyzer, overdoseDB, patterns)) {
+            harness.addInteractionPath("CompactCatalog::analyze (Q15)",
+                [compact](const std::vector<Drug>& drugs) {
+                    thread_local std::vector<int> ids;
+                    ids.clear();
+                    for (const auto& drug : drugs) {
+                        ids.push_back(drug.getId());
+                    }
+                    CompactEffect effects[SIDE_EFFECT_COUNT];
+                    size_t count = compact->analyze(ids.data(), ids.size(), effects);
+                    std::vector<InteractionEffect> result;
+                    for (size_t i = 0; i < count; ++i) {
+                        result.push_back({ static_cast<SideEffect>(effects[i].effect),
+                            static_cast<InteractionSeverity>(effects[i].severity),
+                            effects[i].probability / static_cast<double>(CompactCatalog::Q15_ONE), effects[i].descriptionId });
+                    }
+                    return result;
+                }, CompactCatalog::PROBABILITY_TOLERANCE);
+            harness.addRiskPath("CompactCatalog::combinationRisk",
+                [compact](const std::vector<std::string>& drugs) {
+                    thread_local std::vector<int> ids;
+                    ids.clear();
+                    for (const auto& name : drugs) {
+                        ids.push_back(compact->findDrug(name));
+                    }
+                    return compact->combinationRisk(ids.data(), ids.size());
+                });
+        }
+        harness.addPopulationCheck(getScreen());
+        // Both kernels are checked wherever the CPU can run them, whatever the build flags
+        auto kernel = std::make_shared<CombinationRiskKernel>(database, overdoseDB, patterns);
+        for (auto path : { CombinationRiskKernel::Path::SCALAR, CombinationRiskKernel::Path::AVX2 }) {
+            std::string name = path == CombinationRiskKernel::Path::AVX2 ? "CombinationRiskKernel (AVX2)"
+                : "CombinationRiskKernel (scalar)";
+            if (!CombinationRiskKernel::supports(path)) {
+                std::cout << name << ": not supported on this CPU, not checked.\n";
+                continue;
+            }
+            harness.addBatchRiskPath(name, [kernel, path](const std::vector<int32_t>& offsets,
+                const std::vector<int32_t>& drugIds, std::vector<uint8_t>& risks) {
+                kernel->score(offsets.data(), drugIds.data(), risks.size(), risks.data(), path);
+            });
+        }
+        return harness.run(std::cout) ? 0 : 1;
+    }
+
+private:
+    // Interaction result for the report templates, effects sorted by severity
+    InteractionReport buildInteractionReport(const std::vector<std::string>& drugNames,
+        InteractionOutcome outcome) const {
+        std::vector<InteractionEffect>& effects = outcome.effects;
+        std::ranges::sort(effects,
+                          [](const InteractionEffect& a, const InteractionEffect& b) {
+                              return a.severity > b.severity;
+                          });
+
+        InteractionReport report;
+        report.drugNames = drugNames;
+        report.complete = outcome.complete;
+        report.pairsAnalyzed = outcome.pairsAnalyzed;
+        report.pairCount = outcome.pairCount;
+        for (const auto& effect : effects) {
+            report.effects.push_back({ effect.effect, effect.severity, effect.probability,
+                &analyzer.getDescription(effect) });
+        }
+        return report;
+    }
+
+    OverdoseReport buildOverdoseReport(const std::vector<std::string>& drugNames) const {
+        OverdoseReport report;
+        report.drugNames = drugNames;
+        for (const std::string& drugName : drugNames) {
+            report.percentages.push_back(overdoseDB.getOverdosePercentage(drugName));
+        }
+
+        if (drugNames.size() == 1) {
+            report.combinedRisk = report.percentages[0];
+            report.riskLevel = overdoseDB.getRiskDescription(drugNames[0]);
+            return report;
+        }
+        report.combinedRisk = overdoseDB.calculateCombinationRisk(drugNames, patterns);
+        report.riskLevel = getCombinedRiskDescription(report.combinedRisk);
+
+        // Same patterns as the risk score
+        uint64_t mask = patterns.regimenMask(drugNames);
+        report.lethalCombination = patterns.matches(mask, CombinationPatterns::LETHAL_COMBINATION);
+        report.speedball = patterns.matches(mask, CombinationPatterns::SPEEDBALL);
+        return report;
+    }
+
+    // Interactive, served and reported regimens. The noisy-OR reduction has no
+    // deadline, so its result is always complete.
+    InteractionOutcome analyzeRegimen(const std::vector<Drug>& drugs, const QueryContext& context) const {
+        if (effectCombination == EffectCombination::SEQUENTIAL) {
+            return analyzer.analyzeMultipleInteractions(drugs, context);
         }
+        size_t pairs = drugs.size() < 2 ? 0 : drugs.size() * (drugs.size() - 1) / 2;
+        return { ParallelEffectReducer(analyzer).analyze(drugs), true, pairs, pairs };
+    }
 
-        if ((hasOpioid && hasBenzo) || (hasOpioid && hasAlcohol) || (hasBenzo && hasAlcohol)) {
-            std::cout << "   LETHAL COMBINATION DETECTED!\n";
-            std::cout << "   - Respiratory depression risk extremely high\n";
-            std::cout << "   - This combination is responsible for majority of overdose deaths\n";
-            std::cout << "   - Seek immediate medical help if experiencing breathing difficulties\n";
+    void analyzeAndDisplayResults(const std::vector<Drug>& drugs,
+        const std::vector<std::string>& drugNames) {
+        InteractionOutcome outcome = analyzeRegimen(drugs, QueryContext::withTimeout(queryTimeout));
+        auditAssessment(drugNames, outcome);
+
+        std::cout << reports.render(buildInteractionReport(drugNames, std::move(outcome)), ReportFormat::TEXT);
+    }
+
+    void analyzeOverdoseRisk(const std::vector<std::string>& drugNames) {
+        if (auditLog) {
+            std::vector<Drug> drugs;
+            for (const auto& drugName : drugNames) {
+                drugs.push_back(*database.getDrug(drugName));
+            }
+            auditAssessment(drugNames, drugs.size() >= 2 ? analyzeRegimen(drugs, QueryContext()) : InteractionOutcome());
         }
 
-        if (hasStimulant && (hasOpioid || hasBenzo || hasAlcohol)) {
-            std::cout << "   DANGEROUS SPEEDBALL COMBINATION!\n";
-            std::cout << "   - Masking effects can lead to unexpected overdose\n";
-            std::cout << "   - Cardiac stress significantly increased\n";
+        std::cout << reports.render(buildOverdoseReport(drugNames), ReportFormat::TEXT);
+    }
+
+    // The letter for one regimen, rendered into the calling thread's buffer.
+    // `analyzed`, when given, receives the interaction outcome it reports.
+    const std::string& renderLetter(const std::vector<std::string>& drugNames, ReportFormat format,
+        InteractionOutcome* analyzed = nullptr) const {
+        if (analyzed) *analyzed = InteractionOutcome();
+        if (drugNames.size() < 2) {
+            return reports.renderLetter(nullptr, buildOverdoseReport(drugNames), format);
         }
 
-        if (combinedRisk >= 80) {
-            std::cout << "   EMERGENCY PREPAREDNESS ESSENTIAL:\n";
-            std::cout << "   - Have naloxone (Narcan) immediately available\n";
-            std::cout << "   - Ensure someone trained in overdose response is present\n";
-            std::cout << "   - Know emergency contact numbers\n";
+        std::vector<Drug> drugs;
+        for (const auto& drugName : drugNames) {
+            drugs.push_back(*database.getDrugById(database.getDrugId(drugName)));
         }
+        InteractionOutcome outcome = analyzeRegimen(drugs, QueryContext::withTimeout(queryTimeout));
+        if (analyzed) *analyzed = outcome;
+        InteractionReport interaction = buildInteractionReport(drugNames, std::move(outcome));
+        return reports.renderLetter(&interaction, buildOverdoseReport(drugNames), format);
     }
 
-    std::string getCombinedRiskDescription(int combinedRisk) {
+    static std::string getCombinedRiskDescription(int combinedRisk) {
         if (combinedRisk >= 90) return "Extremely High Risk - Life Threatening";
         if (combinedRisk >= 75) return "Very High Risk - Dangerous Combination";
         if (combinedRisk >= 60) return "High Risk - Significant Danger";
@@ -353,8 +1452,236 @@ private:
     }
 };
 
-int main() {
+int main(int argc, char* argv[]) {
     PharmacologyProgram program;
+    std::string executable = argv[0];
+
+    // Extended catalog, per-query time budget and effect combination, valid in front of any mode:
+    // pharmacology --catalog <file> --deadline <milliseconds> --combine <sequential|noisy-or> ...
+    while (argc >= 3 && (std::string(argv[1]) == "--catalog" || std::string(argv[1]) == "--deadline" ||
+        std::string(argv[1]) == "--combine")) {
+        if (std::string(argv[1]) == "--combine") {
+            EffectCombination combination;
+            if (!parseEffectCombination(argv[2], combination)) {
+                std::cout << "Usage: pharmacology --combine <sequential|noisy-or> ...\n";
+                return 1;
+            }
+            program.setEffectCombination(combination);
+        }
+        else if (std::string(argv[1]) == "--deadline") {
+            try {
+                program.setQueryTimeout(std::chrono::milliseconds(std::stol(argv[2])));
+            }
+            catch (const std::exception&) {
+                std::cout << "Usage: pharmacology --deadline <milliseconds> ...\n";
+                return 1;
+            }
+        }
+        else {
+            std::string error;
+            if (!program.loadCatalog(argv[2], error)) {
+                std::cout << "Error: " << error << "\n";
+                return 1;
+            }
+        }
+        argc -= 2;
+        argv += 2;
+    }
+
+    // Audit option, valid in front of any mode: pharmacology --audit <directory> ...
+    if (argc >= 3 && std::string(argv[1]) == "--audit") {
+        if (!program.enableAudit(argv[2])) {
+            std::cout << "Error: cannot open audit log '" << argv[2] << "'.\n";
+            return 1;
+        }
+        argc -= 2;
+        argv += 2;
+
+        // Lookup mode: pharmacology --audit <directory> --lookup [@profile] <drug> [drug...]
+        if (argc >= 3 && std::string(argv[1]) == "--lookup") {
+            return program.runAuditQuery(std::vector<std::string>(argv + 2, argv + argc));
+        }
+    }
+
+    // Batch mode: pharmacology --batch <regimens.txt> <results.phrc> [--stats]
+    if ((argc == 4 || argc == 5) && std::string(argv[1]) == "--batch") {
+        bool withStatistics = argc == 5 && std::string(argv[4]) == "--stats";
+        return program.runBatch(argv[2], argv[3], withStatistics);
+    }
+
+    // Sharded batch: pharmacology --sharded <regimens.txt> <results.phrc> <workers> [shards] [--stats]
+    //                [--command [prefix]] [--timeout <seconds per attempt>]
+    if (argc >= 5 && std::string(argv[1]) == "--sharded") {
+        ShardCoordinator::Options options;
+        bool throughCommand = false;
+        std::string commandPrefix;
+        bool valid = true;
+        try {
+            options.workers = std::stoul(argv[4]);
+            int next = 5;
+            if (next < argc && std::isdigit(static_cast<unsigned char>(argv[next][0]))) {
+                options.shards = std::stoul(argv[next++]);
+            }
+            for (; next < argc && valid; ++next) {
+                std::string flag = argv[next];
+                if (flag == "--stats") {
+                    options.statistics = true;
+                }
+                else if (flag == "--command") {
+                    throughCommand = true;
+                    if (next + 1 < argc && std::string(argv[next + 1]).rfind("--", 0) != 0) commandPrefix = argv[++next];
+                }
+                else if (flag == "--timeout" && next + 1 < argc) {
+                    options.attemptTimeout = std::chrono::seconds(std::stoul(argv[++next]));
+                }
+                else {
+                    valid = false;
+                }
+            }
+        }
+        catch (const std::exception&) {
+            valid = false;
+        }
+        if (!valid || options.workers == 0) {
+            std::cout << "Usage: pharmacology --sharded <regimens.txt> <results.phrc> <workers> [shards] [--stats] "
+                "[--command [prefix]] [--timeout <seconds>]\n";
+            return 1;
+        }
+        return program.runShardedBatch(argv[2], argv[3], options, throughCommand, commandPrefix,
+            executable);
+    }
+
+    // Shard worker, started by --sharded --command:
+    // pharmacology --batch-shard <regimens.txt> <begin> <end> <first regimen id> <results.phrc> <progress file>
+    //     [statistics file]
+    if ((argc == 8 || argc == 9) && std::string(argv[1]) == "--batch-shard") {
+        ShardTask task;
+        try {
+            task.shard.begin = std::stoull(argv[3]);
+            task.shard.end = std::stoull(argv[4]);
+            task.shard.firstRegimenId = std::stoull(argv[5]);
+        }
+        catch (const std::exception&) {
+            return 2;
+        }
+        task.outputPath = argv[6];
+        task.progressPath = argv[7];
+        if (argc == 9) task.statisticsPath = argv[8];
+        return program.runBatchShard(argv[2], task);
+    }
+
+    // Triage mode: pharmacology --screen <regimens.txt> [lethal|major]
+    if ((argc == 3 || argc == 4) && std::string(argv[1]) == "--screen") {
+        bool majorOrWorse = argc == 4 && std::string(argv[3]) == "major";
+        return program.runScreen(argv[2],
+            majorOrWorse ? InteractionSeverity::MAJOR : InteractionSeverity::LETHAL);
+    }
+
+    // Stream mode: pharmacology --stream <events.txt>
+    if (argc == 3 && std::string(argv[1]) == "--stream") {
+        return program.runStream(argv[2]);
+    }
+
+    // Mixed mode: pharmacology --serve <regimens.txt>, interactive regimens on standard input
+    if (argc == 3 && std::string(argv[1]) == "--serve") {
+        return program.runServe(argv[2]);
+    }
+
+    // Load generation: pharmacology --load [profile.txt] [batch]
+    if (argc >= 2 && std::string(argv[1]) == "--load") {
+        bool throughBatch = std::string(argv[argc - 1]) == "batch";
+        std::string profilePath = (argc >= 3 && std::string(argv[2]) != "batch") ? argv[2] : "";
+        return program.runSyntheticLoad(profilePath, throughBatch, executable);
+    }
+
+    // Traffic replay: pharmacology --replay <regimens.txt> <rate> [concurrency] [batch]
+    if (argc >= 4 && std::string(argv[1]) == "--replay") {
+        bool throughBatch = std::string(argv[argc - 1]) == "batch";
+        try {
+            double rate = std::stod(argv[3]);
+            size_t concurrency = (argc >= 5 && std::string(argv[4]) != "batch") ? std::stoul(argv[4]) : 4;
+            return program.runReplay(argv[2], rate, std::max<size_t>(concurrency, 1), throughBatch, executable);
+        }
+        catch (const std::exception&) {
+            std::cout << "Usage: pharmacology --replay <regimens.txt> <rate> [concurrency] [batch]\n";
+            return 1;
+        }
+    }
+
+    // Compact catalog: pharmacology --compact-build <image>, pharmacology --compact <image> <drug>...
+    if (argc == 3 && std::string(argv[1]) == "--compact-build") {
+        return program.runCompactBuild(argv[2]);
+    }
+    if (argc >= 4 && std::string(argv[1]) == "--compact") {
+        return PharmacologyProgram::runCompactAnalysis(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+    }
+
+    // Reports: pharmacology --report <text|html|json> <drug>...
+    // Letters: pharmacology --letters <text|html|json> <regimens.txt> <letters file>
+    if (argc >= 3 && (std::string(argv[1]) == "--report" || std::string(argv[1]) == "--letters")) {
+        bool letters = std::string(argv[1]) == "--letters";
+        ReportFormat format;
+        if (!parseReportFormat(argv[2], format) || argc < 4 || (letters && argc != 5)) {
+            std::cout << "Usage: pharmacology --report <text|html|json> <drug>...\n"
+                      << "       pharmacology --letters <text|html|json> <regimens.txt> <letters file>\n";
+            return 1;
+        }
+        return letters ? program.runLetters(format, argv[3], argv[4])
+            : program.runReport(format, std::vector<std::string>(argv + 3, argv + argc));
+    }
+
+    // Catalog diff: pharmacology --diff <patch catalog> <regimens.txt> <changes.txt> [threshold points]
+    if ((argc == 5 || argc == 6) && std::string(argv[1]) == "--diff") {
+        double threshold = 0.0;
+        try {
+            if (argc == 6) threshold = std::stod(argv[5]);
+        }
+        catch (const std::exception&) {
+            std::cout << "Usage: pharmacology --diff <patch catalog> <regimens.txt> <changes.txt> [threshold points]\n";
+            return 1;
+        }
+        return program.runCatalogDiff(argv[2], argv[3], argv[4], threshold);
+    }
+
+    // Memory accounting: pharmacology --memory [regimens.txt]
+    if ((argc == 2 || argc == 3) && std::string(argv[1]) == "--memory") {
+        return program.runMemoryReport(argc == 3 ? argv[2] : "");
+    }
+
+    // Graph analytics: pharmacology --graph <components|central|cliques|path> ...
+    if (argc >= 2 && std::string(argv[1]) == "--graph") {
+        return program.runGraphQuery(std::vector<std::string>(argv + 2, argv + argc));
+    }
+
+    // Patient profile: pharmacology --profile <trait,...|normal> <drug>...
+    if (argc >= 4 && std::string(argv[1]) == "--profile") {
+        return program.runProfileQuery(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+    }
+
+    // Dose-aware risk: pharmacology --dose <drug>[:<typical doses>[:<tolerance>]] ...
+    if (argc >= 3 && std::string(argv[1]) == "--dose") {
+        return program.runDoseQuery(std::vector<std::string>(argv + 2, argv + argc));
+    }
+
+    // Reverse lookup: pharmacology --index <EFFECT[,SEVERITY[,MIN_PROBABILITY]]>...
+    if (argc >= 3 && std::string(argv[1]) == "--index") {
+        return program.runIndexQuery(std::vector<std::string>(argv + 2, argv + argc));
+    }
+
+    // Verification mode: pharmacology --verify [random regimens] [probability tolerance]
+    if (argc >= 2 && std::string(argv[1]) == "--verify") {
+        DifferentialHarness::Options options;
+        try {
+            if (argc >= 3) options.randomRegimens = std::stoul(argv[2]);
+            if (argc >= 4) options.probabilityTolerance = std::stod(argv[3]);
+        }
+        catch (const std::exception&) {
+            std::cout << "Usage: pharmacology --verify [random regimens] [probability tolerance]\n";
+            return 1;
+        }
+        return program.runVerification(options);
+    }
+
     program.run();
     std::cin.get();
     return 0;
@@ -0,0 +1,148 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory_resource>
+#include <string_view>
+
+// Memory resource that forwards to an upstream resource and counts what passes
+// through it: live bytes, the peak of live bytes, and allocation calls. The
+// counters are relaxed atomics, so one account can be shared by every thread of a
+// subsystem; containers call it once per node or buffer, not per element.
+class AccountingResource : public std::pmr::memory_resource {
+public:
+    struct Stats {
+        size_t liveBytes;
+        size_t peakBytes;
+        size_t allocations;
+        size_t deallocations;
+    };
+
+private:
+    std::pmr::memory_resource* upstream;
+    std::atomic<size_t> liveBytes{ 0 };
+    std::atomic<size_t> peakBytes{ 0 };
+    std::atomic<size_t> allocations{ 0 };
+    std::atomic<size_t> deallocations{ 0 };
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* memory = upstream->allocate(bytes, alignment);
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        size_t live = liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        size_t peak = peakBytes.load(std::memory_order_relaxed);
+        while (live > peak && !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+        }
+        return memory;
+    }
+
+    void do_deallocate(void* memory, size_t bytes, size_t alignment) override {
+        upstream->deallocate(memory, bytes, alignment);
+        deallocations.fetch_add(1, std::memory_order_relaxed);
+        liveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+public:
+    explicit AccountingResource(std::pmr::memory_resource* upstreamResource = std::pmr::new_delete_resource())
+        : upstream(upstreamResource) {
+    }
+
+    Stats getStats() const {
+        return { liveBytes.load(std::memory_order_relaxed), peakBytes.load(std::memory_order_relaxed),
+            allocations.load(std::memory_order_relaxed), deallocations.load(std::memory_order_relaxed) };
+    }
+
+    // Starts a new peak measurement from the current live bytes
+    void resetPeak() {
+        peakBytes.store(liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+};
+
+// Engine parts with their own account. Every instance of a subsystem allocates
+// through the subsystem's account unless it is given another resource. Copies
+// taken out of a subsystem, such as the Drug objects of a regimen being analysed,
+// use the default resource and are not counted.
+enum class MemorySubsystem {
+    DRUG_DATABASE,       // Drug map nodes with their names, effect lists and affinities, and the id table
+    INTERACTION_MATRIX,  // Class matrix nodes and effect lists
+    DESCRIPTIONS,        // Interned description texts and their lookup table
+    PAIR_OVERRIDES,      // Drug-pair override rows and effects
+    OVERDOSE_TABLE,      // Overdose percentage and dose-response nodes, their keys and buckets
+    QUERY_ARENAS         // Query temporaries that outgrow the inline buffer of their arena
+};
+
+constexpr int MEMORY_SUBSYSTEM_COUNT = static_cast<int>(MemorySubsystem::QUERY_ARENAS) + 1;
+
+inline const char* memorySubsystemName(MemorySubsystem subsystem) {
+    static const char* names[MEMORY_SUBSYSTEM_COUNT] = {
+        "Drug database", "Interaction matrix", "Descriptions", "Pair overrides", "Overdose table", "Query arenas"
+    };
+    return names[static_cast<int>(subsystem)];
+}
+
+inline AccountingResource& memoryAccount(MemorySubsystem subsystem) {
+    static AccountingResource accounts[MEMORY_SUBSYSTEM_COUNT];
+    return accounts[static_cast<int>(subsystem)];
+}
+
+// Ordering, hashing and equality for std::pmr::string keys that also take a
+// std::string or a literal, so a lookup never builds a key inside an account
+struct StringKeyLess {
+    using is_transparent = void;
+    bool operator()(std::string_view a, std::string_view b) const { return a < b; }
+};
+
+struct StringKeyHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view key) const { return std::hash<std::string_view>()(key); }
+};
+
+struct StringKeyEqual {
+    using is_transparent = void;
+    bool operator()(std::string_view a, std::string_view b) const { return a == b; }
+};
+
+// Scratch memory for the temporaries of one query. Small allocations bump a
+// pointer through an inline buffer on the caller's stack, then through blocks
+// taken from the QUERY_ARENAS account, and are only returned all at once by
+// release() or destruction. Each query owns its arena, so worker threads never
+// share an allocator while analysing. Large allocations go straight to the
+// account and back when freed, so a vector that keeps growing on a huge regimen
+// does not leave every outgrown buffer behind in the arena.
+class QueryArena : public std::pmr::memory_resource {
+public:
+    static constexpr size_t INLINE_BYTES = 4096;
+    static constexpr size_t LARGE_BYTES = 64 * 1024;
+
+private:
+    alignas(std::max_align_t) std::byte buffer[INLINE_BYTES];
+    std::pmr::monotonic_buffer_resource arena;
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        return bytes >= LARGE_BYTES ? memoryAccount(MemorySubsystem::QUERY_ARENAS).allocate(bytes, alignment)
+            : arena.allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* memory, size_t bytes, size_t alignment) override {
+        if (bytes >= LARGE_BYTES) memoryAccount(MemorySubsystem::QUERY_ARENAS).deallocate(memory, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+public:
+    QueryArena() : arena(buffer, sizeof(buffer), &memoryAccount(MemorySubsystem::QUERY_ARENAS)) {
+    }
+
+    QueryArena(const QueryArena&) = delete;
+    QueryArena& operator=(const QueryArena&) = delete;
+
+    std::pmr::memory_resource* resource() { return this; }
+
+    // Frees the small allocations; large ones belong to the containers holding them
+    void release() { arena.release(); }
+};
@@ -1,7 +1,11 @@
 #pragma once
 #include "drug.h"
+#include "combination_patterns.h"
+#include "memory_accounting.h"
 #include <unordered_map>
 #include <algorithm>
+#include <cmath>
+#include <limits>
 
 enum class OverdoseRisk {
     EXTREMELY_HIGH = 90,  // 90-100% risk category
@@ -12,12 +16,27 @@ enum class OverdoseRisk {
     VERY_LOW = 10         // 10-19% risk category
 };
 
+// Logistic dose-response curve: overdose probability at a dose of d typical doses
+// is 1 / (1 + (midpoint / d)^slope), so the midpoint is the dose (in typical doses)
+// with 50% risk. Full tolerance moves the midpoint to midpoint * (1 + toleranceShift).
+struct DoseResponse {
+    double midpoint;
+    double slope;
+    double toleranceShift;
+
+    static constexpr double MIN_SLOPE = 1.0;
+    static constexpr double MAX_SLOPE = 16.0;
+};
+
 class OverdosePotentialDatabase {
 private:
-    std::unordered_map<std::string, int> overdosePercentages;
+    std::pmr::unordered_map<std::pmr::string, int, StringKeyHash, StringKeyEqual> overdosePercentages;
+    std::pmr::unordered_map<std::pmr::string, DoseResponse, StringKeyHash, StringKeyEqual> doseResponses;  // Only curves set explicitly
 
 public:
-    OverdosePotentialDatabase() {
+    explicit OverdosePotentialDatabase(
+        std::pmr::memory_resource* resource = &memoryAccount(MemorySubsystem::OVERDOSE_TABLE))
+        : overdosePercentages(resource), doseResponses(resource) {
         initializeOverdoseRisks();
     }
 
@@ -89,12 +108,12 @@ public:
         overdosePercentages["nicotine"] = 16;   // Difficult to achieve fatal dose through smoking
     }
 
-    int getOverdosePercentage(const std::string& drugName) const {
+    int getOverdosePercentage(std::string_view drugName) const {
         auto it = overdosePercentages.find(drugName);
         return (it != overdosePercentages.end()) ? it->second : 0;
     }
 
-    OverdoseRisk getOverdoseRiskCategory(const std::string& drugName) const {
+    OverdoseRisk getOverdoseRiskCategory(std::string_view drugName) const {
         int percentage = getOverdosePercentage(drugName);
 
         if (percentage >= 90) return OverdoseRisk::EXTREMELY_HIGH;
@@ -130,53 +149,94 @@ public:
         std::vector<std::string> drugs;
         for (const auto& pair : overdosePercentages) {
             if (getOverdoseRiskCategory(pair.first) == riskLevel) {
-                drugs.push_back(pair.first);
+                drugs.emplace_back(pair.first);
             }
         }
         return drugs;
     }
 
-    int calculateCombinationRisk(const std::vector<std::string>& drugs) const {
-        if (drugs.empty()) return 0;
-
-        double combinedRisk = 0.0;
-        bool hasRespiratoryDepressant = false;
-        bool hasStimulant = false;
+    // Combined risk from the sum of the individual percentages. Individual
+    // percentages are whole numbers, so this is all the per-regimen work there is
+    // once the sum is known; a sum above 100% is certain overdose.
+    static int combinationRiskFromSum(int percentSum, bool speedball) {
+        if (percentSum > 100) return 100;
 
-        for (const std::string& drug : drugs) {
-            int individualRisk = getOverdosePercentage(drug);
-            combinedRisk += individualRisk * 0.01; // Convert to decimal
-
-            // Check for dangerous combinations
-            if (drug == "alcohol" || drug == "heroin" || drug == "fentanyl" ||
-                drug == "xanax" || drug == "valium") {
-                hasRespiratoryDepressant = true;
-            }
-            if (drug == "cocaine" || drug == "methamphetamine" || drug == "adderall") {
-                hasStimulant = true;
-            }
+        double combinedRisk = 1.0 - std::pow(1.0 - percentSum * 0.01, 1.3);
+        if (speedball) {
+            combinedRisk *= 1.4; // Speedball effect
         }
+        return std::min(static_cast<int>(combinedRisk * 100), 99);
+    }
 
-        combinedRisk = 1.0 - std::pow(1.0 - combinedRisk, 1.3);
+    // The speedball multiplier applies when the regimen matches the SPEEDBALL pattern
+    int calculateCombinationRisk(const std::vector<std::string>& drugs, const CombinationPatterns& patterns) const {
+        if (drugs.empty()) return 0;
 
-        if (hasRespiratoryDepressant && hasStimulant) {
-            combinedRisk *= 1.4; // Speedball effect
+        int percentSum = 0;
+        for (const std::string& drug : drugs) {
+            percentSum += getOverdosePercentage(drug);
         }
 
-        int finalRisk = static_cast<int>(combinedRisk * 100);
+        return combinationRiskFromSum(percentSum,
+            patterns.matches(patterns.regimenMask(drugs), CombinationPatterns::SPEEDBALL));
+    }
 
-        if (finalRisk < 0) {
-            return 100;
+    // Steepness and tolerance of a class when a drug has no curve of its own.
+    // Opioid tolerance moves the lethal dose furthest; alcohol and the depressants
+    // have steep curves with little headroom.
+    static DoseResponse classDoseResponse(DrugClass drugClass) {
+        switch (drugClass) {
+        case DrugClass::OPIOID:         return { 1.0, 3.0, 9.0 };
+        case DrugClass::BENZODIAZEPINE: return { 1.0, 2.5, 4.0 };
+        case DrugClass::ALCOHOL:        return { 1.0, 4.0, 1.0 };
+        case DrugClass::DEPRESSANT:     return { 1.0, 3.5, 1.5 };
+        case DrugClass::STIMULANT:      return { 1.0, 2.5, 1.0 };
+        case DrugClass::HALLUCINOGEN:   return { 1.0, 2.0, 0.5 };
+        case DrugClass::CANNABIS:       return { 1.0, 1.5, 1.0 };
+        case DrugClass::INHALANT:       return { 1.0, 3.0, 0.5 };
+        case DrugClass::SYNTHETIC:
+        default:                        return { 1.0, 2.5, 1.0 };
         }
+    }
 
-        return std::min(finalRisk, 99);
+    // False for a non-positive midpoint, a negative shift or a slope out of range
+    bool setDoseResponse(const std::string& name, const DoseResponse& response) {
+        if (!(response.midpoint > 0.0) || !(response.toleranceShift >= 0.0) ||
+            !(response.slope >= DoseResponse::MIN_SLOPE && response.slope <= DoseResponse::MAX_SLOPE)) {
+            return false;
+        }
+        auto it = doseResponses.find(name);
+        if (it != doseResponses.end()) it->second = response;
+        else doseResponses.emplace(name, response);
+        return true;
     }
 
+    // The drug's own curve, or its class curve placed so that one typical dose
+    // without tolerance carries the drug's overdose percentage. A drug with 0% has
+    // an infinite midpoint and no risk at any dose.
+    DoseResponse getDoseResponse(const Drug& drug) const {
+        auto it = doseResponses.find(drug.getName());
+        if (it != doseResponses.end()) return it->second;
+
+        DoseResponse response = classDoseResponse(drug.getDrugClass());
+        int percentage = getOverdosePercentage(drug.getName());
+        if (percentage <= 0) {
+            response.midpoint = std::numeric_limits<double>::infinity();
+        }
+        else {
+            double p = std::clamp(percentage * 0.01, 0.005, 0.995);
+            response.midpoint = std::pow((1.0 - p) / p, 1.0 / response.slope);
+        }
+        return response;
+    }
 
     void addCustomDrug(const std::string& name, int overdosePercentage) {
         auto clamp = [](auto value, auto low, auto high) {
             return std::max(low, std::min(high, value));
             };
-        overdosePercentages[name] = clamp(overdosePercentage, 0, 99);
+        int percentage = clamp(overdosePercentage, 0, 99);
+        auto it = overdosePercentages.find(name);
+        if (it != overdosePercentages.end()) it->second = percentage;
+        else overdosePercentages.emplace(name, percentage);
     }
 };
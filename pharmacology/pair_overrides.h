@@ -0,0 +1,138 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+#include "memory_accounting.h"
+
+// Drug-specific interaction effects that replace the class matrix entry for one
+// pair of catalog drugs.
+//
+// Stored as compressed sparse rows keyed by the lower drug id of each pair: row a
+// lists the higher ids it has overrides with, sorted, and each listed partner owns
+// a contiguous run of effects. Memory is one row offset per catalog drug plus one
+// partner and one effect offset per override, so a 50k drug catalog with a few
+// thousand overrides needs a few hundred KB where a dense pair table would need
+// billions of cells. Rows are short, so a lookup is one offset load and a
+// branch-free binary search over a handful of adjacent ints.
+class PairOverrideTable {
+private:
+    std::pmr::vector<uint32_t> rowStart;      // By lower drug id; rowStart[a + 1] ends row a
+    std::pmr::vector<int32_t> partners;       // Higher drug id, ascending within a row
+    std::pmr::vector<uint32_t> effectStart;   // By partner slot; effectStart[k + 1] ends slot k
+    std::pmr::vector<InteractionEffect> effects;
+    std::pmr::vector<int8_t> worstSeverity;   // By drug id: worst override severity, -1 for none
+
+public:
+    explicit PairOverrideTable(std::pmr::memory_resource* resource = &memoryAccount(MemorySubsystem::PAIR_OVERRIDES))
+        : rowStart(resource), partners(resource), effectStart(resource), effects(resource), worstSeverity(resource) {
+    }
+
+    class Builder {
+    private:
+        struct Entry {
+            int lower;
+            int higher;
+            InteractionEffect effect;
+        };
+        std::vector<Entry> entries;
+
+    public:
+        // Effects of one pair keep the order they were added in; false for a negative id
+        bool add(int drug1, int drug2, const InteractionEffect& effect) {
+            if (drug1 < 0 || drug2 < 0) return false;
+            entries.push_back({ std::min(drug1, drug2), std::max(drug1, drug2), effect });
+            return true;
+        }
+
+        size_t size() const { return entries.size(); }
+
+        PairOverrideTable build() const {
+            std::vector<Entry> sorted = entries;
+            std::stable_sort(sorted.begin(), sorted.end(), [](const Entry& x, const Entry& y) {
+                return x.lower != y.lower ? x.lower < y.lower : x.higher < y.higher;
+            });
+
+            PairOverrideTable table;
+            int drugCount = sorted.empty() ? 0 : 1 + std::max_element(sorted.begin(), sorted.end(),
+                [](const Entry& x, const Entry& y) { return x.higher < y.higher; })->higher;
+            table.rowStart.assign(drugCount + 1, 0);
+            table.worstSeverity.assign(drugCount, -1);
+
+            for (size_t i = 0; i < sorted.size(); ++i) {
+                const Entry& entry = sorted[i];
+                bool newPair = i == 0 || entry.lower != sorted[i - 1].lower || entry.higher != sorted[i - 1].higher;
+                if (newPair) {
+                    table.partners.push_back(entry.higher);
+                    table.effectStart.push_back(static_cast<uint32_t>(table.effects.size()));
+                    ++table.rowStart[entry.lower + 1];
+                }
+                table.effects.push_back(entry.effect);
+                int8_t severity = static_cast<int8_t>(entry.effect.severity);
+                table.worstSeverity[entry.lower] = std::max(table.worstSeverity[entry.lower], severity);
+                table.worstSeverity[entry.higher] = std::max(table.worstSeverity[entry.higher], severity);
+            }
+            table.effectStart.push_back(static_cast<uint32_t>(table.effects.size()));
+
+            for (int a = 0; a < drugCount; ++a) {
+                table.rowStart[a + 1] += table.rowStart[a];
+            }
+            return table;
+        }
+    };
+
+    bool empty() const { return partners.empty(); }
+    size_t getPairCount() const { return partners.size(); }
+    size_t getEffectCount() const { return effects.size(); }
+
+    size_t getMemoryBytes() const {
+        return rowStart.capacity() * sizeof(uint32_t) + partners.capacity() * sizeof(int32_t) +
+            effectStart.capacity() * sizeof(uint32_t) + effects.capacity() * sizeof(InteractionEffect) +
+            worstSeverity.capacity();
+    }
+
+    // True when the drug appears in any override
+    bool involves(int drugId) const {
+        return getWorstSeverity(drugId) >= 0;
+    }
+
+    // Worst severity among the drug's overrides, -1 when it has none
+    int getWorstSeverity(int drugId) const {
+        return static_cast<size_t>(drugId) < worstSeverity.size() ? worstSeverity[drugId] : -1;
+    }
+
+    // Effects stored for the pair (in either order), or nullptr when the pair has no override
+    const InteractionEffect* find(int drug1, int drug2, size_t& count) const {
+        int lower = std::min(drug1, drug2);
+        int higher = std::max(drug1, drug2);
+        if (lower < 0 || static_cast<size_t>(lower) + 1 >= rowStart.size()) return nullptr;
+
+        const int32_t* base = partners.data() + rowStart[lower];
+        size_t length = rowStart[lower + 1] - rowStart[lower];
+        if (length == 0) return nullptr;
+
+        // base ends on the last partner <= higher; the select compiles to a cmov
+        while (length > 1) {
+            size_t half = length / 2;
+            base += (base[half] <= higher) ? half : 0;
+            length -= half;
+        }
+        if (*base != higher) return nullptr;
+
+        size_t slot = base - partners.data();
+        count = effectStart[slot + 1] - effectStart[slot];
+        return effects.data() + effectStart[slot];
+    }
+
+    // Calls visit(lower id, higher id, effects, count) for every pair, lower id first
+    template <typename Visit>
+    void forEachPair(Visit visit) const {
+        for (size_t a = 0; a + 1 < rowStart.size(); ++a) {
+            for (uint32_t k = rowStart[a]; k < rowStart[a + 1]; ++k) {
+                visit(static_cast<int>(a), partners[k], effects.data() + effectStart[k],
+                    static_cast<size_t>(effectStart[k + 1] - effectStart[k]));
+            }
+        }
+    }
+};
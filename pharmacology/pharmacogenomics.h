@@ -0,0 +1,212 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "db.h"
+#include "od_db.h"
+
+// Metabolic traits of a patient that change how much of a drug reaches the body
+// and how long it stays there
+struct PatientProfile {
+    enum class Cyp2d6 : uint8_t {
+        NORMAL,
+        POOR,        // Little CYP2D6 activity
+        ULTRARAPID   // Duplicated CYP2D6 genes
+    };
+
+    Cyp2d6 cyp2d6 = Cyp2d6::NORMAL;
+    bool cyp3a4Inhibited = false;    // Taking a strong CYP3A4 inhibitor
+    bool hepaticImpairment = false;
+    bool renalImpairment = false;
+    bool opioidTolerant = false;
+
+    // Patients with the same key share one set of phenotype tables
+    uint32_t phenotypeKey() const {
+        return static_cast<uint32_t>(cyp2d6) | cyp3a4Inhibited << 2 | hepaticImpairment << 3 |
+            renalImpairment << 4 | opioidTolerant << 5;
+    }
+
+    std::string toString() const {
+        std::string text;
+        auto add = [&text](bool present, const char* term) {
+            if (present) text += (text.empty() ? "" : ",") + std::string(term);
+        };
+        add(cyp2d6 == Cyp2d6::POOR, "cyp2d6-poor");
+        add(cyp2d6 == Cyp2d6::ULTRARAPID, "cyp2d6-ultrarapid");
+        add(cyp3a4Inhibited, "cyp3a4-inhibited");
+        add(hepaticImpairment, "hepatic");
+        add(renalImpairment, "renal");
+        add(opioidTolerant, "opioid-tolerant");
+        return text.empty() ? "normal" : text;
+    }
+};
+
+// Reads comma-separated traits, e.g. "cyp2d6-poor,renal", or "normal" for none
+inline bool parsePatientProfile(const std::string& text, PatientProfile& profile) {
+    profile = PatientProfile();
+    if (text == "normal") return true;
+
+    std::istringstream terms(text);
+    std::string term;
+    bool any = false;
+    while (std::getline(terms, term, ',')) {
+        if (term == "cyp2d6-poor" && profile.cyp2d6 == PatientProfile::Cyp2d6::NORMAL) {
+            profile.cyp2d6 = PatientProfile::Cyp2d6::POOR;
+        }
+        else if (term == "cyp2d6-ultrarapid" && profile.cyp2d6 == PatientProfile::Cyp2d6::NORMAL) {
+            profile.cyp2d6 = PatientProfile::Cyp2d6::ULTRARAPID;
+        }
+        else if (term == "cyp3a4-inhibited") profile.cyp3a4Inhibited = true;
+        else if (term == "hepatic") profile.hepaticImpairment = true;
+        else if (term == "renal") profile.renalImpairment = true;
+        else if (term == "opioid-tolerant") profile.opioidTolerant = true;
+        else return false;
+        any = true;
+    }
+    return any;
+}
+
+// How a profile changes one drug: exposure multiplies the drug's overdose
+// percentage and, through InteractionAnalyzer, the respiratory depression and
+// death risk of its pairs; the half-life factor applies to its elimination.
+struct DrugAdjustment {
+    double exposure = 1.0;
+    double halfLifeFactor = 1.0;
+};
+
+inline DrugAdjustment adjustDrug(const Drug& drug, const PatientProfile& profile) {
+    DrugAdjustment adjustment;
+    uint8_t pathways = drug.getMetabolicPathways();
+    auto apply = [&adjustment](bool applies, double exposure, double halfLifeFactor) {
+        if (!applies) return;
+        adjustment.exposure *= exposure;
+        adjustment.halfLifeFactor *= halfLifeFactor;
+    };
+
+    // A poor metabolizer barely activates prodrugs but accumulates what CYP2D6 clears
+    bool poor = profile.cyp2d6 == PatientProfile::Cyp2d6::POOR;
+    bool ultrarapid = profile.cyp2d6 == PatientProfile::Cyp2d6::ULTRARAPID;
+    apply(poor && (pathways & CYP2D6_ACTIVATED), 0.5, 1.0);
+    apply(poor && (pathways & CYP2D6_CLEARED), 1.5, 2.0);
+    apply(ultrarapid && (pathways & CYP2D6_ACTIVATED), 1.6, 1.0);
+    apply(ultrarapid && (pathways & CYP2D6_CLEARED), 0.7, 0.6);
+    apply(profile.cyp3a4Inhibited && (pathways & CYP3A4_CLEARED), 1.5, 1.8);
+    apply(profile.hepaticImpairment && (pathways & HEPATIC_CLEARED), 1.3, 2.0);
+    apply(profile.renalImpairment && (pathways & RENAL_CLEARED), 1.4, 2.0);
+    apply(profile.opioidTolerant && drug.getDrugClass() == DrugClass::OPIOID, 0.6, 1.0);
+    return adjustment;
+}
+
+// Catalog-wide adjusted values for one phenotype, indexed by catalog id, so
+// analysing a patient costs the same table loads as the baseline path: the
+// exposure table feeds InteractionAnalyzer, and the adjusted overdose
+// percentages feed the usual combination formula.
+class PhenotypeTables {
+private:
+    PatientProfile profile;
+    const CombinationPatterns& patterns;
+    std::vector<float> exposure;           // Empty when no drug is affected
+    std::vector<float> halfLives;          // Effective hours
+    std::vector<uint8_t> overdosePercents;
+    size_t adjustedDrugs = 0;
+
+public:
+    PhenotypeTables(const DrugDatabase& database, const OverdosePotentialDatabase& overdoseDB,
+        const CombinationPatterns& combinationPatterns, const PatientProfile& patientProfile)
+        : profile(patientProfile), patterns(combinationPatterns) {
+        std::vector<float> drugExposure;
+        for (size_t id = 0; id < database.getDrugCount(); ++id) {
+            const Drug& drug = *database.getDrugById(static_cast<int>(id));
+            DrugAdjustment adjustment = adjustDrug(drug, profile);
+            int percent = overdoseDB.getOverdosePercentage(drug.getName());
+            drugExposure.push_back(static_cast<float>(adjustment.exposure));
+            halfLives.push_back(static_cast<float>(drug.getHalfLife() * adjustment.halfLifeFactor));
+            overdosePercents.push_back(static_cast<uint8_t>(std::clamp(
+                static_cast<int>(std::lround(percent * adjustment.exposure)), 0, 99)));
+            if (adjustment.exposure != 1.0 || adjustment.halfLifeFactor != 1.0) ++adjustedDrugs;
+        }
+        bool anyExposure = std::any_of(drugExposure.begin(), drugExposure.end(), [](float value) { return value != 1.0f; });
+        if (anyExposure) exposure = std::move(drugExposure);
+    }
+
+    const PatientProfile& getProfile() const { return profile; }
+    size_t getAdjustedDrugCount() const { return adjustedDrugs; }
+
+    size_t getMemoryBytes() const {
+        return exposure.capacity() * sizeof(float) + halfLives.capacity() * sizeof(float) + overdosePercents.capacity();
+    }
+
+    // For InteractionAnalyzer; empty, which takes the baseline path, when the
+    // phenotype changes no drug's exposure
+    std::span<const float> getExposure() const { return exposure; }
+
+    float getExposure(int drugId) const {
+        return static_cast<size_t>(drugId) < exposure.size() ? exposure[drugId] : 1.0f;
+    }
+
+    double getHalfLife(int drugId) const { return halfLives[drugId]; }
+    int getOverdosePercentage(int drugId) const { return overdosePercents[drugId]; }
+
+    // calculateCombinationRisk with the adjusted percentages
+    int combinationRisk(const std::vector<int>& drugIds) const {
+        if (drugIds.empty()) return 0;
+
+        int percentSum = 0;
+        for (int id : drugIds) {
+            percentSum += overdosePercents[id];
+        }
+        return OverdosePotentialDatabase::combinationRiskFromSum(percentSum,
+            patterns.matches(patterns.regimenMask(drugIds), CombinationPatterns::SPEEDBALL));
+    }
+};
+
+// Phenotype tables built on first use of each phenotype and shared by every
+// query and thread after that. Patients fall into a few dozen phenotypes at
+// most, so millions of profiles need only that many tables. Tables reflect the
+// catalog when they were built; call clear() after changing it.
+class PharmacogenomicCache {
+private:
+    const DrugDatabase& database;
+    const OverdosePotentialDatabase& overdoseDB;
+    const CombinationPatterns& patterns;
+    mutable std::shared_mutex mutex;
+    std::unordered_map<uint32_t, std::shared_ptr<const PhenotypeTables>> tables;
+
+public:
+    PharmacogenomicCache(const DrugDatabase& db, const OverdosePotentialDatabase& overdoseDatabase,
+        const CombinationPatterns& combinationPatterns)
+        : database(db), overdoseDB(overdoseDatabase), patterns(combinationPatterns) {
+    }
+
+    std::shared_ptr<const PhenotypeTables> getTables(const PatientProfile& profile) {
+        uint32_t key = profile.phenotypeKey();
+        {
+            std::shared_lock lock(mutex);
+            auto it = tables.find(key);
+            if (it != tables.end()) return it->second;
+        }
+
+        // Built outside the lock; if another thread got there first its tables win
+        auto built = std::make_shared<const PhenotypeTables>(database, overdoseDB, patterns, profile);
+        std::unique_lock lock(mutex);
+        return tables.emplace(key, std::move(built)).first->second;
+    }
+
+    size_t getPhenotypeCount() const {
+        std::shared_lock lock(mutex);
+        return tables.size();
+    }
+
+    void clear() {
+        std::unique_lock lock(mutex);
+        tables.clear();
+    }
+};
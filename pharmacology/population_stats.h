@@ -0,0 +1,456 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "db.h"
+#include "interaction_screen.h"
+
+// Fixed-memory, mergeable statistics for cohort-wide reports. Each batch worker
+// thread feeds its own PopulationAggregator and the partial aggregators are merged
+// at the end, so memory does not grow with the number of records. Everything but
+// the heavy-hitter list is an exact count, so a merged aggregator reports the same
+// figures as one fed in a single pass, whatever the split.
+
+constexpr uint16_t POPULATION_STATS_VERSION = 1;
+
+// Values of a saved aggregator, little-endian as in memory like the .phrc columns
+template <typename T>
+void writeStatisticsValue(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readStatisticsValue(std::istream& in, T& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+inline uint64_t mixHash(uint64_t value) {
+    // splitmix64 finalizer
+    value += 0x9e3779b97f4a7c15ULL;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+inline uint64_t hashString(const std::string& text) {
+    // FNV-1a, then mixed for better high bits
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : text) {
+        hash = (hash ^ c) * 0x100000001b3ULL;
+    }
+    return mixHash(hash);
+}
+
+// Space-saving heavy hitters: keeps the `capacity` most frequent keys; a key's
+// count may be overestimated by at most its recorded error
+class SpaceSaving {
+public:
+    struct Entry {
+        uint64_t key;
+        uint64_t count;
+        uint64_t error;
+    };
+
+private:
+    size_t capacity;
+    std::vector<Entry> entries;
+    std::unordered_map<uint64_t, size_t> positions;
+
+    uint64_t minCount() const {
+        if (entries.size() < capacity) return 0;
+        uint64_t result = UINT64_MAX;
+        for (const auto& entry : entries) {
+            result = std::min(result, entry.count);
+        }
+        return result;
+    }
+
+public:
+    explicit SpaceSaving(size_t entryCapacity = 64) : capacity(entryCapacity) {}
+
+    void add(uint64_t key, uint64_t count = 1) {
+        auto it = positions.find(key);
+        if (it != positions.end()) {
+            entries[it->second].count += count;
+            return;
+        }
+        if (entries.size() < capacity) {
+            positions[key] = entries.size();
+            entries.push_back({ key, count, 0 });
+            return;
+        }
+
+        // Evict the smallest entry; the newcomer inherits its count as error
+        size_t victim = 0;
+        for (size_t i = 1; i < entries.size(); ++i) {
+            if (entries[i].count < entries[victim].count) victim = i;
+        }
+        positions.erase(entries[victim].key);
+        uint64_t floor = entries[victim].count;
+        entries[victim] = { key, floor + count, floor };
+        positions[key] = victim;
+    }
+
+    void merge(const SpaceSaving& other) {
+        uint64_t ownFloor = minCount();
+        uint64_t otherFloor = other.minCount();
+
+        std::unordered_map<uint64_t, Entry> combined;
+        for (const auto& entry : entries) {
+            combined[entry.key] = { entry.key, entry.count + otherFloor, entry.error + otherFloor };
+        }
+        for (const auto& entry : other.entries) {
+            auto it = combined.find(entry.key);
+            if (it != combined.end()) {
+                it->second.count += entry.count - otherFloor;
+                it->second.error += entry.error - otherFloor;
+            }
+            else {
+                combined[entry.key] = { entry.key, entry.count + ownFloor, entry.error + ownFloor };
+            }
+        }
+
+        std::vector<Entry> merged;
+        for (const auto& pair : combined) {
+            merged.push_back(pair.second);
+        }
+        std::sort(merged.begin(), merged.end(), [](const Entry& a, const Entry& b) {
+            return a.count != b.count ? a.count > b.count : a.key < b.key;
+        });
+        if (merged.size() > capacity) merged.resize(capacity);
+
+        entries = std::move(merged);
+        positions.clear();
+        for (size_t i = 0; i < entries.size(); ++i) {
+            positions[entries[i].key] = i;
+        }
+    }
+
+    void write(std::ostream& out) const {
+        writeStatisticsValue(out, static_cast<uint64_t>(capacity));
+        writeStatisticsValue(out, static_cast<uint64_t>(entries.size()));
+        for (const auto& entry : entries) {
+            writeStatisticsValue(out, entry);
+        }
+    }
+
+    // False when the data is truncated or was written with another capacity
+    bool read(std::istream& in) {
+        uint64_t savedCapacity = 0, count = 0;
+        if (!readStatisticsValue(in, savedCapacity) || !readStatisticsValue(in, count) ||
+            savedCapacity != capacity || count > capacity) {
+            return false;
+        }
+        entries.resize(count);
+        positions.clear();
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (!readStatisticsValue(in, entries[i])) return false;
+            positions[entries[i].key] = i;
+        }
+        return true;
+    }
+
+    // Entries ordered by count, highest first
+    std::vector<Entry> top(size_t count) const {
+        std::vector<Entry> result = entries;
+        std::sort(result.begin(), result.end(), [](const Entry& a, const Entry& b) {
+            return a.count != b.count ? a.count > b.count : a.key < b.key;
+        });
+        if (result.size() > count) result.resize(count);
+        return result;
+    }
+};
+
+// Exact distribution of whole-percent risk scores. Scores only take the values
+// 0-100, so a counter per value is smaller than a quantile sketch and merges
+// without error.
+class RiskHistogram {
+private:
+    static constexpr int MAX_SCORE = 100;
+
+    std::array<uint64_t, MAX_SCORE + 1> counts{};
+    uint64_t total = 0;
+
+public:
+    void add(int score) {
+        ++counts[std::clamp(score, 0, MAX_SCORE)];
+        ++total;
+    }
+
+    void merge(const RiskHistogram& other) {
+        for (int score = 0; score <= MAX_SCORE; ++score) {
+            counts[score] += other.counts[score];
+        }
+        total += other.total;
+    }
+
+    // Smallest score with at least a fraction q of all scores at or below it
+    int quantile(double q) const {
+        if (total == 0) return 0;
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(total))));
+        uint64_t cumulative = 0;
+        for (int score = 0; score <= MAX_SCORE; ++score) {
+            cumulative += counts[score];
+            if (cumulative >= rank) return score;
+        }
+        return MAX_SCORE;
+    }
+
+    uint64_t count() const { return total; }
+
+    void write(std::ostream& out) const {
+        writeStatisticsValue(out, counts);
+    }
+
+    bool read(std::istream& in) {
+        if (!readStatisticsValue(in, counts)) return false;
+        total = 0;
+        for (uint64_t count : counts) {
+            total += count;
+        }
+        return true;
+    }
+
+    bool operator==(const RiskHistogram& other) const = default;
+};
+
+// HyperLogLog distinct counter; 2^precision one-byte registers, ~1.04/sqrt(m) error
+class HyperLogLog {
+private:
+    int precision;
+    std::vector<uint8_t> registers;
+
+public:
+    explicit HyperLogLog(int registerBits = 14)
+        : precision(registerBits), registers(size_t(1) << registerBits, 0) {
+    }
+
+    void addHash(uint64_t hash) {
+        size_t index = hash >> (64 - precision);
+        uint64_t rest = (hash << precision) | (uint64_t(1) << (precision - 1));
+        uint8_t rank = 1;
+        while ((rest & (uint64_t(1) << 63)) == 0) {
+            ++rank;
+            rest <<= 1;
+        }
+        registers[index] = std::max(registers[index], rank);
+    }
+
+    void merge(const HyperLogLog& other) {
+        for (size_t i = 0; i < registers.size(); ++i) {
+            registers[i] = std::max(registers[i], other.registers[i]);
+        }
+    }
+
+    void write(std::ostream& out) const {
+        writeStatisticsValue(out, precision);
+        out.write(reinterpret_cast<const char*>(registers.data()), static_cast<std::streamsize>(registers.size()));
+    }
+
+    // False when the data is truncated or was written with another precision
+    bool read(std::istream& in) {
+        int savedPrecision = 0;
+        return readStatisticsValue(in, savedPrecision) && savedPrecision == precision &&
+            in.read(reinterpret_cast<char*>(registers.data()), static_cast<std::streamsize>(registers.size()));
+    }
+
+    bool operator==(const HyperLogLog& other) const = default;
+
+    double estimate() const {
+        double m = static_cast<double>(registers.size());
+        double sum = 0.0;
+        size_t zeros = 0;
+        for (uint8_t value : registers) {
+            sum += std::ldexp(1.0, -value);
+            if (value == 0) ++zeros;
+        }
+
+        double alpha = 0.7213 / (1.0 + 1.079 / m);
+        double raw = alpha * m * m / sum;
+        if (raw <= 2.5 * m && zeros > 0) {
+            return m * std::log(m / zeros);  // Linear counting for small cardinalities
+        }
+        return raw;
+    }
+};
+
+class PopulationAggregator {
+private:
+    static constexpr int SEVERITY_TIERS = InteractionAnalyzer::SEVERITY_TIERS;
+
+    const DrugDatabase& database;
+    std::shared_ptr<const InteractionScreen> pairScreen;
+
+    uint64_t records = 0;
+    std::array<uint64_t, SIDE_EFFECT_COUNT * SEVERITY_TIERS> effectSeverityCounts{};
+    std::array<uint64_t, DRUG_CLASS_COUNT * DRUG_CLASS_COUNT> classPairCounts{};  // Upper triangle used
+    SpaceSaving lethalPairs;
+    RiskHistogram riskDistribution;
+    HyperLogLog distinctPatients;
+
+    static uint64_t pairKey(uint64_t a, uint64_t b) {
+        return a < b ? (a << 32) | b : (b << 32) | a;
+    }
+
+    static size_t classPairIndex(DrugClass a, DrugClass b) {
+        int first = static_cast<int>(a);
+        int second = static_cast<int>(b);
+        return first < second ? first * DRUG_CLASS_COUNT + second : second * DRUG_CLASS_COUNT + first;
+    }
+
+public:
+    // The screen is only read, so one instance can be shared by every aggregator
+    PopulationAggregator(const DrugDatabase& db, std::shared_ptr<const InteractionScreen> screen)
+        : database(db), pairScreen(std::move(screen)) {
+    }
+
+    // Empty aggregator over the same catalog and screen, for one worker's share
+    PopulationAggregator emptyLike() const {
+        return PopulationAggregator(database, pairScreen);
+    }
+
+    void record(uint64_t patientHash, const std::vector<int>& drugIds,
+        const std::vector<InteractionEffect>& effects, int combinedRisk) {
+        ++records;
+        distinctPatients.addHash(patientHash);
+        riskDistribution.add(combinedRisk);
+
+        for (const auto& effect : effects) {
+            ++effectSeverityCounts[static_cast<int>(effect.effect) * SEVERITY_TIERS + static_cast<int>(effect.severity)];
+        }
+
+        for (size_t i = 0; i < drugIds.size(); ++i) {
+            const Drug* first = database.getDrugById(drugIds[i]);
+            for (size_t j = i + 1; j < drugIds.size(); ++j) {
+                const Drug* second = database.getDrugById(drugIds[j]);
+                ++classPairCounts[classPairIndex(first->getDrugClass(), second->getDrugClass())];
+                if (pairScreen->pairAtLeast(drugIds[i], drugIds[j], InteractionSeverity::LETHAL)) {
+                    lethalPairs.add(pairKey(drugIds[i], drugIds[j]));
+                }
+            }
+        }
+    }
+
+    void merge(const PopulationAggregator& other) {
+        records += other.records;
+        for (size_t i = 0; i < effectSeverityCounts.size(); ++i) {
+            effectSeverityCounts[i] += other.effectSeverityCounts[i];
+        }
+        for (size_t i = 0; i < classPairCounts.size(); ++i) {
+            classPairCounts[i] += other.classPairCounts[i];
+        }
+        lethalPairs.merge(other.lethalPairs);
+        riskDistribution.merge(other.riskDistribution);
+        distinctPatients.merge(other.distinctPatients);
+    }
+
+    // Saves the statistics so that another process with the same catalog can
+    // read and merge them
+    void write(std::ostream& out) const {
+        out.write("PHPS", 4);
+        writeStatisticsValue(out, POPULATION_STATS_VERSION);
+        writeStatisticsValue(out, records);
+        writeStatisticsValue(out, effectSeverityCounts);
+        writeStatisticsValue(out, classPairCounts);
+        lethalPairs.write(out);
+        riskDistribution.write(out);
+        distinctPatients.write(out);
+    }
+
+    // Replaces the statistics with saved ones; false when the data is not a
+    // complete aggregator of this version over a catalog of this size
+    bool read(std::istream& in) {
+        char magic[4];
+        uint16_t version = 0;
+        if (!in.read(magic, 4) || std::memcmp(magic, "PHPS", 4) != 0 ||
+            !readStatisticsValue(in, version) || version != POPULATION_STATS_VERSION ||
+            !readStatisticsValue(in, records) || !readStatisticsValue(in, effectSeverityCounts) ||
+            !readStatisticsValue(in, classPairCounts) || !lethalPairs.read(in) ||
+            !riskDistribution.read(in) || !distinctPatients.read(in)) {
+            return false;
+        }
+        // Pair keys are drug ids, which the report looks up
+        for (const auto& entry : lethalPairs.top(SIZE_MAX)) {
+            if ((entry.key >> 32) >= database.getDrugCount() || (entry.key & 0xffffffffULL) >= database.getDrugCount()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint64_t getRecordCount() const { return records; }
+
+    uint64_t getEffectCount(SideEffect effect, InteractionSeverity severity) const {
+        return effectSeverityCounts[static_cast<int>(effect) * SEVERITY_TIERS + static_cast<int>(severity)];
+    }
+
+    uint64_t getClassPairCount(DrugClass a, DrugClass b) const {
+        return classPairCounts[classPairIndex(a, b)];
+    }
+
+    int riskQuantile(double q) const { return riskDistribution.quantile(q); }
+
+    double estimateDistinctPatients() const { return distinctPatients.estimate(); }
+
+    // Most frequent LETHAL pairs; each count overestimates by at most its error
+    std::vector<SpaceSaving::Entry> topLethalPairs(size_t count) const {
+        return lethalPairs.top(count);
+    }
+
+    // True when every statistic but the heavy-hitter list matches the other's
+    bool sameCounts(const PopulationAggregator& other) const {
+        return records == other.records && effectSeverityCounts == other.effectSeverityCounts &&
+            classPairCounts == other.classPairCounts && riskDistribution == other.riskDistribution &&
+            distinctPatients == other.distinctPatients;
+    }
+
+    void writeReport(std::ostream& out, size_t topPairs = 10) const {
+        out << "=== POPULATION STATISTICS ===\n";
+        out << "Regimens: " << records << "\n";
+        out << "Distinct patients (estimate): " << static_cast<uint64_t>(estimateDistinctPatients() + 0.5) << "\n";
+
+        out << "\nCombined risk distribution:\n";
+        for (double q : { 0.5, 0.9, 0.99 }) {
+            out << "  p" << static_cast<int>(q * 100) << ": " << riskQuantile(q) << "%\n";
+        }
+
+        out << "\nEffect occurrences (MINOR/MODERATE/MAJOR/LETHAL):\n";
+        for (int e = 0; e < SIDE_EFFECT_COUNT; ++e) {
+            out << "  " << effectToString(static_cast<SideEffect>(e)) << ":";
+            for (int s = 0; s < SEVERITY_TIERS; ++s) {
+                out << " " << effectSeverityCounts[e * SEVERITY_TIERS + s];
+            }
+            out << "\n";
+        }
+
+        out << "\nClass pair frequencies:\n";
+        for (int a = 0; a < DRUG_CLASS_COUNT; ++a) {
+            for (int b = a; b < DRUG_CLASS_COUNT; ++b) {
+                uint64_t count = getClassPairCount(static_cast<DrugClass>(a), static_cast<DrugClass>(b));
+                if (count > 0) {
+                    out << "  " << drugClassToString(static_cast<DrugClass>(a)) << " + "
+                        << drugClassToString(static_cast<DrugClass>(b)) << ": " << count << "\n";
+                }
+            }
+        }
+
+        // A count with an error is an upper bound, and depends on how the records were split
+        out << "\nMost frequent LETHAL pairs:\n";
+        for (const auto& entry : lethalPairs.top(topPairs)) {
+            out << "  " << database.getDrugById(static_cast<int>(entry.key >> 32))->getName() << " + "
+                << database.getDrugById(static_cast<int>(entry.key & 0xffffffffULL))->getName()
+                << ": " << entry.count;
+            if (entry.error > 0) out << " (overcount at most " << entry.error << ")";
+            out << "\n";
+        }
+    }
+};
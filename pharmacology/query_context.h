@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+// Set from any thread, or from a signal handler, to stop the queries watching it
+class CancellationToken {
+private:
+    std::atomic<bool> cancelled{ false };
+
+public:
+    void cancel() { cancelled.store(true, std::memory_order_relaxed); }
+    bool isCancelled() const { return cancelled.load(std::memory_order_relaxed); }
+};
+
+// Deadline and cancellation for one query (or one batch job). Long loops call
+// shouldStop() cooperatively and return what they have so far; the context
+// remembers that it fired, so every later check is one load. The clock is only
+// read every CLOCK_INTERVAL checks, which keeps the checks cheap enough for the
+// pair loop. A default-constructed context never fires.
+class QueryContext {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr unsigned CLOCK_INTERVAL = 16;
+
+private:
+    Clock::time_point deadline = Clock::time_point::max();
+    const CancellationToken* token = nullptr;
+    mutable unsigned checks = 0;
+    mutable bool fired = false;
+
+public:
+    QueryContext() = default;
+
+    explicit QueryContext(Clock::time_point queryDeadline, const CancellationToken* cancellation = nullptr)
+        : deadline(queryDeadline), token(cancellation) {
+    }
+
+    explicit QueryContext(const CancellationToken* cancellation) : token(cancellation) {
+    }
+
+    // Deadline measured from now; zero or negative means no deadline
+    static QueryContext withTimeout(std::chrono::milliseconds timeout, const CancellationToken* cancellation = nullptr) {
+        return QueryContext(timeout.count() > 0 ? Clock::now() + timeout : Clock::time_point::max(), cancellation);
+    }
+
+    bool shouldStop() const {
+        if (fired) return true;
+        if (token && token->isCancelled()) return fired = true;
+        if (deadline != Clock::time_point::max() && ++checks % CLOCK_INTERVAL == 0) {
+            fired = Clock::now() >= deadline;
+        }
+        return fired;
+    }
+
+    bool hasFired() const { return fired; }
+
+    // False for a context without deadline or token, which can never fire
+    bool canFire() const { return token || deadline != Clock::time_point::max(); }
+};
+
+// Result of an analysis that may have been cut short. An incomplete result
+// consolidates only the drug pairs analysed before the context fired; pairs are
+// taken in order of the worst severity they can reach, so the most severe effects
+// are the ones found first.
+struct InteractionOutcome {
+    std::vector<InteractionEffect> effects;
+    bool complete = true;
+    size_t pairsAnalyzed = 0;
+    size_t pairCount = 0;
+};
@@ -0,0 +1,278 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs interactive checks and bulk screening jobs on one worker pool.
+//
+// Interactive tasks always go first. Batch jobs are split into chunks that are
+// scheduled one at a time, so a long job yields between chunks; in addition some
+// workers never take batch chunks, so an interactive check never waits behind a
+// running chunk. Batch work is deferred while the interactive queue is backed up
+// and new batch jobs are shed once the batch queue is full.
+class QueryScheduler {
+public:
+    struct Options {
+        size_t workers = std::max(2u, std::thread::hardware_concurrency());
+        size_t reservedInteractiveWorkers = 1;  // Never run batch chunks
+        size_t interactiveBacklog = 4;          // Defer batch chunks at this interactive queue depth
+        size_t maxQueuedBatchJobs = 64;         // Shed new batch jobs beyond this
+    };
+
+    struct ClassMetrics {
+        size_t queueDepth = 0;       // Tasks, or batch jobs, not started yet
+        uint64_t submitted = 0;
+        uint64_t completed = 0;
+        uint64_t shed = 0;           // Batch jobs rejected by admission control
+        uint64_t deferred = 0;       // Times batch work was held back for an interactive backlog
+        double p50WaitMs = 0.0;      // Queue wait over the recent samples
+        double p99WaitMs = 0.0;
+        double maxWaitMs = 0.0;
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+private:
+    static constexpr size_t WAIT_SAMPLES = 8192;
+
+    struct InteractiveTask {
+        std::function<void()> run;
+        Clock::time_point enqueued;
+    };
+
+    struct BatchJob {
+        size_t itemCount;
+        size_t chunkSize;
+        std::function<void(size_t, size_t)> chunk;
+        std::function<void()> onComplete;
+        Clock::time_point enqueued;
+        size_t nextItem = 0;
+        size_t runningChunks = 0;
+        bool started = false;
+    };
+
+    // Recent queue waits, for percentiles
+    struct WaitSamples {
+        std::vector<double> samples;
+        size_t next = 0;
+        double maxMs = 0.0;
+
+        void add(double ms) {
+            if (samples.size() < WAIT_SAMPLES) {
+                samples.push_back(ms);
+            }
+            else {
+                samples[next] = ms;
+                next = (next + 1) % WAIT_SAMPLES;
+            }
+            maxMs = std::max(maxMs, ms);
+        }
+
+        void fill(ClassMetrics& metrics) const {
+            if (samples.empty()) return;
+            std::vector<double> sorted = samples;
+            std::sort(sorted.begin(), sorted.end());
+            metrics.p50WaitMs = sorted[sorted.size() / 2];
+            metrics.p99WaitMs = sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)];
+            metrics.maxWaitMs = maxMs;
+        }
+    };
+
+    Options options;
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable idle;
+    std::deque<InteractiveTask> interactiveQueue;
+    std::deque<std::shared_ptr<BatchJob>> batchQueue;  // Front job is the one being chunked
+    size_t activeJobs = 0;                            // Queued or still running chunks
+    size_t runningInteractive = 0;
+    bool stopping = false;
+
+    ClassMetrics interactiveMetrics;
+    ClassMetrics batchMetrics;
+    WaitSamples interactiveWaits;
+    WaitSamples batchWaits;
+    std::vector<std::thread> workers;
+
+    static double millisecondsSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    bool mayRunBatch(size_t worker) const {
+        return !batchQueue.empty() && worker >= options.reservedInteractiveWorkers &&
+            interactiveQueue.size() < options.interactiveBacklog;
+    }
+
+    void workerLoop(size_t worker) {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            workAvailable.wait(lock, [&] {
+                return stopping || !interactiveQueue.empty() || mayRunBatch(worker);
+            });
+
+            if (!interactiveQueue.empty()) {
+                InteractiveTask task = std::move(interactiveQueue.front());
+                interactiveQueue.pop_front();
+                interactiveWaits.add(millisecondsSince(task.enqueued));
+                if (interactiveQueue.size() + 1 == options.interactiveBacklog && !batchQueue.empty()) {
+                    workAvailable.notify_all();  // Backlog cleared, deferred batch work may resume
+                }
+                ++runningInteractive;
+
+                lock.unlock();
+                task.run();
+                lock.lock();
+
+                --runningInteractive;
+                ++interactiveMetrics.completed;
+                idle.notify_all();
+                continue;
+            }
+
+            if (!mayRunBatch(worker)) {
+                if (stopping) return;
+                continue;
+            }
+
+            // Take the next chunk of the front job
+            std::shared_ptr<BatchJob> job = batchQueue.front();
+            if (!job->started) {
+                job->started = true;
+                batchWaits.add(millisecondsSince(job->enqueued));
+            }
+            size_t first = job->nextItem;
+            size_t last = std::min(job->itemCount, first + job->chunkSize);
+            job->nextItem = last;
+            if (last == job->itemCount) {
+                batchQueue.pop_front();
+            }
+            ++job->runningChunks;
+
+            lock.unlock();
+            job->chunk(first, last);
+            lock.lock();
+
+            if (--job->runningChunks == 0 && job->nextItem == job->itemCount) {
+                --activeJobs;
+                ++batchMetrics.completed;
+                if (job->onComplete) {
+                    lock.unlock();
+                    job->onComplete();
+                    lock.lock();
+                }
+            }
+            idle.notify_all();
+        }
+    }
+
+public:
+    QueryScheduler() : QueryScheduler(Options()) {
+    }
+
+    explicit QueryScheduler(const Options& schedulerOptions) : options(schedulerOptions) {
+        options.workers = std::max<size_t>(options.workers, options.reservedInteractiveWorkers + 1);
+        for (size_t worker = 0; worker < options.workers; ++worker) {
+            workers.emplace_back([this, worker] { workerLoop(worker); });
+        }
+    }
+
+    QueryScheduler(const QueryScheduler&) = delete;
+    QueryScheduler& operator=(const QueryScheduler&) = delete;
+
+    // Lets queued work finish, then stops the workers
+    ~QueryScheduler() {
+        waitIdle();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        workAvailable.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    // Latency-critical work; always admitted and run ahead of any batch chunk
+    template <typename Fn>
+    auto submitInteractive(Fn&& fn) -> std::future<decltype(fn())> {
+        auto task = std::make_shared<std::packaged_task<decltype(fn())()>>(std::forward<Fn>(fn));
+        auto result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            interactiveQueue.push_back({ [task] { (*task)(); }, Clock::now() });
+            ++interactiveMetrics.submitted;
+            if (interactiveQueue.size() == options.interactiveBacklog && !batchQueue.empty()) {
+                ++batchMetrics.deferred;
+            }
+        }
+        workAvailable.notify_one();
+        return result;
+    }
+
+    // Bulk work over itemCount items, run as chunk(first, last) calls of at most
+    // chunkSize items; onComplete runs after the last chunk. Returns false when the
+    // job is shed because the batch queue is full.
+    bool submitBatch(size_t itemCount, size_t chunkSize, std::function<void(size_t, size_t)> chunk,
+        std::function<void()> onComplete = {}) {
+        auto job = std::make_shared<BatchJob>();
+        job->itemCount = itemCount;
+        job->chunkSize = std::max<size_t>(chunkSize, 1);
+        job->chunk = std::move(chunk);
+        job->onComplete = std::move(onComplete);
+        job->enqueued = Clock::now();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (batchQueue.size() >= options.maxQueuedBatchJobs) {
+                ++batchMetrics.shed;
+                return false;
+            }
+            ++batchMetrics.submitted;
+            if (itemCount == 0) {
+                ++batchMetrics.completed;
+            }
+            else {
+                batchQueue.push_back(std::move(job));
+                ++activeJobs;
+            }
+        }
+        if (itemCount == 0) {
+            if (job->onComplete) job->onComplete();
+            return true;
+        }
+        workAvailable.notify_all();
+        return true;
+    }
+
+    // Blocks until every submitted task and job has finished
+    void waitIdle() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] {
+            return interactiveQueue.empty() && runningInteractive == 0 && activeJobs == 0;
+        });
+    }
+
+    ClassMetrics getInteractiveMetrics() {
+        std::lock_guard<std::mutex> lock(mutex);
+        ClassMetrics metrics = interactiveMetrics;
+        metrics.queueDepth = interactiveQueue.size();
+        interactiveWaits.fill(metrics);
+        return metrics;
+    }
+
+    ClassMetrics getBatchMetrics() {
+        std::lock_guard<std::mutex> lock(mutex);
+        ClassMetrics metrics = batchMetrics;
+        metrics.queueDepth = batchQueue.size();
+        batchWaits.fill(metrics);
+        return metrics;
+    }
+};
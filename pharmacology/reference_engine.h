@@ -0,0 +1,249 @@
+#pragma once
+#include <cmath>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "od_db.h"
+
+// Frozen copies of the original InteractionAnalyzer and calculateCombinationRisk
+// algorithms, written for clarity rather than speed. The differential harness uses
+// them as the oracle every optimized path must agree with, so they should only
+// change when the clinical rules themselves change.
+
+struct ReferenceEffect {
+    SideEffect effect;
+    InteractionSeverity severity;
+    double probability;
+    std::string description;
+};
+
+class ReferenceInteractionAnalyzer {
+private:
+    std::map<std::pair<DrugClass, DrugClass>, std::vector<ReferenceEffect>> interactionMatrix;
+    std::map<std::pair<int, int>, std::vector<ReferenceEffect>> pairOverrides;  // Both orders
+
+public:
+    // Copies the class matrix and pair override data out of the live analyzer; only
+    // the rules below are frozen
+    explicit ReferenceInteractionAnalyzer(const InteractionAnalyzer& analyzer) {
+        for (int a = 0; a < DRUG_CLASS_COUNT; ++a) {
+            for (int b = 0; b < DRUG_CLASS_COUNT; ++b) {
+                DrugClass class1 = static_cast<DrugClass>(a);
+                DrugClass class2 = static_cast<DrugClass>(b);
+                for (const auto& effect : analyzer.getClassEffects(class1, class2)) {
+                    interactionMatrix[std::make_pair(class1, class2)].push_back({ effect.effect,
+                        effect.severity, effect.probability, std::string(analyzer.getDescription(effect)) });
+                }
+            }
+        }
+        analyzer.getPairOverrides().forEachPair([&](int drug1, int drug2, const InteractionEffect* effects, size_t count) {
+            for (size_t k = 0; k < count; ++k) {
+                ReferenceEffect effect{ effects[k].effect, effects[k].severity, effects[k].probability,
+                    std::string(analyzer.getDescription(effects[k])) };
+                pairOverrides[std::make_pair(drug1, drug2)].push_back(effect);
+                if (drug1 != drug2) pairOverrides[std::make_pair(drug2, drug1)].push_back(effect);
+            }
+        });
+    }
+
+    std::vector<ReferenceEffect> analyzeInteraction(const Drug& drug1, const Drug& drug2) const {
+        std::vector<ReferenceEffect> effects;
+        auto overridden = pairOverrides.find(std::make_pair(drug1.getId(), drug2.getId()));
+        auto it = interactionMatrix.find(std::make_pair(drug1.getDrugClass(), drug2.getDrugClass()));
+        if (overridden != pairOverrides.end()) {
+            effects = overridden->second;
+        }
+        else if (it != interactionMatrix.end()) {
+            effects = it->second;
+        }
+        modifyEffectsForSpecificDrugs(effects, drug1, drug2);
+        return effects;
+    }
+
+    std::vector<ReferenceEffect> analyzeMultipleInteractions(const std::vector<Drug>& drugs) const {
+        std::vector<ReferenceEffect> allEffects;
+        for (size_t i = 0; i < drugs.size(); ++i) {
+            for (size_t j = i + 1; j < drugs.size(); ++j) {
+                auto effects = analyzeInteraction(drugs[i], drugs[j]);
+                allEffects.insert(allEffects.end(), effects.begin(), effects.end());
+            }
+        }
+
+        std::map<SideEffect, ReferenceEffect> consolidated;
+        for (const auto& effect : allEffects) {
+            auto found = consolidated.find(effect.effect);
+            if (found == consolidated.end()) {
+                consolidated[effect.effect] = effect;
+            }
+            else {
+                found->second.probability = std::min(1.0,
+                    found->second.probability + effect.probability * 0.5);
+                if (effect.severity > found->second.severity) {
+                    found->second.severity = effect.severity;
+                    found->second.description = effect.description;
+                }
+            }
+        }
+
+        std::vector<ReferenceEffect> result;
+        for (const auto& pair : consolidated) {
+            result.push_back(pair.second);
+        }
+        return result;
+    }
+
+private:
+    static bool isDepressant(const Drug& drug) {
+        return drug.getDrugClass() == DrugClass::DEPRESSANT ||
+            drug.getDrugClass() == DrugClass::OPIOID ||
+            drug.getDrugClass() == DrugClass::BENZODIAZEPINE ||
+            drug.getDrugClass() == DrugClass::ALCOHOL;
+    }
+
+    static bool isCYPInhibitor(std::string_view drugName) {
+        static const std::set<std::string, std::less<>> cypInhibitors = {
+            "fluoxetine", "paroxetine", "sertraline", "clarithromycin",
+            "erythromycin", "ketoconazole", "itraconazole", "ritonavir"
+        };
+        return cypInhibitors.count(drugName) > 0;
+    }
+
+    static void modifyEffectsForSpecificDrugs(std::vector<ReferenceEffect>& effects,
+        const Drug& drug1, const Drug& drug2) {
+        const std::pmr::string& name1 = drug1.getName();
+        const std::pmr::string& name2 = drug2.getName();
+
+        if ((name1 == "pcp" && name2 == "oxycodone") || (name2 == "pcp" && name1 == "oxycodone")) {
+            bool foundRespDep = false, foundDeathRisk = false;
+            for (auto& effect : effects) {
+                if (effect.effect == SideEffect::RESPIRATORY_DEPRESSION) {
+                    effect.probability = std::min(1.0, effect.probability * 1.8);
+                    effect.severity = InteractionSeverity::LETHAL;
+                    effect.description = "PCP's NMDA antagonism potentiates oxycodone respiratory depression";
+                    foundRespDep = true;
+                }
+                if (effect.effect == SideEffect::DEATH_RISK) {
+                    effect.probability = std::min(1.0, effect.probability * 2.0);
+                    effect.severity = InteractionSeverity::LETHAL;
+                    foundDeathRisk = true;
+                }
+            }
+            if (!foundRespDep) {
+                effects.push_back({ SideEffect::RESPIRATORY_DEPRESSION, InteractionSeverity::LETHAL, 0.75,
+                    "PCP's NMDA antagonism dangerously potentiates oxycodone respiratory depression" });
+            }
+            effects.push_back({ SideEffect::MANIA, InteractionSeverity::MAJOR, 0.65,
+                "PCP can trigger manic episodes, especially dangerous with opioid euphoria" });
+            if (!foundDeathRisk) {
+                effects.push_back({ SideEffect::DEATH_RISK, InteractionSeverity::LETHAL, 0.55,
+                    "Extremely high risk due to respiratory depression and unpredictable PCP effects" });
+            }
+            effects.push_back({ SideEffect::HALLUCINATIONS, InteractionSeverity::MAJOR, 0.85,
+                "Intense dissociative effects combined with opioid sedation" });
+        }
+
+        if ((name1 == "pcp" && isDepressant(drug2)) || (name2 == "pcp" && isDepressant(drug1))) {
+            bool foundMania = false;
+            for (auto& effect : effects) {
+                if (effect.effect == SideEffect::RESPIRATORY_DEPRESSION) {
+                    effect.probability = std::min(1.0, effect.probability * 1.4);
+                    effect.severity = InteractionSeverity::MAJOR;
+                    effect.description = "PCP's complex CNS effects dangerously interact with depressants";
+                }
+                if (effect.effect == SideEffect::MANIA) {
+                    foundMania = true;
+                }
+            }
+            if (!foundMania) {
+                effects.push_back({ SideEffect::MANIA, InteractionSeverity::MAJOR, 0.45,
+                    "PCP can trigger manic/psychotic episodes when combined with depressants" });
+            }
+        }
+
+        if (name1 == "fentanyl" || name2 == "fentanyl") {
+            for (auto& effect : effects) {
+                if (effect.effect == SideEffect::RESPIRATORY_DEPRESSION ||
+                    effect.effect == SideEffect::DEATH_RISK) {
+                    effect.probability = std::min(1.0, effect.probability * 1.5);
+                    if (effect.severity < InteractionSeverity::LETHAL) {
+                        effect.severity = static_cast<InteractionSeverity>(
+                            static_cast<int>(effect.severity) + 1);
+                    }
+                }
+            }
+        }
+
+        if ((name1 == "oxycodone" && isCYPInhibitor(name2)) ||
+            (name2 == "oxycodone" && isCYPInhibitor(name1))) {
+            for (auto& effect : effects) {
+                if (effect.effect == SideEffect::RESPIRATORY_DEPRESSION ||
+                    effect.effect == SideEffect::DEATH_RISK) {
+                    effect.probability = std::min(1.0, effect.probability * 1.3);
+                    effect.description += " - Enhanced by CYP enzyme inhibition";
+                }
+            }
+        }
+
+        if ((name1 == "oxycodone" && (name2 == "alcohol" || drug2.getDrugClass() == DrugClass::BENZODIAZEPINE)) ||
+            (name2 == "oxycodone" && (name1 == "alcohol" || drug1.getDrugClass() == DrugClass::BENZODIAZEPINE))) {
+            for (auto& effect : effects) {
+                if (effect.effect == SideEffect::DEATH_RISK) {
+                    effect.probability = std::min(1.0, effect.probability * 1.2);
+                }
+            }
+        }
+    }
+};
+
+// Frozen calculateCombinationRisk; the per-drug percentages and classes come from
+// the live databases. A regimen is a speedball when it has a potent stimulant
+// (not caffeine or nicotine) together with an opioid, benzodiazepine, alcohol or
+// other depressant.
+class ReferenceOverdoseModel {
+private:
+    const DrugDatabase& database;
+    const OverdosePotentialDatabase& overdoseDB;
+
+public:
+    ReferenceOverdoseModel(const DrugDatabase& drugDatabase, const OverdosePotentialDatabase& overdoseDatabase)
+        : database(drugDatabase), overdoseDB(overdoseDatabase) {
+    }
+
+    int calculateCombinationRisk(const std::vector<std::string>& drugs) const {
+        if (drugs.empty()) return 0;
+
+        double combinedRisk = 0.0;
+        bool hasRespiratoryDepressant = false;
+        bool hasStimulant = false;
+
+        for (const std::string& drug : drugs) {
+            combinedRisk += overdoseDB.getOverdosePercentage(drug) * 0.01;
+            const Drug* drugPtr = database.getDrugById(database.getDrugId(drug));
+            if (!drugPtr) continue;
+
+            DrugClass drugClass = drugPtr->getDrugClass();
+            if (drugClass == DrugClass::OPIOID || drugClass == DrugClass::BENZODIAZEPINE ||
+                drugClass == DrugClass::ALCOHOL || drugClass == DrugClass::DEPRESSANT) {
+                hasRespiratoryDepressant = true;
+            }
+            if (drug == "cocaine" || drug == "methamphetamine" || drug == "amphetamine" ||
+                drug == "dextroamphetamine" || drug == "adderall" || drug == "ritalin" ||
+                drug == "methylphenidate" || drug == "mdma") {
+                hasStimulant = true;
+            }
+        }
+
+        // The original code took pow() of a negative base here; the resulting NaN
+        // fell through to its "finalRisk < 0" branch, which reports 100
+        if (combinedRisk > 1.0) return 100;
+
+        combinedRisk = 1.0 - std::pow(1.0 - combinedRisk, 1.3);
+        if (hasRespiratoryDepressant && hasStimulant) {
+            combinedRisk *= 1.4;
+        }
+
+        return std::min(static_cast<int>(combinedRisk * 100), 99);
+    }
+};
@@ -0,0 +1,637 @@
+#pragma once
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "db.h"
+
+enum class ReportFormat {
+    TEXT,
+    HTML,
+    JSON
+};
+
+inline bool parseReportFormat(const std::string& text, ReportFormat& format) {
+    if (text == "text") format = ReportFormat::TEXT;
+    else if (text == "html") format = ReportFormat::HTML;
+    else if (text == "json") format = ReportFormat::JSON;
+    else return false;
+    return true;
+}
+
+// Appends to an output buffer, escaping values for the target format. Numbers are
+// formatted with to_chars, so there is no locale or stream state involved; a double
+// comes out as an ostream with default flags prints it (%g, 6 significant digits).
+class ReportWriter {
+private:
+    std::string& out;
+    ReportFormat format;
+
+public:
+    ReportWriter(std::string& buffer, ReportFormat outputFormat) : out(buffer), format(outputFormat) {
+    }
+
+    // Template text, copied as is
+    void literal(std::string_view text) {
+        out.append(text);
+    }
+
+    void text(std::string_view value) {
+        if (format == ReportFormat::TEXT) {
+            out.append(value);
+            return;
+        }
+        for (char c : value) {
+            if (format == ReportFormat::HTML) {
+                switch (c) {
+                case '&': out.append("&amp;"); break;
+                case '<': out.append("&lt;"); break;
+                case '>': out.append("&gt;"); break;
+                case '"': out.append("&quot;"); break;
+                case '\'': out.append("&#39;"); break;
+                default: out.push_back(c);
+                }
+            }
+            else if (c == '"' || c == '\\') {
+                out.push_back('\\');
+                out.push_back(c);
+            }
+            else if (static_cast<unsigned char>(c) < 0x20) {
+                static const char hex[] = "0123456789abcdef";
+                out.append("\\u00");
+                out.push_back(hex[(c >> 4) & 0xF]);
+                out.push_back(hex[c & 0xF]);
+            }
+            else {
+                out.push_back(c);
+            }
+        }
+    }
+
+    void integer(long long value) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        out.append(digits, result.ptr);
+    }
+
+    void number(double value) {
+        char digits[32];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::general, 6);
+        out.append(digits, result.ptr);
+    }
+};
+
+// A name a template can use for one report type. A field is a list (count), a
+// flag (test) or a value (write); fields naming a list are read per item of that
+// list and may only appear inside its section.
+template <typename Report>
+struct ReportField {
+    const char* name;
+    const char* list;  // Enclosing list field, nullptr for report-level fields
+    size_t (*count)(const Report& report);
+    bool (*test)(const Report& report, size_t item);
+    void (*write)(const Report& report, size_t item, ReportWriter& out);
+};
+
+// A template parsed once into a flat list of operations. The syntax is a small
+// subset of Mustache:
+//
+//   {{name}}               value of a field
+//   {{#name}}...{{/name}}  repeated per item of a list, or shown if a flag is set
+//   {{^name}}...{{/name}}  shown if a list is empty or a flag is clear
+//
+// and, inside a list, the flags "first" and "last" of the current item.
+template <typename Report>
+class ReportTemplate {
+private:
+    enum class OpKind : uint8_t {
+        LITERAL,
+        VALUE,
+        LIST,
+        FLAG,
+        FIRST,
+        LAST
+    };
+
+    struct Op {
+        OpKind kind;
+        bool negate;      // {{^...}}
+        uint32_t field;
+        uint32_t offset;  // LITERAL: range in source
+        uint32_t length;
+        uint32_t end;     // Sections: index of the first op after the body
+    };
+
+    std::string source;
+    std::vector<Op> ops;
+
+    static int findField(std::string_view name) {
+        const auto& fields = Report::fields();
+        for (size_t f = 0; f < fields.size(); ++f) {
+            if (name == fields[f].name) return static_cast<int>(f);
+        }
+        return -1;
+    }
+
+    void renderRange(const Report& report, size_t begin, size_t end, size_t item, size_t itemCount,
+        ReportWriter& out) const {
+        const auto& fields = Report::fields();
+        size_t i = begin;
+        while (i < end) {
+            const Op& op = ops[i];
+            if (op.kind == OpKind::LITERAL) {
+                out.literal(std::string_view(source).substr(op.offset, op.length));
+                ++i;
+                continue;
+            }
+            if (op.kind == OpKind::VALUE) {
+                fields[op.field].write(report, item, out);
+                ++i;
+                continue;
+            }
+            if (op.kind == OpKind::LIST) {
+                size_t count = fields[op.field].count(report);
+                for (size_t k = 0; k < count; ++k) {
+                    renderRange(report, i + 1, op.end, k, count, out);
+                }
+                i = op.end;
+                continue;
+            }
+
+            bool set;
+            if (op.kind == OpKind::FIRST) set = item == 0;
+            else if (op.kind == OpKind::LAST) set = item + 1 == itemCount;
+            else if (fields[op.field].count) set = fields[op.field].count(report) != 0;
+            else set = fields[op.field].test(report, item);
+            if (set != op.negate) {
+                renderRange(report, i + 1, op.end, item, itemCount, out);
+            }
+            i = op.end;
+        }
+    }
+
+public:
+    // Returns false with a message for the first tag it cannot use
+    bool compile(const std::string& text, std::string& error) {
+        source = text;
+        ops.clear();
+
+        struct OpenSection {
+            size_t op;
+            std::string name;
+            bool list;
+        };
+        std::vector<OpenSection> open;
+        const auto& fields = Report::fields();
+
+        size_t position = 0;
+        while (position < source.size()) {
+            size_t tag = source.find("{{", position);
+            if (tag == std::string::npos) tag = source.size();
+            if (tag > position) {
+                ops.push_back({ OpKind::LITERAL, false, 0, static_cast<uint32_t>(position),
+                    static_cast<uint32_t>(tag - position), 0 });
+            }
+            if (tag == source.size()) break;
+
+            size_t close = source.find("}}", tag + 2);
+            if (close == std::string::npos) {
+                error = "unterminated tag at offset " + std::to_string(tag);
+                return false;
+            }
+            position = close + 2;
+
+            std::string_view body(source.data() + tag + 2, close - tag - 2);
+            char sigil = body.empty() ? '\0' : body[0];
+            if (sigil == '#' || sigil == '^' || sigil == '/') body.remove_prefix(1);
+            else sigil = '\0';
+            while (!body.empty() && body.front() == ' ') body.remove_prefix(1);
+            while (!body.empty() && body.back() == ' ') body.remove_suffix(1);
+            std::string name(body);
+
+            if (sigil == '/') {
+                if (open.empty() || open.back().name != name) {
+                    error = "unexpected {{/" + name + "}} at offset " + std::to_string(tag);
+                    return false;
+                }
+                ops[open.back().op].end = static_cast<uint32_t>(ops.size());
+                open.pop_back();
+                continue;
+            }
+
+            // Innermost list section, which item fields must belong to
+            std::string currentList;
+            for (auto it = open.rbegin(); it != open.rend(); ++it) {
+                if (it->list) {
+                    currentList = it->name;
+                    break;
+                }
+            }
+
+            Op op = { OpKind::FLAG, sigil == '^', 0, 0, 0, 0 };
+            if (name == "first" || name == "last") {
+                if (sigil == '\0' || currentList.empty()) {
+                    error = "'" + name + "' used outside a list section at offset " + std::to_string(tag);
+                    return false;
+                }
+                op.kind = (name == "first") ? OpKind::FIRST : OpKind::LAST;
+            }
+            else {
+                int field = findField(name);
+                if (field < 0) {
+                    error = "unknown field '" + name + "' at offset " + std::to_string(tag);
+                    return false;
+                }
+                const ReportField<Report>& definition = fields[field];
+                if (definition.list && currentList != definition.list) {
+                    error = "'" + name + "' used outside the '" + definition.list + "' section at offset " +
+                        std::to_string(tag);
+                    return false;
+                }
+                bool usable = (sigil == '\0') ? definition.write != nullptr
+                    : (definition.count != nullptr || definition.test != nullptr);
+                if (!usable) {
+                    error = "'" + name + "' cannot be used as " + (sigil == '\0' ? "a value" : "a section") +
+                        " at offset " + std::to_string(tag);
+                    return false;
+                }
+                op.field = static_cast<uint32_t>(field);
+                if (sigil == '\0') op.kind = OpKind::VALUE;
+                else if (sigil == '#' && definition.count) op.kind = OpKind::LIST;
+            }
+
+            if (sigil == '\0') {
+                ops.push_back(op);
+            }
+            else {
+                open.push_back({ ops.size(), name, op.kind == OpKind::LIST });
+                ops.push_back(op);
+            }
+        }
+
+        if (!open.empty()) {
+            error = "unclosed section '" + open.back().name + "'";
+            return false;
+        }
+        return true;
+    }
+
+    void render(const Report& report, ReportWriter& out) const {
+        renderRange(report, 0, ops.size(), 0, 0, out);
+    }
+};
+
+struct ReportEffect {
+    SideEffect effect;
+    InteractionSeverity severity;
+    double probability;
+    const std::pmr::string* description;  // Owned by the analyzer's description pool
+};
+
+// Result of an interaction check, effects in display order (most severe first).
+// An incomplete check stopped at its deadline after pairsAnalyzed of pairCount pairs.
+struct InteractionReport {
+    std::vector<std::string> drugNames;
+    std::vector<ReportEffect> effects;
+    bool complete = true;
+    size_t pairsAnalyzed = 0;
+    size_t pairCount = 0;
+
+    bool hasSeverity(InteractionSeverity severity) const {
+        for (const auto& effect : effects) {
+            if (effect.severity == severity) return true;
+        }
+        return false;
+    }
+
+    static const std::vector<ReportField<InteractionReport>>& fields() {
+        using R = InteractionReport;
+        static const std::vector<ReportField<R>> table = {
+            { "drugs", nullptr, [](const R& r) { return r.drugNames.size(); }, nullptr, nullptr },
+            { "name", "drugs", nullptr, nullptr,
+                [](const R& r, size_t i, ReportWriter& out) { out.text(r.drugNames[i]); } },
+            { "effects", nullptr, [](const R& r) { return r.effects.size(); }, nullptr, nullptr },
+            { "effect", "effects", nullptr, nullptr,
+                [](const R& r, size_t i, ReportWriter& out) { out.text(effectToString(r.effects[i].effect)); } },
+            { "severity", "effects", nullptr, nullptr,
+                [](const R& r, size_t i, ReportWriter& out) { out.text(severityToString(r.effects[i].severity)); } },
+            { "probability", "effects", nullptr, nullptr,
+                [](const R& r, size_t i, ReportWriter& out) { out.number(r.effects[i].probability * 100); } },
+            { "description", "effects", nullptr, nullptr,
+                [](const R& r, size_t i, ReportWriter& out) { out.text(*r.effects[i].description); } },
+            { "incomplete", nullptr, nullptr, [](const R& r, size_t) { return !r.complete; }, nullptr },
+            { "pairsAnalyzed", nullptr, nullptr, nullptr,
+                [](const R& r, size_t, ReportWriter& out) { out.integer(static_cast<long long>(r.pairsAnalyzed)); } },
+            { "pairCount", nullptr, nullptr, nullptr,
+                [](const R& r, size_t, ReportWriter& out) { out.integer(static_cast<long long>(r.pairCount)); } },
+            { "extremeDanger", nullptr, nullptr,
+                [](const R& r, size_t) { return r.hasSeverity(InteractionSeverity::LETHAL); }, nullptr },
+            { "highRisk", nullptr, nullptr,
+                [](const R& r, size_t) {
+                    return !r.hasSeverity(InteractionSeverity::LETHAL) && r.hasSeverity(InteractionSeverity::MAJOR);
+                }, nullptr },
+            { "moderateRisk", nullptr, nullptr,
+                [](const R& r, size_t) {
+                    return !r.effects.empty() && !r.hasSeverity(InteractionSeverity::LETHAL) &&
+                        !r.hasSeverity(InteractionSeverity::MAJOR);
+                }, nullptr },
+        };
+        return table;
+    }
+};
+
+// Result of an overdose assessment. For a single drug combinedRisk is that drug's
+// own percentage and the recommendation flags apply; for a combination the
+// warning flags apply.
+struct OverdoseReport {
+    std::vector<std::string> drugNames;
+    std::vector<int> percentages;   // Per drug
+    int combinedRisk = 0;
+    std::string riskLevel;
+    bool lethalCombination = false;
+    bool speedball = false;
+
+    bool isSingle() const { return drugNames.size() == 1; }
+
+    static const std::vector<ReportField<OverdoseReport>>& fields() {
+        using R = OverdoseReport;
+        static const std::vector<ReportField<R>> table = {
+            { "drugs", nullptr, [](const R& r) { return r.drugNames.size(); }, nullptr, nullptr },
+            { "name", "drugs", nullptr, nullptr,
+                [](const R& r, size_t i, ReportWriter& out) { out.text(r.drugNames[i]); } },
+            { "risk", "drugs", nullptr, nullptr,
+                [](const R& r, size_t i, ReportWriter& out) { out.integer(r.percentages[i]); } },
+            { "single", nullptr, nullptr, [](const R& r, size_t) { return r.isSingle(); }, nullptr },
+            { "combination", nullptr, nullptr, [](const R& r, size_t) { return !r.isSingle(); }, nullptr },
+            { "combinedRisk", nullptr, nullptr, nullptr,
+                [](const R& r, size_t, ReportWriter& out) { out.integer(r.combinedRisk); } },
+            { "riskLevel", nullptr, nullptr, nullptr,
+                [](const R& r, size_t, ReportWriter& out) { out.text(r.riskLevel); } },
+            { "criticalRisk", nullptr, nullptr,
+                [](const R& r, size_t) { return r.isSingle() && r.combinedRisk >= 90; }, nullptr },
+            { "highRisk", nullptr, nullptr,
+                [](const R& r, size_t) { return r.isSingle() && r.combinedRisk >= 75 && r.combinedRisk < 90; }, nullptr },
+            { "moderateHighRisk", nullptr, nullptr,
+                [](const R& r, size_t) { return r.isSingle() && r.combinedRisk >= 60 && r.combinedRisk < 75; }, nullptr },
+            { "moderateRisk", nullptr, nullptr,
+                [](const R& r, size_t) { return r.isSingle() && r.combinedRisk >= 40 && r.combinedRisk < 60; }, nullptr },
+            { "lowerRisk", nullptr, nullptr,
+                [](const R& r, size_t) { return r.isSingle() && r.combinedRisk < 40; }, nullptr },
+            { "lethalCombination", nullptr, nullptr,
+                [](const R& r, size_t) { return !r.isSingle() && r.lethalCombination; }, nullptr },
+            { "speedball", nullptr, nullptr,
+                [](const R& r, size_t) { return !r.isSingle() && r.speedball; }, nullptr },
+            { "emergency", nullptr, nullptr,
+                [](const R& r, size_t) { return !r.isSingle() && r.combinedRisk >= 80; }, nullptr },
+        };
+        return table;
+    }
+};
+
+// Renders reports in every format from the built-in templates, compiled once.
+// Output goes to a buffer owned by the calling thread and reused across calls, so
+// steady-state rendering does not allocate; the returned reference is valid until
+// the thread's next render.
+class ReportRenderer {
+private:
+    static constexpr int FORMAT_COUNT = 3;
+
+    ReportTemplate<InteractionReport> interactionTemplates[FORMAT_COUNT];
+    ReportTemplate<OverdoseReport> overdoseTemplates[FORMAT_COUNT];
+
+    // The text templates reproduce the interactive console reports byte for byte
+    static constexpr const char* INTERACTION_TEXT =
+        "\n=== INTERACTION ANALYSIS RESULTS ===\n"
+        "Analyzing combination of: {{#drugs}}{{name}}{{^last}} + {{/last}}{{/drugs}}\n\n"
+        "{{#incomplete}}"
+        "   PARTIAL RESULT: the analysis reached its time limit after {{pairsAnalyzed}} of {{pairCount}} drug pairs.\n"
+        "   The effects below are the most severe found so far; others may be missing.\n\n"
+        "{{/incomplete}}"
+        "{{^effects}}{{^incomplete}}No specific dangerous interactions found in database.\n{{/incomplete}}{{/effects}}"
+        "{{#effects}}"
+        "   Severity: {{severity}}\n"
+        "   Probability: {{probability}}%\n"
+        "   Description: {{description}}\n\n"
+        "{{/effects}}"
+        "{{#effects}}{{#first}}=== RISK ASSESSMENT ===\n{{/first}}{{/effects}}"
+        "{{#extremeDanger}}"
+        "   EXTREME DANGER: This combination has LETHAL potential.\n"
+        "   Immediate medical supervision required.\n"
+        "{{/extremeDanger}}"
+        "{{#highRisk}}"
+        "   HIGH RISK: This combination poses significant health risks.\n"
+        "   Medical consultation strongly recommended.\n"
+        "{{/highRisk}}"
+        "{{#moderateRisk}}"
+        "   MODERATE RISK: Monitor for side effects.\n"
+        "{{/moderateRisk}}";
+
+    static constexpr const char* OVERDOSE_TEXT =
+        "\n=== OVERDOSE RISK ANALYSIS ===\n"
+        "{{#single}}"
+        "{{#drugs}}Drug: {{name}}\nOverdose Risk Percentage: {{risk}}%\n{{/drugs}}"
+        "Risk Level: {{riskLevel}}\n\n"
+        "=== SAFETY RECOMMENDATIONS ===\n"
+        "{{#criticalRisk}}"
+        "   CRITICAL WARNING: Extremely high overdose risk!\n"
+        "   - Never use without medical supervision\n"
+        "   - Have naloxone (Narcan) immediately available\n"
+        "   - Consider addiction treatment resources\n"
+        "{{/criticalRisk}}"
+        "{{#highRisk}}"
+        "   HIGH RISK WARNING:\n"
+        "   - Use extreme caution with dosing\n"
+        "   - Never use alone - have someone present\n"
+        "   - Keep emergency contacts readily available\n"
+        "{{/highRisk}}"
+        "{{#moderateHighRisk}}"
+        "   MODERATE-HIGH RISK:\n"
+        "   - Start with lower doses\n"
+        "   - Avoid mixing with other substances\n"
+        "   - Monitor for adverse effects\n"
+        "{{/moderateHighRisk}}"
+        "{{#moderateRisk}}"
+        "   MODERATE RISK:\n"
+        "   - Follow prescribed dosages carefully\n"
+        "   - Be aware of tolerance changes\n"
+        "{{/moderateRisk}}"
+        "{{#lowerRisk}}"
+        "   LOWER RISK:\n"
+        "   - Still exercise caution with dosing\n"
+        "   - Monitor for unexpected reactions\n"
+        "{{/lowerRisk}}"
+        "{{/single}}"
+        "{{#combination}}"
+        "Analyzing combination of: {{#drugs}}{{name}}{{^last}} + {{/last}}{{/drugs}}\n\n"
+        "Individual Drug Risks:\n"
+        "{{#drugs}}  {{name}}: {{risk}}% risk\n{{/drugs}}"
+        "\nCombined Overdose Risk: {{combinedRisk}}%\n"
+        "Combined Risk Level: {{riskLevel}}\n\n"
+        "=== COMBINATION WARNINGS ===\n"
+        "{{#lethalCombination}}"
+        "   LETHAL COMBINATION DETECTED!\n"
+        "   - Respiratory depression risk extremely high\n"
+        "   - This combination is responsible for majority of overdose deaths\n"
+        "   - Seek immediate medical help if experiencing breathing difficulties\n"
+        "{{/lethalCombination}}"
+        "{{#speedball}}"
+        "   DANGEROUS SPEEDBALL COMBINATION!\n"
+        "   - Masking effects can lead to unexpected overdose\n"
+        "   - Cardiac stress significantly increased\n"
+        "{{/speedball}}"
+        "{{#emergency}}"
+        "   EMERGENCY PREPAREDNESS ESSENTIAL:\n"
+        "   - Have naloxone (Narcan) immediately available\n"
+        "   - Ensure someone trained in overdose response is present\n"
+        "   - Know emergency contact numbers\n"
+        "{{/emergency}}"
+        "{{/combination}}";
+
+    static constexpr const char* INTERACTION_HTML =
+        "<section class=\"interaction-report\">\n"
+        "<h2>Interaction Analysis Results</h2>\n"
+        "<p>Analyzing combination of: {{#drugs}}<strong>{{name}}</strong>{{^last}} + {{/last}}{{/drugs}}</p>\n"
+        "{{#incomplete}}<p class=\"partial\"><strong>Partial result:</strong> the analysis reached its time limit after "
+        "{{pairsAnalyzed}} of {{pairCount}} drug pairs. The effects below are the most severe found so far; others may "
+        "be missing.</p>\n{{/incomplete}}"
+        "{{^effects}}{{^incomplete}}<p>No specific dangerous interactions found in database.</p>\n{{/incomplete}}{{/effects}}"
+        "{{#effects}}{{#first}}<table>\n"
+        "<tr><th>Effect</th><th>Severity</th><th>Probability</th><th>Description</th></tr>\n{{/first}}"
+        "<tr><td>{{effect}}</td><td>{{severity}}</td><td>{{probability}}%</td><td>{{description}}</td></tr>\n"
+        "{{#last}}</table>\n{{/last}}{{/effects}}"
+        "{{#extremeDanger}}<p class=\"risk lethal\"><strong>Extreme danger:</strong> this combination has lethal potential. "
+        "Immediate medical supervision required.</p>\n{{/extremeDanger}}"
+        "{{#highRisk}}<p class=\"risk major\"><strong>High risk:</strong> this combination poses significant health risks. "
+        "Medical consultation strongly recommended.</p>\n{{/highRisk}}"
+        "{{#moderateRisk}}<p class=\"risk moderate\"><strong>Moderate risk:</strong> monitor for side effects.</p>\n"
+        "{{/moderateRisk}}"
+        "</section>\n";
+
+    static constexpr const char* OVERDOSE_HTML =
+        "<section class=\"overdose-report\">\n"
+        "<h2>Overdose Risk Analysis</h2>\n"
+        "{{#combination}}<p>Analyzing combination of: {{#drugs}}<strong>{{name}}</strong>{{^last}} + {{/last}}{{/drugs}}</p>\n"
+        "{{/combination}}"
+        "<table>\n<tr><th>Drug</th><th>Overdose risk</th></tr>\n"
+        "{{#drugs}}<tr><td>{{name}}</td><td>{{risk}}%</td></tr>\n{{/drugs}}"
+        "</table>\n"
+        "{{#combination}}<p>Combined overdose risk: <strong>{{combinedRisk}}%</strong></p>\n{{/combination}}"
+        "<p>Risk level: {{riskLevel}}</p>\n"
+        "{{#criticalRisk}}<p class=\"risk lethal\"><strong>Critical warning:</strong> extremely high overdose risk.</p>\n<ul>\n"
+        "<li>Never use without medical supervision</li>\n"
+        "<li>Have naloxone (Narcan) immediately available</li>\n"
+        "<li>Consider addiction treatment resources</li>\n</ul>\n{{/criticalRisk}}"
+        "{{#highRisk}}<p class=\"risk major\"><strong>High risk warning</strong></p>\n<ul>\n"
+        "<li>Use extreme caution with dosing</li>\n"
+        "<li>Never use alone - have someone present</li>\n"
+        "<li>Keep emergency contacts readily available</li>\n</ul>\n{{/highRisk}}"
+        "{{#moderateHighRisk}}<p class=\"risk major\"><strong>Moderate-high risk</strong></p>\n<ul>\n"
+        "<li>Start with lower doses</li>\n"
+        "<li>Avoid mixing with other substances</li>\n"
+        "<li>Monitor for adverse effects</li>\n</ul>\n{{/moderateHighRisk}}"
+        "{{#moderateRisk}}<p class=\"risk moderate\"><strong>Moderate risk</strong></p>\n<ul>\n"
+        "<li>Follow prescribed dosages carefully</li>\n"
+        "<li>Be aware of tolerance changes</li>\n</ul>\n{{/moderateRisk}}"
+        "{{#lowerRisk}}<p class=\"risk minor\"><strong>Lower risk</strong></p>\n<ul>\n"
+        "<li>Still exercise caution with dosing</li>\n"
+        "<li>Monitor for unexpected reactions</li>\n</ul>\n{{/lowerRisk}}"
+        "{{#lethalCombination}}<p class=\"risk lethal\"><strong>Lethal combination detected.</strong> "
+        "Respiratory depression risk is extremely high; this combination is responsible for the majority of "
+        "overdose deaths. Seek immediate medical help if experiencing breathing difficulties.</p>\n"
+        "{{/lethalCombination}}"
+        "{{#speedball}}<p class=\"risk lethal\"><strong>Dangerous speedball combination.</strong> "
+        "Masking effects can lead to unexpected overdose, and cardiac stress is significantly increased.</p>\n"
+        "{{/speedball}}"
+        "{{#emergency}}<p class=\"risk lethal\"><strong>Emergency preparedness essential:</strong> have naloxone (Narcan) "
+        "immediately available, make sure someone trained in overdose response is present and know emergency "
+        "contact numbers.</p>\n{{/emergency}}"
+        "</section>\n";
+
+    static constexpr const char* INTERACTION_JSON =
+        "{\"drugs\":[{{#drugs}}\"{{name}}\"{{^last}},{{/last}}{{/drugs}}],"
+        "{{#incomplete}}\"complete\":false,\"pairsAnalyzed\":{{pairsAnalyzed}},\"pairCount\":{{pairCount}},{{/incomplete}}"
+        "\"effects\":[{{#effects}}{\"effect\":\"{{effect}}\",\"severity\":\"{{severity}}\","
+        "\"probabilityPercent\":{{probability}},\"description\":\"{{description}}\"}{{^last}},{{/last}}{{/effects}}],"
+        "\"assessment\":\"{{#extremeDanger}}EXTREME_DANGER{{/extremeDanger}}{{#highRisk}}HIGH_RISK{{/highRisk}}"
+        "{{#moderateRisk}}MODERATE_RISK{{/moderateRisk}}{{^effects}}{{#incomplete}}UNKNOWN{{/incomplete}}"
+        "{{^incomplete}}NONE{{/incomplete}}{{/effects}}\"}";
+
+    static constexpr const char* OVERDOSE_JSON =
+        "{\"drugs\":[{{#drugs}}{\"name\":\"{{name}}\",\"riskPercent\":{{risk}}}{{^last}},{{/last}}{{/drugs}}],"
+        "\"combinedRiskPercent\":{{combinedRisk}},\"riskLevel\":\"{{riskLevel}}\","
+        "\"lethalCombination\":{{#lethalCombination}}true{{/lethalCombination}}{{^lethalCombination}}false{{/lethalCombination}},"
+        "\"speedball\":{{#speedball}}true{{/speedball}}{{^speedball}}false{{/speedball}},"
+        "\"emergencyPreparedness\":{{#emergency}}true{{/emergency}}{{^emergency}}false{{/emergency}}}";
+
+    static std::string& threadBuffer() {
+        thread_local std::string buffer;
+        return buffer;
+    }
+
+public:
+    ReportRenderer() {
+        const char* interaction[FORMAT_COUNT] = { INTERACTION_TEXT, INTERACTION_HTML, INTERACTION_JSON };
+        const char* overdose[FORMAT_COUNT] = { OVERDOSE_TEXT, OVERDOSE_HTML, OVERDOSE_JSON };
+        std::string error;
+        for (int f = 0; f < FORMAT_COUNT; ++f) {
+            interactionTemplates[f].compile(interaction[f], error);
+            overdoseTemplates[f].compile(overdose[f], error);
+        }
+    }
+
+    // Replaces a built-in template, e.g. with a site-specific letter layout
+    bool setInteractionTemplate(ReportFormat format, const std::string& source, std::string& error) {
+        ReportTemplate<InteractionReport> compiled;
+        if (!compiled.compile(source, error)) return false;
+        interactionTemplates[static_cast<int>(format)] = std::move(compiled);
+        return true;
+    }
+
+    bool setOverdoseTemplate(ReportFormat format, const std::string& source, std::string& error) {
+        ReportTemplate<OverdoseReport> compiled;
+        if (!compiled.compile(source, error)) return false;
+        overdoseTemplates[static_cast<int>(format)] = std::move(compiled);
+        return true;
+    }
+
+    const std::string& render(const InteractionReport& report, ReportFormat format) const {
+        std::string& buffer = threadBuffer();
+        buffer.clear();
+        ReportWriter out(buffer, format);
+        interactionTemplates[static_cast<int>(format)].render(report, out);
+        return buffer;
+    }
+
+    const std::string& render(const OverdoseReport& report, ReportFormat format) const {
+        std::string& buffer = threadBuffer();
+        buffer.clear();
+        ReportWriter out(buffer, format);
+        overdoseTemplates[static_cast<int>(format)].render(report, out);
+        return buffer;
+    }
+
+    // One patient letter: the interaction report (if there is one) followed by the
+    // overdose report. JSON letters are one object per line.
+    const std::string& renderLetter(const InteractionReport* interaction, const OverdoseReport& overdose,
+        ReportFormat format) const {
+        std::string& buffer = threadBuffer();
+        buffer.clear();
+        ReportWriter out(buffer, format);
+        int f = static_cast<int>(format);
+
+        if (format == ReportFormat::JSON) out.literal("{\"interaction\":");
+        else if (format == ReportFormat::HTML) out.literal("<article class=\"letter\">\n");
+
+        if (interaction) interactionTemplates[f].render(*interaction, out);
+        else if (format == ReportFormat::JSON) out.literal("null");
+
+        if (format == ReportFormat::JSON) out.literal(",\"overdose\":");
+        overdoseTemplates[f].render(overdose, out);
+
+        if (format == ReportFormat::JSON) out.literal("}\n");
+        else if (format == ReportFormat::HTML) out.literal("</article>\n");
+        return buffer;
+    }
+};
@@ -0,0 +1,213 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+// The AVX2 path is compiled for every x86 build and chosen at run time, so
+// binaries built without -mavx2 or /arch:AVX2 still use it where the CPU can
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define RISK_KERNEL_AVX2 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#if defined(__GNUC__) || defined(__clang__)
+#define RISK_KERNEL_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define RISK_KERNEL_TARGET_AVX2
+#endif
+#endif
+
+#include "db.h"
+#include "od_db.h"
+
+// calculateCombinationRisk for many regimens at once, for population screens.
+//
+// Regimens come as catalog drug ids in CSR form: regimen r is
+// drugIds[offsets[r] .. offsets[r + 1]). A regimen needs only the sum of its
+// drugs' percentages and whether it matches the SPEEDBALL pattern. The pattern
+// selects a handful of CombinationPatterns features, so each drug is one word with
+// its percentage in the low 8 bits and just those feature bits above, and the
+// pattern is compiled into a table indexed by their OR over the regimen. Since percentages are whole numbers the pow() of
+// the scalar path reduces to a lookup by percent sum (combinationRiskFromSum).
+// On CPUs with AVX2 eight regimens are scored per instruction. A pattern that selects
+// drug-count thresholds or too many features is evaluated by CombinationPatterns
+// directly.
+class CombinationRiskKernel {
+public:
+    enum class Path {
+        SCALAR,
+        AVX2
+    };
+
+private:
+    static constexpr int TABLE_SIZE = 102;                 // Sums 0..100, then "above 100"
+    static constexpr int MAX_TABLE_FEATURES = 12;
+    static constexpr int32_t MAX_VECTOR_LENGTH = 1 << 24;  // 32-bit percent sums cannot wrap
+    static constexpr uint32_t PERCENT_MASK = 0xff;
+    static constexpr int FEATURE_SHIFT = 8;
+
+    const CombinationPatterns& patterns;
+    bool tableDriven;
+    std::vector<uint32_t> packedDrugs;    // By catalog id: percent | SPEEDBALL features << FEATURE_SHIFT
+    std::vector<uint8_t> speedballTable;  // By OR of the packed features
+    uint8_t riskTable[2 * TABLE_SIZE];    // [speedball][percent sum]
+
+    int lookup(uint32_t percentSum, bool speedball) const {
+        return riskTable[(speedball ? TABLE_SIZE : 0) + std::min<uint32_t>(percentSum, TABLE_SIZE - 1)];
+    }
+
+    int scoreRange(const int32_t* first, const int32_t* last) const {
+        if (first == last) return 0;
+        uint64_t percentSum = 0;
+        uint32_t features = 0;
+        for (const int32_t* id = first; id != last; ++id) {
+            percentSum += packedDrugs[*id] & PERCENT_MASK;
+            features |= packedDrugs[*id];
+        }
+        uint32_t sum = static_cast<uint32_t>(std::min<uint64_t>(percentSum, TABLE_SIZE - 1));
+        if (tableDriven) return lookup(sum, speedballTable[features >> FEATURE_SHIFT]);
+
+        uint64_t mask = patterns.regimenMask(first, static_cast<size_t>(last - first));
+        return lookup(sum, patterns.matches(mask, CombinationPatterns::SPEEDBALL));
+    }
+
+#ifdef RISK_KERNEL_AVX2
+    static bool cpuHasAvx2() {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) return false;
+        __cpuid(info, 1);
+        bool osSavesYmm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+        __cpuidex(info, 7, 0);
+        return osSavesYmm && (info[1] & (1 << 5));
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+
+    // Scores the eight regimens starting at r, all at most MAX_VECTOR_LENGTH long
+    RISK_KERNEL_TARGET_AVX2 void scoreBlock(const int32_t* offsets, const int32_t* drugIds, size_t r, uint8_t* risks) const {
+        __m256i begin = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(offsets + r));
+        __m256i end = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(offsets + r + 1));
+        __m256i length = _mm256_sub_epi32(end, begin);
+        __m256i sums = _mm256_setzero_si256();
+        __m256i features = _mm256_setzero_si256();
+        const int* table = reinterpret_cast<const int*>(packedDrugs.data());
+        const __m256i percentMask = _mm256_set1_epi32(PERCENT_MASK);
+
+        int32_t longest = 0;
+        for (size_t lane = 0; lane < 8; ++lane) {
+            longest = std::max(longest, offsets[r + lane + 1] - offsets[r + lane]);
+        }
+
+        for (int32_t step = 0; step < longest; ++step) {
+            __m256i position = _mm256_set1_epi32(step);
+            __m256i active = _mm256_cmpgt_epi32(length, position);
+            __m256i ids = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), drugIds,
+                _mm256_add_epi32(begin, position), active, 4);
+            __m256i packed = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), table, ids, active, 4);
+            sums = _mm256_add_epi32(sums, _mm256_and_si256(packed, percentMask));
+            features = _mm256_or_si256(features, packed);
+        }
+
+        alignas(32) uint32_t laneSums[8];
+        alignas(32) uint32_t laneFeatures[8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(laneSums), sums);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(laneFeatures), features);
+        for (size_t lane = 0; lane < 8; ++lane) {
+            risks[r + lane] = (offsets[r + lane + 1] == offsets[r + lane])
+                ? 0 : static_cast<uint8_t>(lookup(laneSums[lane], speedballTable[laneFeatures[lane] >> FEATURE_SHIFT]));
+        }
+    }
+
+    // Scores whole blocks of eight; returns the number of regimens scored
+    RISK_KERNEL_TARGET_AVX2 size_t scoreBlocks(const int32_t* offsets, const int32_t* drugIds, size_t regimenCount,
+        uint8_t* risks) const {
+        size_t r = 0;
+        for (; r + 8 <= regimenCount; r += 8) {
+            bool vectorizable = true;
+            for (size_t lane = 0; lane < 8; ++lane) {
+                vectorizable = vectorizable && offsets[r + lane + 1] - offsets[r + lane] <= MAX_VECTOR_LENGTH;
+            }
+            if (vectorizable) {
+                scoreBlock(offsets, drugIds, r, risks);
+                continue;
+            }
+            for (size_t lane = 0; lane < 8; ++lane) {
+                risks[r + lane] = static_cast<uint8_t>(scoreRange(drugIds + offsets[r + lane], drugIds + offsets[r + lane + 1]));
+            }
+        }
+        return r;
+    }
+#endif
+
+public:
+    CombinationRiskKernel(const DrugDatabase& database, const OverdosePotentialDatabase& overdoseDB,
+        const CombinationPatterns& combinationPatterns)
+        : patterns(combinationPatterns) {
+        uint64_t selector = patterns.getPatternSelector(CombinationPatterns::SPEEDBALL);
+        tableDriven = std::popcount(selector) <= MAX_TABLE_FEATURES &&
+            (selector >> CombinationPatterns::COUNT_SHIFT) == 0;
+
+        for (size_t id = 0; id < database.getDrugCount(); ++id) {
+            const std::pmr::string& name = database.getDrugById(static_cast<int>(id))->getName();
+            uint32_t packed = static_cast<uint32_t>(overdoseDB.getOverdosePercentage(name));
+            if (tableDriven) {
+                packed |= static_cast<uint32_t>(CombinationPatterns::extractFeatures(
+                    patterns.getDrugFeatures(static_cast<int>(id)), selector)) << FEATURE_SHIFT;
+            }
+            packedDrugs.push_back(packed);
+        }
+        if (tableDriven) {
+            for (uint64_t packed = 0; packed < (uint64_t(1) << std::popcount(selector)); ++packed) {
+                speedballTable.push_back(patterns.matches(CombinationPatterns::depositFeatures(packed, selector),
+                    CombinationPatterns::SPEEDBALL));
+            }
+        }
+        for (int sum = 0; sum < TABLE_SIZE; ++sum) {
+            riskTable[sum] = static_cast<uint8_t>(OverdosePotentialDatabase::combinationRiskFromSum(sum, false));
+            riskTable[TABLE_SIZE + sum] = static_cast<uint8_t>(OverdosePotentialDatabase::combinationRiskFromSum(sum, true));
+        }
+    }
+
+    // Same value as calculateCombinationRisk for the regimen's drug names
+    int score(const std::vector<int>& drugIds) const {
+        return scoreRange(drugIds.data(), drugIds.data() + drugIds.size());
+    }
+
+    // Whether this build and CPU can run the path
+    static bool supports(Path path) {
+#ifdef RISK_KERNEL_AVX2
+        static const bool avx2 = cpuHasAvx2();
+        return path == Path::SCALAR || avx2;
+#else
+        return path == Path::SCALAR;
+#endif
+    }
+
+    static Path bestPath() {
+        return supports(Path::AVX2) ? Path::AVX2 : Path::SCALAR;
+    }
+
+    // Scores regimenCount regimens into risks with the fastest supported path;
+    // offsets has regimenCount + 1 entries
+    void score(const int32_t* offsets, const int32_t* drugIds, size_t regimenCount, uint8_t* risks) const {
+        score(offsets, drugIds, regimenCount, risks, bestPath());
+    }
+
+    // Same with a given path, which must be supported; both give identical scores
+    void score(const int32_t* offsets, const int32_t* drugIds, size_t regimenCount, uint8_t* risks, Path path) const {
+        size_t r = 0;
+#ifdef RISK_KERNEL_AVX2
+        if (path == Path::AVX2 && tableDriven) {
+            r = scoreBlocks(offsets, drugIds, regimenCount, risks);
+        }
+#endif
+        for (; r < regimenCount; ++r) {
+            risks[r] = static_cast<uint8_t>(scoreRange(drugIds + offsets[r], drugIds + offsets[r + 1]));
+        }
+    }
+};
@@ -0,0 +1,501 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "batch_runner.h"
+#include "columnar_results.h"
+#include "population_stats.h"
+
+// Byte range [begin, end) of a regimen file, starting on a line boundary. Its
+// lines keep the regimen ids they have in the whole file.
+struct BatchShard {
+    uint64_t begin = 0;
+    uint64_t end = 0;
+    uint64_t firstRegimenId = 1;
+    uint64_t lines = 0;
+};
+
+// One attempt at one shard, as handed to a launcher
+struct ShardTask {
+    size_t index = 0;
+    BatchShard shard;
+    std::string outputPath;    // Results (.phrc), written under a temporary name and renamed when complete
+    std::string progressPath;  // Lines read so far, then "done <regimens> <skipped> <unknown drugs>"
+    std::string statisticsPath;  // Saved PopulationAggregator of the shard; empty when not wanted
+};
+
+// Reads a byte range of a file as a stream
+class FileRangeBuffer : public std::streambuf {
+private:
+    std::ifstream file;
+    uint64_t remaining;
+    char buffer[65536];
+
+    int_type underflow() override {
+        if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+        if (remaining == 0) return traits_type::eof();
+
+        file.read(buffer, static_cast<std::streamsize>(std::min<uint64_t>(remaining, sizeof(buffer))));
+        std::streamsize count = file.gcount();
+        if (count <= 0) return traits_type::eof();
+        remaining -= static_cast<uint64_t>(count);
+        setg(buffer, buffer, buffer + count);
+        return traits_type::to_int_type(*gptr());
+    }
+
+public:
+    FileRangeBuffer(const std::string& path, uint64_t begin, uint64_t end)
+        : file(path, std::ios::binary), remaining(end > begin ? end - begin : 0) {
+        file.seekg(static_cast<std::streamoff>(begin));
+        if (!file) remaining = 0;
+    }
+
+    bool isOpen() const { return file.is_open(); }
+};
+
+// Runs shard workers somewhere and reports when they finish. A launcher may run
+// several workers at once; the coordinator never starts more than its worker count.
+class ShardLauncher {
+public:
+    virtual ~ShardLauncher() = default;
+
+    // False when the worker could not be started
+    virtual bool start(const ShardTask& task) = 0;
+
+    // Waits up to timeout for a worker to finish; false when none did
+    virtual bool waitFinished(std::chrono::milliseconds timeout, size_t& index, bool& succeeded) = 0;
+
+    // Kills the worker of a shard that is still running; waitFinished then reports
+    // it as failed. False when this launcher cannot stop workers.
+    virtual bool stop(size_t index) = 0;
+};
+
+#ifndef _WIN32
+// Runs each worker as a child process and reaps it with waitpid
+class ChildProcessShardLauncher : public ShardLauncher {
+private:
+    std::map<pid_t, size_t> running;
+
+protected:
+    // Runs in the child; must not return
+    virtual void runChild(const ShardTask& task) = 0;
+
+public:
+    bool start(const ShardTask& task) override {
+        std::fflush(nullptr);  // Buffered output would otherwise be written by the child too
+        pid_t pid = fork();
+        if (pid < 0) return false;
+        if (pid == 0) {
+            runChild(task);
+            _exit(127);
+        }
+        running[pid] = task.index;
+        return true;
+    }
+
+    bool waitFinished(std::chrono::milliseconds timeout, size_t& index, bool& succeeded) override {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!running.empty()) {
+            int status = 0;
+            pid_t pid = waitpid(-1, &status, WNOHANG);
+            if (pid > 0 && running.count(pid)) {
+                index = running[pid];
+                succeeded = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+                running.erase(pid);
+                return true;
+            }
+            if (std::chrono::steady_clock::now() >= deadline) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return false;
+    }
+
+    // Also kills the child's process group, if it made one, so that whatever a
+    // command started goes with it
+    bool stop(size_t index) override {
+        for (const auto& [pid, shard] : running) {
+            if (shard != index) continue;
+            kill(-pid, SIGKILL);
+            kill(pid, SIGKILL);
+        }
+        return true;
+    }
+};
+#endif
+
+// Runs each worker as a shell command, e.g. the batch CLI of this executable,
+// optionally behind a prefix such as "ssh node7" to run it on another host that
+// sees the same files. The command runs in its own process group, so stopping
+// it also stops the processes it started.
+#ifndef _WIN32
+class CommandShardLauncher : public ChildProcessShardLauncher {
+private:
+    std::function<std::string(const ShardTask&)> command;
+
+protected:
+    void runChild(const ShardTask& task) override {
+        setpgid(0, 0);
+        std::string line = command(task);
+        execl("/bin/sh", "sh", "-c", line.c_str(), static_cast<char*>(nullptr));
+    }
+
+public:
+    explicit CommandShardLauncher(std::function<std::string(const ShardTask&)> commandLine)
+        : command(std::move(commandLine)) {
+    }
+};
+#else
+// Without process control a command runs to completion and cannot be stopped
+class CommandShardLauncher : public ShardLauncher {
+private:
+    std::function<std::string(const ShardTask&)> command;
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::pair<size_t, bool>> finished;
+
+public:
+    explicit CommandShardLauncher(std::function<std::string(const ShardTask&)> commandLine)
+        : command(std::move(commandLine)) {
+    }
+
+    ~CommandShardLauncher() override {
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    bool start(const ShardTask& task) override {
+        threads.emplace_back([this, index = task.index, line = command(task)] {
+            bool succeeded = std::system(line.c_str()) == 0;
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.emplace_back(index, succeeded);
+            changed.notify_one();
+        });
+        return true;
+    }
+
+    bool waitFinished(std::chrono::milliseconds timeout, size_t& index, bool& succeeded) override {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!changed.wait_for(lock, timeout, [this] { return !finished.empty(); })) return false;
+        index = finished.front().first;
+        succeeded = finished.front().second;
+        finished.pop_front();
+        return true;
+    }
+
+    bool stop(size_t) override { return false; }
+};
+#endif
+
+#ifndef _WIN32
+// Runs each worker in a forked child of the coordinator. The child starts with
+// the coordinator's catalog (drugs, interaction rules, overdose data) already
+// built and shares its pages copy-on-write, so no worker loads or rebuilds it.
+// Fork before starting any threads of your own.
+class ForkShardLauncher : public ChildProcessShardLauncher {
+private:
+    std::function<int(const ShardTask&)> worker;
+
+protected:
+    void runChild(const ShardTask& task) override {
+        _exit(worker(task));
+    }
+
+public:
+    explicit ForkShardLauncher(std::function<int(const ShardTask&)> shardWorker)
+        : worker(std::move(shardWorker)) {
+    }
+};
+#endif
+
+// Splits a regimen file into shards, runs them through a launcher with retries,
+// and merges the shard results in file order.
+//
+// The plan counts the lines of every shard up front, so each worker numbers its
+// regimens as a single run over the whole file would. Merging appends the rows of
+// each shard in order through one writer, which regroups them exactly as that run
+// would, so the merged file is byte for byte the one --batch writes. With
+// statistics, each worker also saves its PopulationAggregator and the coordinator
+// merges them in shard order; every statistic but the heavy-hitter list is an
+// exact count, so only that list can depend on the shard count, and only within
+// its error bounds.
+class ShardCoordinator {
+public:
+    struct Options {
+        size_t workers = 4;
+        size_t shards = 0;        // 0 for four per worker, so retries and stragglers cost less
+        int maxAttempts = 3;
+        std::chrono::milliseconds attemptTimeout{ 0 };  // 0 for none; a longer attempt is stopped and retried
+        bool statistics = false;  // Workers also save their population statistics
+    };
+
+    struct Summary {
+        BatchRunner::Summary batch;
+        size_t shards = 0;
+        size_t retries = 0;
+        size_t timeouts = 0;      // Attempts stopped for running past options.attemptTimeout
+        bool complete = true;     // False when a shard failed every attempt
+    };
+
+private:
+    Options options;
+    std::filesystem::path workDirectory;
+    std::vector<BatchShard> shards;
+
+    std::string shardPath(size_t index, const char* extension) const {
+        return (workDirectory / ("shard-" + std::to_string(index) + extension)).string();
+    }
+
+    // Lines read, or the final counts once the worker is done
+    static bool readProgress(const std::string& path, uint64_t& lines, BatchRunner::Summary* done) {
+        std::ifstream in(path);
+        std::string first;
+        if (!(in >> first)) return false;
+        if (first == "done") {
+            return done && static_cast<bool>(in >> done->regimens >> done->skipped >> done->unknownDrugs);
+        }
+        try {
+            lines = std::stoull(first);
+        }
+        catch (const std::exception&) {
+            return false;
+        }
+        return true;
+    }
+
+public:
+    explicit ShardCoordinator(const Options& coordinatorOptions) : options(coordinatorOptions) {
+        options.workers = std::max<size_t>(options.workers, 1);
+        if (options.shards == 0) options.shards = options.workers * 4;
+    }
+
+    // Cuts the file at evenly spaced offsets, each moved just past the next newline,
+    // and counts the lines of each shard. Shard files go to workDir.
+    bool plan(const std::string& path, const std::string& workDir, std::string& error) {
+        workDirectory = workDir;
+        shards.clear();
+
+        std::ifstream in(path, std::ios::binary);
+        std::error_code sizeError;
+        uint64_t size = std::filesystem::file_size(path, sizeError);
+        if (!in || sizeError) {
+            error = "cannot open regimen file '" + path + "'";
+            return false;
+        }
+
+        std::vector<uint64_t> cuts{ 0 };
+        for (size_t k = 1; k < options.shards && size > 0; ++k) {
+            uint64_t target = std::max(size * k / options.shards, cuts.back());
+            in.clear();
+            in.seekg(static_cast<std::streamoff>(target));
+            uint64_t cut = target;
+            for (int c = in.get(); c != EOF && c != '\n'; c = in.get()) {
+                ++cut;
+            }
+            if (cut + 1 < size && cut + 1 > cuts.back()) cuts.push_back(cut + 1);
+        }
+        if (size > 0) cuts.push_back(size);
+
+        in.clear();
+        in.seekg(0);
+        std::vector<char> block(1 << 20);
+        uint64_t offset = 0;
+        char last = '\n';
+        for (size_t k = 0; k + 1 < cuts.size(); ++k) {
+            BatchShard shard{ cuts[k], cuts[k + 1], shards.empty() ? 1 : shards.back().firstRegimenId + shards.back().lines, 0 };
+            while (offset < shard.end) {
+                in.read(block.data(), static_cast<std::streamsize>(std::min<uint64_t>(block.size(), shard.end - offset)));
+                std::streamsize count = in.gcount();
+                if (count <= 0) break;
+                shard.lines += static_cast<uint64_t>(std::count(block.data(), block.data() + count, '\n'));
+                last = block[count - 1];
+                offset += static_cast<uint64_t>(count);
+            }
+            if (shard.end == size && last != '\n') ++shard.lines;  // Final line without a newline
+            shards.push_back(shard);
+        }
+        return true;
+    }
+
+    const std::vector<BatchShard>& getShards() const { return shards; }
+
+    uint64_t getLineCount() const {
+        return shards.empty() ? 0 : shards.back().firstRegimenId + shards.back().lines - 1;
+    }
+
+    // Runs every shard, at most options.workers at a time, starting a shard again
+    // after a failure until it has had options.maxAttempts. A worker succeeded when
+    // it exited cleanly and left its results, its final counts and, when wanted, its
+    // statistics. An attempt
+    // still running after options.attemptTimeout is stopped and counts as failed;
+    // its shard only starts again once the launcher reports the worker gone, so two
+    // attempts never write the same files. Progress goes to out about once a second.
+    Summary execute(ShardLauncher& launcher, std::ostream& out) {
+        Summary summary;
+        summary.shards = shards.size();
+        std::deque<size_t> pending;
+        std::vector<int> attempts(shards.size(), 0);
+        std::vector<bool> finished(shards.size(), false);
+        std::vector<bool> active(shards.size(), false);
+        std::vector<bool> stopping(shards.size(), false);
+        std::vector<std::chrono::steady_clock::time_point> startedAt(shards.size());
+        for (size_t i = 0; i < shards.size(); ++i) {
+            pending.push_back(i);
+        }
+
+        auto taskFor = [this](size_t index) {
+            return ShardTask{ index, shards[index], shardPath(index, ".phrc"), shardPath(index, ".progress"),
+                options.statistics ? shardPath(index, ".stats") : "" };
+        };
+        auto failed = [&](size_t index) {
+            if (attempts[index] < options.maxAttempts) {
+                out << "Shard " << index + 1 << " failed (attempt " << attempts[index] << "), retrying.\n";
+                ++summary.retries;
+                pending.push_back(index);
+            }
+            else {
+                out << "Shard " << index + 1 << " failed " << attempts[index] << " times, giving up.\n";
+                summary.complete = false;
+            }
+        };
+
+        size_t running = 0;
+        size_t done = 0;
+        auto lastReport = std::chrono::steady_clock::now();
+        while (!pending.empty() || running > 0) {
+            while (running < options.workers && !pending.empty()) {
+                size_t index = pending.front();
+                pending.pop_front();
+                ++attempts[index];
+                ShardTask task = taskFor(index);
+                std::error_code ignored;
+                std::filesystem::remove(task.outputPath, ignored);
+                std::filesystem::remove(task.progressPath, ignored);
+                if (!task.statisticsPath.empty()) std::filesystem::remove(task.statisticsPath, ignored);
+                if (launcher.start(task)) {
+                    ++running;
+                    active[index] = true;
+                    stopping[index] = false;
+                    startedAt[index] = std::chrono::steady_clock::now();
+                }
+                else {
+                    failed(index);
+                }
+            }
+            if (running == 0) continue;  // Every start failed; those shards are queued again or given up
+
+            size_t index = 0;
+            bool succeeded = false;
+            if (launcher.waitFinished(std::chrono::milliseconds(200), index, succeeded)) {
+                --running;
+                active[index] = false;
+                ShardTask task = taskFor(index);
+                BatchRunner::Summary counts;
+                uint64_t lines = 0;
+                if (succeeded && std::filesystem::exists(task.outputPath) && readProgress(task.progressPath, lines, &counts) &&
+                    (task.statisticsPath.empty() || std::filesystem::exists(task.statisticsPath))) {
+                    finished[index] = true;
+                    ++done;
+                    summary.batch.regimens += counts.regimens;
+                    summary.batch.skipped += counts.skipped;
+                    summary.batch.unknownDrugs += counts.unknownDrugs;
+                }
+                else {
+                    failed(index);
+                }
+            }
+
+            if (options.attemptTimeout.count() > 0) {
+                auto now = std::chrono::steady_clock::now();
+                for (size_t i = 0; i < shards.size(); ++i) {
+                    if (!active[i] || stopping[i] || now - startedAt[i] < options.attemptTimeout) continue;
+                    out << "Shard " << i + 1 << " timed out (attempt " << attempts[i] << ")"
+                        << (launcher.stop(i) ? ", stopping it.\n" : " and cannot be stopped.\n");
+                    ++summary.timeouts;
+                    stopping[i] = true;
+                }
+            }
+
+            if (std::chrono::steady_clock::now() - lastReport >= std::chrono::seconds(1)) {
+                lastReport = std::chrono::steady_clock::now();
+                uint64_t linesRead = 0;
+                for (size_t i = 0; i < shards.size(); ++i) {
+                    uint64_t lines = 0;
+                    if (finished[i]) linesRead += shards[i].lines;
+                    else if (readProgress(taskFor(i).progressPath, lines, nullptr)) linesRead += lines;
+                }
+                out << "Progress: " << linesRead << " of " << getLineCount() << " lines, " << done << " of "
+                    << shards.size() << " shards done, " << running << " running.\n";
+            }
+        }
+        summary.complete = summary.complete && done == shards.size();
+        return summary;
+    }
+
+    // Appends the shard results in order to writer and, with an aggregator (which
+    // needs options.statistics), merges the statistics of every shard into it.
+    // False when a shard file is missing or unreadable.
+    bool merge(ColumnarResultWriter& writer, PopulationAggregator* aggregator, std::string& error) const {
+        std::vector<int> ids;
+        std::vector<InteractionEffect> effects;
+        for (size_t index = 0; index < shards.size(); ++index) {
+            ColumnarResultReader reader;
+            if (!reader.load(shardPath(index, ".phrc")) || !reader.isComplete()) {
+                error = "cannot read results of shard " + std::to_string(index + 1);
+                return false;
+            }
+            for (size_t g = 0; g < reader.getRowGroupCount(); ++g) {
+                const RowGroupView& group = reader.getRowGroup(g);
+                for (uint32_t row = 0; row < group.rows; ++row) {
+                    ids.assign(group.drugIds + group.drugOffsets[row], group.drugIds + group.drugOffsets[row + 1]);
+                    effects.clear();
+                    for (int e = 0; e < SIDE_EFFECT_COUNT; ++e) {
+                        if (group.severities[e][row] == COLUMNAR_EFFECT_ABSENT) continue;
+                        effects.push_back({ static_cast<SideEffect>(e), static_cast<InteractionSeverity>(group.severities[e][row]),
+                            group.probabilities[e][row], 0 });
+                    }
+                    writer.batch().appendRow(group.regimenIds[row], ids, effects, group.overdoseRisk[row]);
+                    writer.commitRows();
+                }
+            }
+
+            if (aggregator) {
+                PopulationAggregator partial = aggregator->emptyLike();
+                std::ifstream statistics(shardPath(index, ".stats"), std::ios::binary);
+                if (!partial.read(statistics)) {
+                    error = "cannot read statistics of shard " + std::to_string(index + 1);
+                    return false;
+                }
+                aggregator->merge(partial);
+            }
+        }
+        return true;
+    }
+
+    void removeWorkFiles() const {
+        std::error_code ignored;
+        std::filesystem::remove_all(workDirectory, ignored);
+    }
+};